@@ -43,8 +43,12 @@
 #include <iomanip>
 #include <thread>
 #include <mutex>
+#include <future>
 
 #include <opencv2/core/core.hpp>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #include "cTracking.h"
 #include "cConverter.h"
@@ -60,6 +64,8 @@ void LoadImagesAndTimestamps(
 	vector<vector<string>> &vstrImageFilenames,
 	vector<double> &vTimestamps);
 
+double GetResidentMemoryMB();
+
 int main(int argc, char **argv)
 {
 	if (argc != 5)
@@ -83,6 +89,15 @@ int main(int argc, char **argv)
 	string trajs = to_string(traj);
 	const int endFrame = (int)frameSettings["traj.EndFrame"];
 	const int startFrame = (int)frameSettings["traj.StartFrame"];
+	// replaying the sequence several times gives a long looped sequence
+	int nrLoops = (int)frameSettings["traj.NrLoops"];
+	if (nrLoops < 1)
+		nrLoops = 1;
+	// extract features of the next frame while the current one is tracked,
+	// in live mode the frames are submitted at camera rate and may be dropped
+	const int pipelineMode = (int)frameSettings["Tracking.Pipelined"];
+	const bool pipelined = pipelineMode == 1;
+	const bool live = pipelineMode == 2;
 
 	// --------------
 	// 4. Load image paths and timestamps
@@ -97,17 +112,29 @@ int main(int argc, char **argv)
 
 	// Vector for tracking time statistics
 	vector<float> vTimesTrack;
-	vTimesTrack.resize(nImages);
+	vTimesTrack.resize(nImages * nrLoops);
+
+	// memory over time: objects in the map, retired and freed objects, resident memory
+	MultiColSLAM::cMap* pMap = MultiSLAM.GetMap();
+	ofstream fMemory("MemoryOverTime.txt");
+	fMemory << "# frame timestamp mapPoints keyFrames pendingMapPoints pendingKeyFrames "
+		<< "freedMapPoints freedKeyFrames residentMB" << endl;
 
 	cout << endl << "-------" << endl;
 	cout << "Start processing sequence ..." << endl;
-	cout << "Images in the sequence: " << nImages << endl << endl;
+	cout << "Images in the sequence: " << nImages << endl;
+	cout << "Passes over the sequence: " << nrLoops << endl << endl;
 
 	// Main loop
 	const int nrCams = static_cast<int>(imgFilenames.size());
+	const double seqDuration = timestamps[nImages - 1] - timestamps[0] +
+		(nImages > 1 ? (timestamps[nImages - 1] - timestamps[0]) / (nImages - 1) : 0.0);
 	std::vector<cv::Mat> imgs(nrCams);
-	for (int ni = 0; ni < nImages; ni++)
+	std::future<cv::Matx44d> pendingPose;
+	int nrPolledLost = 0;
+	for (int frame = 0; frame < nImages * nrLoops; frame++)
 	{
+		const int ni = frame % nImages;
 		// Read image from file
 		std::vector<bool> loaded(nrCams);
 		for (int c = 0; c < nrCams; ++c)
@@ -119,43 +146,95 @@ int main(int argc, char **argv)
 				return 1;
 			}
 		}
-		double tframe = timestamps[ni];
+		double tframe = timestamps[ni] + (frame / nImages) * seqDuration;
 		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
 		// Pass the image to the SLAM system
-		MultiSLAM.TrackMultiColSLAM(imgs, tframe);
+		if (live)
+		{
+			MultiSLAM.SubmitImageSet(imgs, tframe);
+			MultiColSLAM::cTrackingPipeline::sPoseResult result;
+			while (MultiSLAM.PollPose(result))
+				if (!result.bTracked)
+					++nrPolledLost;
+		}
+		else if (pipelined)
+		{
+			// imread allocates new images for the next frame, so the
+			// submitted ones stay untouched until they are processed.
+			// Waiting for the previous pose keeps one frame in flight.
+			std::future<cv::Matx44d> pose = MultiSLAM.TrackMultiColSLAMAsync(imgs, tframe);
+			if (pendingPose.valid())
+				pendingPose.get();
+			pendingPose = std::move(pose);
+		}
+		else
+			MultiSLAM.TrackMultiColSLAM(imgs, tframe);
 
 		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
 
 		double ttrack = std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1).count();
 
-		vTimesTrack[ni] = ttrack;
+		vTimesTrack[frame] = ttrack;
+
+		MultiColSLAM::cEpochReclaimer* pReclaimer = pMap->GetReclaimer();
+		fMemory << frame << " " << setprecision(10) << tframe << " "
+			<< pMap->MapPointsInMap() << " " << pMap->KeyFramesInMap() << " "
+			<< pReclaimer->PendingMapPoints() << " " << pReclaimer->PendingKeyFrames() << " "
+			<< pReclaimer->FreedMapPoints() << " " << pReclaimer->FreedKeyFrames() << " "
+			<< setprecision(5) << GetResidentMemoryMB() << endl;
 
 		// Wait to load the next frame
 		double T = 0;
 		if (ni < nImages - 1)
-			T = timestamps[ni + 1] - tframe;
+			T = timestamps[ni + 1] - timestamps[ni];
 		else if (ni > 0)
-			T = tframe - timestamps[ni - 1];
+			T = timestamps[ni] - timestamps[ni - 1];
 		//std::this_thread::sleep_for(std::chrono::milliseconds(30));
 
-		if (ttrack < T)
+		if (live)
+			std::this_thread::sleep_for(std::chrono::duration<double>(T));
+		else if (ttrack < T)
 			std::this_thread::sleep_for(std::chrono::milliseconds(
 			static_cast<long>((T - ttrack))));
 	}
 
+	if (pendingPose.valid())
+		pendingPose.get();
+
 	// Stop all threads
 	MultiSLAM.Shutdown();
+	fMemory.close();
 
 	// Tracking time statistics
+	const int nFrames = nImages * nrLoops;
 	sort(vTimesTrack.begin(), vTimesTrack.end());
 	float totaltime = 0;
-	for (int ni = 0; ni<nImages; ni++)
+	for (int ni = 0; ni<nFrames; ni++)
 	{
 		totaltime += vTimesTrack[ni];
 	}
 	cout << "-------" << endl << endl;
-	cout << "median tracking time: " << vTimesTrack[nImages / 2] << endl;
-	cout << "mean tracking time: " << totaltime / nImages << endl;
+	cout << "median tracking time: " << vTimesTrack[nFrames / 2] << endl;
+	cout << "mean tracking time: " << totaltime / nFrames << endl;
+	if (live)
+	{
+		MultiColSLAM::cTrackingPipeline::sPoseResult result;
+		while (MultiSLAM.PollPose(result))
+			if (!result.bTracked)
+				++nrPolledLost;
+		MultiColSLAM::cTrackingPipeline::sIngestionStats stats = MultiSLAM.GetIngestionStats();
+		cout << "submitted frames: " << stats.nSubmitted << " dropped: " << stats.nDropped <<
+			" tracked: " << stats.nProcessed << " max queue depth: " << stats.nMaxQueueDepth <<
+			" lost or not initialized: " << nrPolledLost << endl;
+	}
+	cout << "freed map points: " << pMap->GetReclaimer()->FreedMapPoints() <<
+		" freed keyframes: " << pMap->GetReclaimer()->FreedKeyFrames() << endl;
+	cout << "map point pool: " << MultiColSLAM::cMapPoint::GetPool().NrLive() << " / " <<
+		MultiColSLAM::cMapPoint::GetPool().Capacity() << " slots in " <<
+		MultiColSLAM::cMapPoint::GetPool().NrSlabs() << " slabs" << endl;
+	cout << "keyframe pool: " << MultiColSLAM::cMultiKeyFrame::GetPool().NrLive() << " / " <<
+		MultiColSLAM::cMultiKeyFrame::GetPool().Capacity() << " slots in " <<
+		MultiColSLAM::cMultiKeyFrame::GetPool().NrSlabs() << " slabs" << endl;
 
 	// Save camera trajectory
 	MultiSLAM.SaveMKFTrajectoryLAFIDA("MKFTrajectory.txt");
@@ -196,4 +275,16 @@ void LoadImagesAndTimestamps(const int startFrame,
 		++cnt;
 
 	}
-}
\ No newline at end of file
+}
+
+double GetResidentMemoryMB()
+{
+#ifdef __linux__
+	// second entry of statm is the resident set size in pages
+	ifstream fStatm("/proc/self/statm");
+	long nPages = 0, nResidentPages = 0;
+	if (fStatm >> nPages >> nResidentPages)
+		return nResidentPages * (sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+#endif
+	return -1.0;
+}
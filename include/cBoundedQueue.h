@@ -0,0 +1,134 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace MultiColSLAM
+{
+	// FIFO queue with a fixed capacity to hand work from one thread to the next.
+	// Push blocks while the queue is full, Pop while it is empty.
+	// TryPush and PushEvictOldest never block, they drop a new or an old element instead.
+	// After Close() nothing can be pushed anymore and Pop returns
+	// the remaining elements before it fails.
+	template<class T>
+	class cBoundedQueue
+	{
+	public:
+		explicit cBoundedQueue(const size_t& capacity) :
+			mnCapacity(capacity > 0 ? capacity : 1), mbClosed(false) {}
+
+		// returns false if the queue was closed, the element is left untouched then
+		bool Push(T&& elem)
+		{
+			std::unique_lock<std::mutex> lock(mMutexQueue);
+			mCondNotFull.wait(lock, [this] { return mbClosed || mqElems.size() < mnCapacity; });
+			if (mbClosed)
+				return false;
+			mqElems.push_back(std::move(elem));
+			lock.unlock();
+			mCondNotEmpty.notify_one();
+			return true;
+		}
+
+		// never blocks, returns false if the queue is full or closed,
+		// the element is left untouched then
+		bool TryPush(T&& elem)
+		{
+			std::unique_lock<std::mutex> lock(mMutexQueue);
+			if (mbClosed || mqElems.size() >= mnCapacity)
+				return false;
+			mqElems.push_back(std::move(elem));
+			lock.unlock();
+			mCondNotEmpty.notify_one();
+			return true;
+		}
+
+		// never blocks, makes room by taking out the oldest element if the queue is full.
+		// bEvicted tells if that happened, the oldest element is then in evicted.
+		// returns false if the queue was closed
+		bool PushEvictOldest(T&& elem, T& evicted, bool& bEvicted)
+		{
+			std::unique_lock<std::mutex> lock(mMutexQueue);
+			bEvicted = false;
+			if (mbClosed)
+				return false;
+			if (mqElems.size() >= mnCapacity)
+			{
+				evicted = std::move(mqElems.front());
+				mqElems.pop_front();
+				bEvicted = true;
+			}
+			mqElems.push_back(std::move(elem));
+			lock.unlock();
+			mCondNotEmpty.notify_one();
+			return true;
+		}
+
+		// returns false if the queue is closed and empty
+		bool Pop(T& elem)
+		{
+			std::unique_lock<std::mutex> lock(mMutexQueue);
+			mCondNotEmpty.wait(lock, [this] { return mbClosed || !mqElems.empty(); });
+			if (mqElems.empty())
+				return false;
+			elem = std::move(mqElems.front());
+			mqElems.pop_front();
+			lock.unlock();
+			mCondNotFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mMutexQueue);
+				mbClosed = true;
+			}
+			mCondNotFull.notify_all();
+			mCondNotEmpty.notify_all();
+		}
+
+		size_t Size()
+		{
+			std::unique_lock<std::mutex> lock(mMutexQueue);
+			return mqElems.size();
+		}
+
+		size_t Capacity() const { return mnCapacity; }
+
+	private:
+		cBoundedQueue(const cBoundedQueue&);
+		cBoundedQueue& operator=(const cBoundedQueue&);
+
+		std::mutex mMutexQueue;
+		std::condition_variable mCondNotFull;
+		std::condition_variable mCondNotEmpty;
+		std::deque<T> mqElems;
+		const size_t mnCapacity;
+		bool mbClosed;
+	};
+}
+#endif // BOUNDEDQUEUE_H
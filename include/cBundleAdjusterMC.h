@@ -0,0 +1,191 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BUNDLEADJUSTERMC_H
+#define BUNDLEADJUSTERMC_H
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+#include "cam_model_omni.h"
+#include "cam_system_omni.h"
+#include "g2o_MultiCol_vertices_edges.h"
+
+namespace MultiColSLAM
+{
+	// Bundle adjustment of MCS poses and points for a rig with fixed Mc and
+	// interior orientation. Same model as EdgeProjectXYZ2MCS and the same
+	// Levenberg-Marquardt scheme as g2o::OptimizationAlgorithmLevenberg, but only
+	// pose and point blocks: the points are eliminated with the Schur complement
+	// and the reduced camera system is solved densely.
+	// The observations are kept as structure of arrays, so the residual,
+	// weight and Jacobian passes walk linearly through memory.
+	// In mixed precision the Jacobians are evaluated and stored in float, one
+	// camera and pose at a time and vectorized over the observations. The normal
+	// equations are still accumulated and solved in double, and the residuals
+	// that decide on the steps and the outliers stay double as well: a float
+	// cost could not resolve the gain threshold.
+	// Self calibration (free Mc or interior orientation) needs the g2o graph.
+	class cBundleAdjusterMC
+	{
+	public:
+		cBundleAdjusterMC();
+
+		// rig of all poses, Mc and the camera models are kept fixed
+		void SetCameraSystem(cMultiCamSys_& camSystem);
+
+		// returns the index of the pose/point/observation
+		int AddPose(const cv::Matx61d& Mt, const bool& fixed);
+		int AddPoint(const cv::Vec3d& pt3);
+		int AddObservation(const int& pose, const int& point, const int& cam,
+			const double& u, const double& v, const double& invSigma2);
+
+		// inactive observations are ignored by Optimize, like edges on level 1
+		void SetActive(const int& obs, const bool& active) { mvbActive[obs] = active; }
+		bool IsActive(const int& obs) const { return mvbActive[obs] != 0; }
+
+		// Huber threshold on the whitened error, like g2o::RobustKernelHuber::setDelta
+		void SetHuberDelta(const double& delta) { mdHuberDelta = delta; }
+		// OpenMP threads for the residuals and Jacobians
+		void SetNrThreads(const int& nThreads) { mnThreads = nThreads; }
+		// Optimize stops once the relative decrease of the cost falls below it
+		void SetGainThreshold(const double& threshold) { mdGainThreshold = threshold; }
+		void SetMixedPrecision(const bool& mixed) { mbMixedPrecision = mixed; }
+
+		// returns the number of iterations done, -1 if no step could be computed
+		int Optimize(const int& nIterations, bool* pbStopFlag = NULL);
+
+		// chi2 of an observation at the current estimate (after Optimize or ComputeErrors)
+		double Chi2(const int& obs) const;
+		// robust cost of all active observations at the current estimate
+		double RobustChi2() const;
+		void ComputeErrors();
+
+		const cv::Matx61d& GetPose(const int& pose) const { return mvPoses[pose]; }
+		cv::Vec3d GetPoint(const int& point) const;
+
+		int NrPoses() const { return static_cast<int>(mvPoses.size()); }
+		int NrPoints() const { return static_cast<int>(mvPoints.size()) / 3; }
+		int NrObservations() const { return static_cast<int>(mvObsPose.size()); }
+
+		void Clear();
+
+	protected:
+		typedef Eigen::Matrix<double, 6, 6> Mat66;
+		typedef Eigen::Matrix<double, 6, 3> Mat63;
+		typedef Eigen::Matrix<double, 3, 3> Mat33;
+
+		void UpdateTransforms();
+		// errors, Huber weights and Jacobians of all active observations
+		void Linearize();
+		// float Jacobians of all observations, see SetMixedPrecision. They are
+		// computed by run and then stored by observation, so BuildBlocks and
+		// every damping trial of SolveDamped read them contiguously
+		void LinearizeMixed();
+		// Jacobians of an observation from Linearize, in double in both modes
+		Eigen::Matrix<double, 2, 6> JacPose(const int& obs) const;
+		Eigen::Matrix<double, 2, 3> JacPoint(const int& obs) const;
+		// normal equations of the pose and point blocks, without damping,
+		// and the Hpl block of every observation
+		void BuildBlocks();
+		// damped Schur complement, solves for the pose and point increments
+		bool SolveDamped(const double& lambda);
+		// sorts the observations by point for the elimination
+		void BuildPointIndex();
+		// sorts the observations by camera and pose for LinearizeMixed
+		void BuildRunIndex();
+
+		// rig
+		int mnCams;
+		std::vector<cCamModelGeneral_> mvCamModels;
+		std::vector<Eigen::Matrix<double, 12 + 5, 1>,
+			Eigen::aligned_allocator<Eigen::Matrix<double, 12 + 5, 1> > > mvCamModelData;
+		std::vector<sCayleyTransform> mvMcTransforms;
+
+		// poses
+		std::vector<cv::Matx61d> mvPoses;
+		std::vector<int> mvPoseFreeIdx;
+		// rotation, translation and rotation derivatives of every pose
+		std::vector<sCayleyTransform> mvPoseTransforms;
+		int mnFreePoses;
+
+		// points, x y z interleaved
+		std::vector<double> mvPoints;
+
+		// observations
+		std::vector<int> mvObsPose;
+		std::vector<int> mvObsPoint;
+		std::vector<int> mvObsCam;
+		std::vector<double> mvObsU;
+		std::vector<double> mvObsV;
+		std::vector<double> mvObsInvSigma2;
+		std::vector<char> mvbActive;
+		// current error (2), weight and Jacobians d error / d pose (2x6) and d error / d point (2x3)
+		std::vector<double> mvErr;
+		std::vector<double> mvWeight;
+		std::vector<double> mvJacPose;
+		std::vector<double> mvJacPoint;
+		// the Jacobians in mixed precision, same layout as mvJacPose and mvJacPoint
+		std::vector<float> mvJacPoseF;
+		std::vector<float> mvJacPointF;
+		// as computed by LinearizeMixed, one array per entry in the order of mvRunObs:
+		// entry m of the observation in slot k is at m * NrObservations() + k
+		std::vector<float> mvJacPoseRunF;
+		std::vector<float> mvJacPointRunF;
+		// Rt^T, the dRt^T and the translation of every pose (39 per pose)
+		// and the points in float for LinearizeMixed
+		std::vector<float> mvPoseDataF;
+		std::vector<float> mvPointsF;
+
+		// observations of point j are mvPointObs[mvPointObsStart[j] .. mvPointObsStart[j + 1]]
+		std::vector<int> mvPointObsStart;
+		std::vector<int> mvPointObs;
+		// observations of camera c and pose p are mvRunObs[mvRunStart[q] .. mvRunStart[q + 1]]
+		// with q = c * NrPoses() + p
+		std::vector<int> mvRunStart;
+		std::vector<int> mvRunObs;
+
+		// normal equations, H dx = -g
+		std::vector<Mat66, Eigen::aligned_allocator<Mat66> > mvHpp;
+		std::vector<Mat33, Eigen::aligned_allocator<Mat33> > mvHll;
+		std::vector<Eigen::Matrix<double, 6, 1>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 1> > > mvGp;
+		std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > mvGl;
+		// w Jp^T Jl of every active observation of a free pose, the damping does
+		// not change it, so SolveDamped does not need the Jacobians
+		std::vector<Mat63, Eigen::aligned_allocator<Mat63> > mvHpl;
+		// damped and inverted point blocks of the last solve
+		std::vector<Mat33, Eigen::aligned_allocator<Mat33> > mvHllInv;
+		// increments of the last solve
+		Eigen::VectorXd mDeltaPoses;
+		std::vector<double> mvDeltaPoints;
+		// reduced camera system
+		Eigen::MatrixXd mS;
+		Eigen::VectorXd mRhs;
+
+		double mdHuberDelta;
+		double mdGainThreshold;
+		int mnThreads;
+		bool mbMixedPrecision;
+	};
+}
+#endif // BUNDLEADJUSTERMC_H
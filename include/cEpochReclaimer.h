@@ -0,0 +1,88 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EPOCHRECLAIMER_H
+#define EPOCHRECLAIMER_H
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <utility>
+
+namespace MultiColSLAM
+{
+	class cMapPoint;
+	class cMultiKeyFrame;
+
+	// Deferred reclamation of bad map points and keyframes
+	// (quiescent state based, a flavour of epoch based reclamation).
+	// An object is retired once it has been unlinked from the map. It is deleted
+	// as soon as every registered thread went through a quiescent state after
+	// the retirement, i.e. no thread can still hold a pointer to it.
+	// A thread is quiescent if it does not hold pointers obtained earlier,
+	// except in its own containers which it cleans from bad objects right before
+	// announcing the quiescent state.
+	class cEpochReclaimer
+	{
+	public:
+		cEpochReclaimer();
+		~cEpochReclaimer();
+
+		// returns the id that has to be passed to QuiescentState
+		int RegisterThread();
+		void UnregisterThread(const int& threadId);
+
+		// call this once per loop iteration, after the thread dropped
+		// all its references to bad objects
+		void QuiescentState(const int& threadId);
+
+		void Retire(cMapPoint* pMP);
+		void Retire(cMultiKeyFrame* pKF);
+
+		// deletes everything that was retired (only safe if the threads
+		// do not touch the map, e.g. during a reset)
+		void Flush();
+
+		// memory statistics
+		size_t PendingMapPoints();
+		size_t PendingKeyFrames();
+		unsigned long FreedMapPoints();
+		unsigned long FreedKeyFrames();
+
+	protected:
+		void Reclaim();
+
+		std::mutex mMutexEpoch;
+
+		unsigned long mnGlobalEpoch;
+		// the epoch each thread announced, objects retired before it are safe for this thread
+		std::vector<unsigned long> mvSafeEpochs;
+		// the epoch seen at the last quiescent state, announced with the next one
+		std::vector<unsigned long> mvSeenEpochs;
+		std::vector<bool> mvbRegistered;
+
+		std::deque<std::pair<unsigned long, cMapPoint*> > mdRetiredMapPoints;
+		std::deque<std::pair<unsigned long, cMultiKeyFrame*> > mdRetiredKeyFrames;
+
+		unsigned long mnFreedMapPoints;
+		unsigned long mnFreedKeyFrames;
+	};
+}
+#endif // EPOCHRECLAIMER_H
@@ -0,0 +1,128 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GLOBALBA_H
+#define GLOBALBA_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>
+
+#include "g2o/core/sparse_optimizer.h"
+
+#include "cMap.h"
+
+namespace MultiColSLAM
+{
+	// Global bundle adjustment as a background job.
+	// Start() snapshots the map in a new thread and builds the g2o graph from it
+	// (see cOptimizer::SetupBundleAdjustment), the optimization then runs
+	// without touching the map, so tracking and local mapping continue.
+	// The result is merged by the local mapping thread between two keyframes
+	// (MergeIfDone): optimized keyframes and points get their new estimate,
+	// keyframes created in the meantime are corrected along the spanning tree
+	// like their parent, new points like their reference keyframe.
+	// Cancel() stops the optimization after the current iteration, the graph
+	// can be kept and the optimization continued later with Resume().
+	class cGlobalBA
+	{
+	public:
+		enum eState
+		{
+			IDLE = 0,
+			RUNNING,
+			// stopped by Cancel(true), can be resumed
+			INTERRUPTED,
+			// optimized, waiting for MergeIfDone
+			DONE
+		};
+
+		struct sStats
+		{
+			double setupMs;
+			double optimizationMs;
+			double mergeMs;
+			int nIterations;
+			int nKeyFrames;
+			int nMapPoints;
+			// corrected along the spanning tree or by their reference keyframe
+			int nPropagatedKeyFrames;
+			int nPropagatedMapPoints;
+		};
+
+		cGlobalBA(cMap* pMap);
+		~cGlobalBA();
+
+		// cancels and drops a job that is running or interrupted
+		void Start(const int& nIterations);
+		// waits until the optimization stopped. With bKeep the
+		// graph is kept for Resume, otherwise it is dropped
+		void Cancel(const bool& bKeep = false);
+		// continues an interrupted job with its remaining iterations
+		bool Resume();
+
+		// called by local mapping at a safe point, returns true if a result was merged
+		bool MergeIfDone();
+
+		eState GetState();
+		// iterations done / iterations requested of the current job
+		double Progress();
+		// of the last merged job
+		sStats GetLastStats();
+		int NrMerged();
+
+	protected:
+		void Run(const bool bSetup);
+		void Merge();
+		void Join();
+
+		cMap* mpMap;
+
+		// serializes Start, Cancel, Resume and MergeIfDone
+		std::mutex mMutexControl;
+		std::mutex mMutexState;
+		eState meState;
+		std::thread* mpThread;
+
+		// g2o stops on it. Only written by the job thread (post iteration action)
+		// or while no job thread runs, Cancel() only sets mbCancel
+		bool mbStopFlag;
+		std::atomic<bool> mbCancel;
+		std::atomic<int> mnIterationsDone;
+		int mnIterations;
+
+		g2o::SparseOptimizer* mpOptimizer;
+		std::unordered_map<long unsigned int, int> mmMPIdToVertex;
+		// keyframe ids, the pointers are only valid while setting up
+		std::vector<long unsigned int> mvKFIds;
+
+		// results of the optimization, by id
+		std::unordered_map<long unsigned int, cv::Matx44d> mmKFPoses;
+		std::unordered_map<long unsigned int, cv::Vec3d> mmMPPositions;
+
+		sStats mCurrentStats;
+		sStats mLastStats;
+		int mnMerged;
+	};
+}
+#endif // GLOBALBA_H
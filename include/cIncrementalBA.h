@@ -0,0 +1,215 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCREMENTALBA_H
+#define INCREMENTALBA_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+#include "cMultiKeyFrame.h"
+#include "cMapPoint.h"
+#include "g2o_MultiCol_vertices_edges.h"
+
+namespace MultiColSLAM
+{
+	// Incremental smoothing backend in the spirit of iSAM2, an alternative to
+	// solving the local BA from scratch after every keyframe.
+	// The problem (poses, points and observations of the local window) is kept
+	// between keyframes. Every variable has a linearization point and a delta,
+	// the estimate is the sum of both. Observations keep their linearization
+	// (Jacobians, error, Huber weight) and every point keeps its Schur
+	// complement contribution to the reduced camera system. An update only
+	//  - linearizes new observations and the ones of relinearized variables,
+	//  - eliminates the points whose observations changed,
+	//  - solves the (small, dense) reduced camera system,
+	//  - back substitutes the points whose poses moved noticeably (wildfire),
+	//  - relinearizes the variables whose delta is above a threshold
+	//    (fluid relinearization) and repeats at most nMaxIterations times.
+	// A step is only kept if it lowers the robust cost at the estimate, otherwise
+	// it is undone and solved again with Marquardt damping (LM). The damping is
+	// dropped at the next update, without it the eliminations stay incremental.
+	// Mc and the interior orientation are fixed, same model as EdgeProjectXYZ2MCS.
+	// Keyframes and points are identified by their ids, their pointers are only
+	// used during an update. Only used by the local mapping thread.
+	class cIncrementalBA
+	{
+	public:
+		cIncrementalBA();
+
+		// brings the problem up to date with the local window of pKF (see
+		// cOptimizer::CollectLocalWindow), solves it and writes the result to the map.
+		// Returns the number of observations removed as outliers
+		int Update(cMultiKeyFrame* pKF,
+			const std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+			const std::list<cMultiKeyFrame*>& lFixedCameras,
+			const std::list<cMapPoint*>& lLocalMapPoints,
+			bool* pbStopFlag = NULL);
+
+		void Clear();
+
+		// Huber threshold on the whitened error
+		void SetHuberDelta(const double& delta) { mdHuberDelta = delta; }
+		// largest delta (Cayley parameters, translation, point coordinates)
+		// a variable may have before it is relinearized
+		void SetRelinearizeThreshold(const double& th) { mdRelinearizeThreshold = th; }
+		void SetMaxIterations(const int& nIterations) { mnMaxIterations = nIterations; }
+		void SetNrThreads(const int& nThreads) { mnThreads = nThreads; }
+
+		// statistics of the last update
+		int NrRelinearized() const { return mnRelinearized; }
+		int NrEliminated() const { return mnEliminated; }
+		int NrFactors() const { return mnActiveFactors; }
+		int NrPoints() const { return mnActivePoints; }
+		int NrRejected() const { return mnRejected; }
+
+	protected:
+		typedef Eigen::Matrix<double, 6, 1> Vec6;
+		typedef Eigen::Matrix<double, 6, 6> Mat66;
+		typedef Eigen::Matrix<double, 6, 3> Mat63;
+
+		struct sPose
+		{
+			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+			long unsigned int nKFId;
+			cMultiKeyFrame* pKF;
+			cv::Matx61d linPoint;
+			// transform of linPoint, set together with it
+			sCayleyTransform linTransform;
+			Vec6 delta;
+			unsigned long nUpdate;
+			int nFreeIdx;
+			bool bUsed;
+			bool bFree;
+			bool bRelinearize;
+			// the delta changed noticeably in the last solve
+			bool bChanged;
+		};
+
+		struct sPoint
+		{
+			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+			long unsigned int nMPId;
+			cMapPoint* pMP;
+			Eigen::Vector3d linPoint;
+			Eigen::Vector3d delta;
+			std::vector<int> vFactors;
+			unsigned long nUpdate;
+			bool bUsed;
+			bool bRelinearize;
+			// the observations changed, has to be eliminated again
+			bool bAffected;
+			bool bMoved;
+			// elimination: inverse point block, gradient and the
+			// contributions to the reduced system by pose slot
+			Eigen::Matrix3d HllInv;
+			Eigen::Vector3d gl;
+			std::vector<int> vBlockRows;
+			std::vector<int> vBlockCols;
+			std::vector<Mat66, Eigen::aligned_allocator<Mat66> > vBlocks;
+			std::vector<int> vRhsRows;
+			std::vector<Vec6, Eigen::aligned_allocator<Vec6> > vRhs;
+		};
+
+		struct sFactor
+		{
+			EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+			int nPose;
+			int nPoint;
+			int nCam;
+			long unsigned int nKFId;
+			size_t nObsIdx;
+			double u;
+			double v;
+			double invSigma2;
+			unsigned long nUpdate;
+			bool bUsed;
+			bool bLinearized;
+			// linearization at the linearization points of the pose and the point
+			Eigen::Matrix<double, 2, 6> Jp;
+			Eigen::Matrix<double, 2, 3> Jl;
+			Eigen::Vector2d e;
+			double w;
+		};
+
+		void SetCameraSystem(cMultiCamSys_& camSystem);
+		int SyncPose(cMultiKeyFrame* pKF, const bool& bFree);
+		int SyncPoint(cMapPoint* pMP);
+		void SyncFactor(const int& point, const int& pose, cMultiKeyFrame* pKF,
+			const size_t& obsIdx);
+		void RemoveFactor(const int& factor);
+		void RemoveStale();
+
+		void LinearizeFactor(sFactor& f) const;
+		void EliminatePoint(sPoint& pt) const;
+		bool SolveReduced();
+		void BackSubstitute(sPoint& pt) const;
+		// Huber cost of all observations at the estimate
+		double RobustCost() const;
+		// fluid relinearization, returns the number of relinearized variables
+		int MarkRelinearization();
+		int RemoveOutliers();
+		void WriteBack(const std::list<cMultiKeyFrame*>& lLocalKeyFrames);
+
+		cv::Matx61d PoseEstimate(const sPose& pose) const;
+
+		// rig
+		int mnCams;
+		std::vector<cCamModelGeneral_> mvCamModels;
+		std::vector<Eigen::Matrix<double, 12 + 5, 1>,
+			Eigen::aligned_allocator<Eigen::Matrix<double, 12 + 5, 1> > > mvCamModelData;
+		std::vector<sCayleyTransform> mvMcTransforms;
+
+		// slots, reused through the free lists
+		std::vector<sPose, Eigen::aligned_allocator<sPose> > mvPoses;
+		std::vector<sPoint, Eigen::aligned_allocator<sPoint> > mvPoints;
+		std::vector<sFactor, Eigen::aligned_allocator<sFactor> > mvFactors;
+		std::vector<int> mvFreePoses;
+		std::vector<int> mvFreePoints;
+		std::vector<int> mvFreeFactors;
+		std::unordered_map<long unsigned int, int> mmKFIdToPose;
+		std::unordered_map<long unsigned int, int> mmMPIdToPoint;
+
+		// reduced camera system of the free poses
+		Eigen::MatrixXd mS;
+		Eigen::VectorXd mRhs;
+		int mnFreePoses;
+
+		unsigned long mnUpdate;
+		double mdHuberDelta;
+		double mdRelinearizeThreshold;
+		int mnMaxIterations;
+		int mnThreads;
+		// Marquardt damping of the diagonal, 0 is Gauss-Newton
+		double mdLambda;
+
+		int mnRelinearized;
+		int mnEliminated;
+		int mnActiveFactors;
+		int mnActivePoints;
+		int mnRejected;
+	};
+}
+#endif // INCREMENTALBA_H
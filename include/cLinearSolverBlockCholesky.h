@@ -0,0 +1,246 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LINEARSOLVERBLOCKCHOLESKY_H
+#define LINEARSOLVERBLOCKCHOLESKY_H
+
+#include <algorithm>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/OrderingMethods>
+#include <Eigen/SparseCore>
+#include <Eigen/StdVector>
+
+#include "g2o/core/linear_solver.h"
+
+namespace MultiColSLAM
+{
+	// Sparse Cholesky on the blocks of the system instead of the scalars
+	// (supernodes of the size of one vertex), for pose graphs where every
+	// vertex has the same (small) dimension.
+	// The fill reducing ordering (AMD on the block pattern), the elimination tree
+	// and the pattern of L are computed once per optimization (init) and reused
+	// in every iteration, only the numeric factorization is repeated.
+	// It works with dense fixed size blocks, so the inner loops are small
+	// matrix products Eigen unrolls, instead of the scalar loops of a simplicial
+	// factorization. Only the upper triangle of A is read (g2o convention).
+	template <typename MatrixType>
+	class cLinearSolverBlockCholesky : public g2o::LinearSolver<MatrixType>
+	{
+	public:
+		typedef g2o::SparseBlockMatrix<MatrixType> BlockMatrix;
+		typedef Eigen::Matrix<double, MatrixType::RowsAtCompileTime, 1> BlockVector;
+
+		cLinearSolverBlockCholesky() : mbInit(true), mnBlocks(0) {}
+
+		virtual bool init()
+		{
+			mbInit = true;
+			return true;
+		}
+
+		virtual bool solve(const BlockMatrix& A, double* x, double* b)
+		{
+			if (mbInit)
+				ComputeSymbolic(A);
+			mbInit = false;
+
+			if (!Factorize(A))
+				return false;
+
+			// x = P^T L^-T L^-1 P b
+			std::vector<BlockVector, Eigen::aligned_allocator<BlockVector> > y(mnBlocks);
+			for (int k = 0; k < mnBlocks; ++k)
+			{
+				const int old = mvNewToOld[k];
+				y[k] = Eigen::Map<const BlockVector>(b + A.rowBaseOfBlock(old), A.rowsOfBlock(old));
+			}
+			for (int j = 0; j < mnBlocks; ++j)
+			{
+				mvDiag[j].template triangularView<Eigen::Lower>().solveInPlace(y[j]);
+				for (int p = mvColStart[j]; p < mvColStart[j + 1]; ++p)
+					y[mvRowIdx[p]].noalias() -= mvBlocks[p] * y[j];
+			}
+			for (int j = mnBlocks - 1; j >= 0; --j)
+			{
+				for (int p = mvColStart[j]; p < mvColStart[j + 1]; ++p)
+					y[j].noalias() -= mvBlocks[p].transpose() * y[mvRowIdx[p]];
+				mvDiag[j].transpose().template triangularView<Eigen::Upper>().solveInPlace(y[j]);
+			}
+			for (int k = 0; k < mnBlocks; ++k)
+			{
+				const int old = mvNewToOld[k];
+				Eigen::Map<BlockVector>(x + A.rowBaseOfBlock(old), A.rowsOfBlock(old)) = y[k];
+			}
+			return true;
+		}
+
+	protected:
+		void ComputeSymbolic(const BlockMatrix& A)
+		{
+			mnBlocks = static_cast<int>(A.blockCols().size());
+
+			// AMD on the block pattern, perm(new) = old as in Eigen's SimplicialLDLT
+			std::vector<Eigen::Triplet<double> > triplets;
+			for (int c = 0; c < mnBlocks; ++c)
+			{
+				const typename BlockMatrix::IntBlockMap& column = A.blockCols()[c];
+				for (typename BlockMatrix::IntBlockMap::const_iterator it = column.begin(); it != column.end(); ++it)
+				{
+					if (it->first > c)
+						break;
+					triplets.push_back(Eigen::Triplet<double>(it->first, c, 1.0));
+					triplets.push_back(Eigen::Triplet<double>(c, it->first, 1.0));
+				}
+			}
+			Eigen::SparseMatrix<double, Eigen::ColMajor, int> pattern(mnBlocks, mnBlocks);
+			pattern.setFromTriplets(triplets.begin(), triplets.end());
+			Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm;
+			Eigen::AMDOrdering<int> ordering;
+			ordering(pattern, perm);
+			mvNewToOld.assign(perm.indices().data(), perm.indices().data() + mnBlocks);
+			mvOldToNew.resize(mnBlocks);
+			for (int k = 0; k < mnBlocks; ++k)
+				mvOldToNew[mvNewToOld[k]] = k;
+
+			// pattern of L column by column, the structure of a column is
+			// passed on to its parent in the elimination tree
+			std::vector<std::vector<int> > vColumns(mnBlocks);
+			for (int c = 0; c < mnBlocks; ++c)
+			{
+				const typename BlockMatrix::IntBlockMap& column = A.blockCols()[c];
+				for (typename BlockMatrix::IntBlockMap::const_iterator it = column.begin(); it != column.end(); ++it)
+				{
+					if (it->first >= c)
+						break;
+					const int i = mvOldToNew[it->first];
+					const int j = mvOldToNew[c];
+					vColumns[std::min(i, j)].push_back(std::max(i, j));
+				}
+			}
+			for (int j = 0; j < mnBlocks; ++j)
+			{
+				std::vector<int>& col = vColumns[j];
+				std::sort(col.begin(), col.end());
+				col.erase(std::unique(col.begin(), col.end()), col.end());
+				if (col.empty())
+					continue;
+				std::vector<int>& parentCol = vColumns[col[0]];
+				parentCol.insert(parentCol.end(), col.begin() + 1, col.end());
+			}
+
+			mvColStart.assign(mnBlocks + 1, 0);
+			for (int j = 0; j < mnBlocks; ++j)
+				mvColStart[j + 1] = mvColStart[j] + static_cast<int>(vColumns[j].size());
+			mvRowIdx.resize(mvColStart[mnBlocks]);
+			for (int j = 0; j < mnBlocks; ++j)
+				std::copy(vColumns[j].begin(), vColumns[j].end(), mvRowIdx.begin() + mvColStart[j]);
+
+			mvDiag.resize(mnBlocks);
+			mvBlocks.resize(mvRowIdx.size());
+			for (int j = 0; j < mnBlocks; ++j)
+			{
+				const int n = A.rowsOfBlock(mvNewToOld[j]);
+				mvDiag[j].resize(n, n);
+				for (int p = mvColStart[j]; p < mvColStart[j + 1]; ++p)
+					mvBlocks[p].resize(A.rowsOfBlock(mvNewToOld[mvRowIdx[p]]), n);
+			}
+		}
+
+		// position of block (i, j), i > j, in the storage of column j
+		int Find(const int& i, const int& j) const
+		{
+			const std::vector<int>::const_iterator first = mvRowIdx.begin() + mvColStart[j];
+			const std::vector<int>::const_iterator last = mvRowIdx.begin() + mvColStart[j + 1];
+			return static_cast<int>(std::lower_bound(first, last, i) - mvRowIdx.begin());
+		}
+
+		// right looking block LL^T, in place
+		bool Factorize(const BlockMatrix& A)
+		{
+			for (int j = 0; j < mnBlocks; ++j)
+			{
+				mvDiag[j].setZero();
+				for (int p = mvColStart[j]; p < mvColStart[j + 1]; ++p)
+					mvBlocks[p].setZero();
+			}
+			for (int c = 0; c < mnBlocks; ++c)
+			{
+				const typename BlockMatrix::IntBlockMap& column = A.blockCols()[c];
+				for (typename BlockMatrix::IntBlockMap::const_iterator it = column.begin(); it != column.end(); ++it)
+				{
+					if (it->first > c)
+						break;
+					const int i = mvOldToNew[it->first];
+					const int j = mvOldToNew[c];
+					if (i == j)
+						mvDiag[j] = *it->second;
+					// lower triangle of the permuted matrix
+					else if (i > j)
+						mvBlocks[Find(i, j)] = *it->second;
+					else
+						mvBlocks[Find(j, i)] = it->second->transpose();
+				}
+			}
+
+			for (int j = 0; j < mnBlocks; ++j)
+			{
+				// only the lower triangle of the diagonal blocks is up to date
+				Eigen::LLT<MatrixType, Eigen::Lower> llt(mvDiag[j]);
+				if (llt.info() != Eigen::Success)
+					return false;
+				mvDiag[j] = llt.matrixL();
+				// L_ij = A_ij L_jj^-T
+				for (int p = mvColStart[j]; p < mvColStart[j + 1]; ++p)
+					mvDiag[j].transpose().template triangularView<Eigen::Upper>().
+						template solveInPlace<Eigen::OnTheRight>(mvBlocks[p]);
+				// A_ik -= L_ij L_kj^T for the rows i >= k of column j
+				for (int q = mvColStart[j]; q < mvColStart[j + 1]; ++q)
+				{
+					const int k = mvRowIdx[q];
+					mvDiag[k].noalias() -= mvBlocks[q] * mvBlocks[q].transpose();
+					int target = mvColStart[k];
+					for (int p = q + 1; p < mvColStart[j + 1]; ++p)
+					{
+						const int i = mvRowIdx[p];
+						// the rows of both columns are sorted
+						while (mvRowIdx[target] < i)
+							++target;
+						mvBlocks[target].noalias() -= mvBlocks[p] * mvBlocks[q].transpose();
+					}
+				}
+			}
+			return true;
+		}
+
+		bool mbInit;
+		int mnBlocks;
+		std::vector<int> mvNewToOld;
+		std::vector<int> mvOldToNew;
+		// L in block compressed columns, the rows of a column are sorted
+		std::vector<int> mvColStart;
+		std::vector<int> mvRowIdx;
+		std::vector<MatrixType, Eigen::aligned_allocator<MatrixType> > mvDiag;
+		std::vector<MatrixType, Eigen::aligned_allocator<MatrixType> > mvBlocks;
+	};
+}
+#endif // LINEARSOLVERBLOCKCHOLESKY_H
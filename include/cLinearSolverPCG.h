@@ -0,0 +1,191 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LINEARSOLVERPCG_H
+#define LINEARSOLVERPCG_H
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/StdVector>
+
+#include "g2o/core/linear_solver.h"
+
+namespace MultiColSLAM
+{
+	// Conjugate gradients with a block Jacobi preconditioner (the inverse
+	// diagonal blocks of A), no factorization at all. Good enough for the
+	// Levenberg steps of a pose graph, which only need an approximate solution.
+	// The products with A run on nThreads OpenMP threads, row block by
+	// row block, so no two threads write the same entries.
+	// Only the upper triangle of A is read (g2o convention).
+	template <typename MatrixType>
+	class cLinearSolverPCG : public g2o::LinearSolver<MatrixType>
+	{
+	public:
+		typedef g2o::SparseBlockMatrix<MatrixType> BlockMatrix;
+
+		cLinearSolverPCG(const int& nThreads = 1) :
+			mbInit(true),
+			mnThreads(nThreads),
+			mdTolerance(1e-6),
+			mnMaxIterations(-1),
+			mnIterations(0)
+		{}
+
+		virtual bool init()
+		{
+			mbInit = true;
+			return true;
+		}
+
+		virtual bool solve(const BlockMatrix& A, double* x, double* b)
+		{
+			if (mbInit)
+				Index(A);
+			mbInit = false;
+
+			const int nBlocks = static_cast<int>(mvRowBase.size());
+			const int n = A.rows();
+			// preconditioner
+			for (int r = 0; r < nBlocks; ++r)
+			{
+				const MatrixType& D = *A.blockCols()[r].find(r)->second;
+				Eigen::LDLT<MatrixType> ldlt(D);
+				if (ldlt.info() != Eigen::Success)
+					return false;
+				mvDiagInv[r] = ldlt.solve(MatrixType::Identity(D.rows(), D.cols()));
+			}
+
+			Eigen::Map<const Eigen::VectorXd> bb(b, n);
+			Eigen::Map<Eigen::VectorXd> xx(x, n);
+			xx.setZero();
+			Eigen::VectorXd r = bb;
+			Eigen::VectorXd z(n), p(n), q(n);
+			ApplyPreconditioner(r, z);
+			p = z;
+			double rz = r.dot(z);
+			const double thRes = mdTolerance * mdTolerance * bb.squaredNorm();
+			const int maxIterations = mnMaxIterations > 0 ? mnMaxIterations : n;
+
+			mnIterations = 0;
+			while (mnIterations < maxIterations && r.squaredNorm() > thRes)
+			{
+				Multiply(A, p, q);
+				const double pq = p.dot(q);
+				if (!(pq > 0.0))
+					break;
+				const double alpha = rz / pq;
+				xx.noalias() += alpha * p;
+				r.noalias() -= alpha * q;
+				ApplyPreconditioner(r, z);
+				const double rzNew = r.dot(z);
+				p = z + (rzNew / rz) * p;
+				rz = rzNew;
+				++mnIterations;
+			}
+			return xx.allFinite();
+		}
+
+		// relative residual |b - Ax| / |b| to stop at
+		void SetTolerance(const double& tolerance) { mdTolerance = tolerance; }
+		// -1: the dimension of the system
+		void SetMaxIterations(const int& nIterations) { mnMaxIterations = nIterations; }
+		void SetNrThreads(const int& nThreads) { mnThreads = nThreads; }
+		// of the last solve
+		int NrIterations() const { return mnIterations; }
+
+	protected:
+		// for every row block the blocks left of the diagonal, they are stored
+		// transposed in the upper triangle. The pattern is the same until init
+		void Index(const BlockMatrix& A)
+		{
+			const int nBlocks = static_cast<int>(A.blockCols().size());
+			mvRowBase.resize(nBlocks);
+			mvRowSize.resize(nBlocks);
+			for (int r = 0; r < nBlocks; ++r)
+			{
+				mvRowBase[r] = A.rowBaseOfBlock(r);
+				mvRowSize[r] = A.rowsOfBlock(r);
+			}
+			mvDiagInv.resize(nBlocks);
+			mvUpperRows.assign(nBlocks, std::vector<std::pair<int, const MatrixType*> >());
+			for (int c = 0; c < nBlocks; ++c)
+			{
+				const typename BlockMatrix::IntBlockMap& column = A.blockCols()[c];
+				for (typename BlockMatrix::IntBlockMap::const_iterator it = column.begin(); it != column.end(); ++it)
+				{
+					if (it->first >= c)
+						break;
+					mvUpperRows[it->first].push_back(std::make_pair(c, it->second));
+				}
+			}
+		}
+
+		// q = A p, row block r gets column r (transposed, upper part) and
+		// the blocks right of the diagonal in row r
+		void Multiply(const BlockMatrix& A, const Eigen::VectorXd& p, Eigen::VectorXd& q) const
+		{
+			const int nBlocks = static_cast<int>(mvRowBase.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(mnThreads) if (mnThreads > 1)
+			for (int r = 0; r < nBlocks; ++r)
+			{
+				Eigen::VectorXd::SegmentReturnType qr = q.segment(mvRowBase[r], mvRowSize[r]);
+				qr.setZero();
+				const typename BlockMatrix::IntBlockMap& column = A.blockCols()[r];
+				for (typename BlockMatrix::IntBlockMap::const_iterator it = column.begin(); it != column.end(); ++it)
+				{
+					if (it->first > r)
+						break;
+					if (it->first == r)
+						qr.noalias() += (*it->second) * p.segment(mvRowBase[r], mvRowSize[r]);
+					else
+						qr.noalias() += it->second->transpose() * p.segment(mvRowBase[it->first], mvRowSize[it->first]);
+				}
+				// A(r, c) for c > r, stored in column c
+				const std::vector<std::pair<int, const MatrixType*> >& upper = mvUpperRows[r];
+				for (size_t k = 0; k < upper.size(); ++k)
+					qr.noalias() += (*upper[k].second) * p.segment(mvRowBase[upper[k].first], mvRowSize[upper[k].first]);
+			}
+		}
+
+		void ApplyPreconditioner(const Eigen::VectorXd& r, Eigen::VectorXd& z) const
+		{
+			const int nBlocks = static_cast<int>(mvRowBase.size());
+			for (int k = 0; k < nBlocks; ++k)
+				z.segment(mvRowBase[k], mvRowSize[k]).noalias() =
+					mvDiagInv[k] * r.segment(mvRowBase[k], mvRowSize[k]);
+		}
+
+		bool mbInit;
+		int mnThreads;
+		double mdTolerance;
+		int mnMaxIterations;
+		int mnIterations;
+		std::vector<int> mvRowBase;
+		std::vector<int> mvRowSize;
+		std::vector<MatrixType, Eigen::aligned_allocator<MatrixType> > mvDiagInv;
+		std::vector<std::vector<std::pair<int, const MatrixType*> > > mvUpperRows;
+	};
+}
+#endif // LINEARSOLVERPCG_H
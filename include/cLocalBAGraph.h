@@ -0,0 +1,130 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOCALBAGRAPH_H
+#define LOCALBAGRAPH_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "g2o/core/sparse_optimizer.h"
+
+#include "cMultiKeyFrame.h"
+#include "cMapPoint.h"
+#include "g2o_MultiCol_vertices_edges.h"
+
+namespace MultiColSLAM
+{
+	// g2o graph of the local BA that is kept between two runs.
+	// Consecutive local BAs share most keyframes and points, so the optimizer,
+	// the solver and the vertices and edges stay in the graph and are only
+	// updated. Everything that is not added again in an update is taken out of
+	// the graph and kept in pools for the next keyframes and points, so after
+	// a few keyframes a local BA allocates (almost) nothing.
+	// The estimates are always taken from the map, which holds the result of
+	// the last BA, tracking or loop closing.
+	// Keyframes and points are identified by their ids and their pointers are
+	// not kept, they may be freed between two updates.
+	// Only used by the local mapping thread, not thread safe.
+	class cLocalBAGraph
+	{
+	public:
+		cLocalBAGraph();
+		~cLocalBAGraph();
+
+		// starts an update, Mc and the interior orientation are taken from
+		// camSystem and kept fixed
+		void BeginUpdate(cMultiCamSys_& camSystem, bool* pbStopFlag);
+		VertexMt_cayley* AddPose(cMultiKeyFrame* pKF, const bool& fixed);
+		VertexPointXYZ* AddPoint(cMapPoint* pMP);
+		// the keyframe and the point have to be added in this update
+		EdgeProjectXYZ2MCS* AddObservation(cMultiKeyFrame* pKF, cMapPoint* pMP,
+			const size_t& obsIdx, const int& cam,
+			const cv::KeyPoint& kpUn, const double& thHuber);
+		// takes everything out of the graph that was not added since BeginUpdate
+		void EndUpdate();
+
+		// NULL if the keyframe was not added in this update
+		VertexMt_cayley* PoseVertex(cMultiKeyFrame* pKF) const;
+
+		g2o::SparseOptimizer& Optimizer() { return mOptimizer; }
+
+		// at most nIterations on the active edges, stops earlier if the relative gain
+		// of the robust cost falls below gainThreshold or the stop flag of BeginUpdate
+		// is set. Returns the iterations done (0 if the stop flag was already set)
+		// or -1 if g2o failed. g2o::SparseOptimizer::optimize itself returns -1 for an
+		// empty graph or a failed init, but 0 if the solver failed, that is mapped to -1
+		int Optimize(const int& nIterations, const double& gainThreshold);
+
+		// deletes all vertices and edges, also the pooled ones
+		void Clear();
+
+		// vertices, edges and kernels allocated since the last BeginUpdate
+		int NrAllocations() const { return mnAllocations; }
+
+	protected:
+		struct sEdgeEntry
+		{
+			long unsigned int nKFId;
+			size_t nObsIdx;
+			EdgeProjectXYZ2MCS* pEdge;
+			unsigned long nUpdate;
+		};
+
+		struct sPointEntry
+		{
+			VertexPointXYZ* pVertex;
+			unsigned long nUpdate;
+			std::vector<sEdgeEntry> vEdges;
+		};
+
+		struct sPoseEntry
+		{
+			VertexMt_cayley* pVertex;
+			unsigned long nUpdate;
+		};
+
+		// take out of the graph without deleting, g2o would delete them
+		void DetachEdge(EdgeProjectXYZ2MCS* e);
+		void DetachVertex(g2o::OptimizableGraph::Vertex* v);
+
+		g2o::SparseOptimizer mOptimizer;
+		bool mbAlgorithmSet;
+		// the optimizer gets its own flag, the one of the caller is only read
+		bool* mpbStopFlag;
+		bool mbStop;
+
+		std::vector<VertexMc_cayley*> mvpMc;
+		std::vector<VertexOmniCameraParameters*> mvpIO;
+
+		// by keyframe and map point id
+		std::unordered_map<long unsigned int, sPoseEntry> mmPoses;
+		std::unordered_map<long unsigned int, sPointEntry> mmPoints;
+
+		std::vector<VertexMt_cayley*> mvpFreePoses;
+		std::vector<VertexPointXYZ*> mvpFreePoints;
+		std::vector<EdgeProjectXYZ2MCS*> mvpFreeEdges;
+
+		unsigned long mnUpdate;
+		int mnNextVertexId;
+		int mnAllocations;
+	};
+}
+#endif // LOCALBAGRAPH_H
@@ -41,6 +41,7 @@ namespace MultiColSLAM
 	class cTracking;
 	class cLoopClosing;
 	class cMap;
+	class cGlobalBA;
 
 	class cLocalMapping
 	{
@@ -51,6 +52,9 @@ namespace MultiColSLAM
 
 		void SetTracker(cTracking* pTracker);
 
+		// its results are merged between two keyframes
+		void SetGlobalBA(cGlobalBA* pGlobalBA);
+
 		void Run();
 
 		void InsertMultiKeyFrame(cMultiKeyFrame* pKF);
@@ -81,6 +85,18 @@ namespace MultiColSLAM
 
 		std::vector<double> timingMapPointCreate;
 		std::vector<double> timingLocalBA;
+		// g2o objects allocated per local BA
+		std::vector<int> allocationsLocalBA;
+		// observations relinearized, points eliminated and steps rejected
+		// per update of the incremental backend
+		std::vector<int> relinearizedLocalBA;
+		std::vector<int> eliminatedLocalBA;
+		std::vector<int> rejectedLocalBA;
+		// from taking a keyframe out of the queue until it is passed to the loop closer
+		std::vector<double> timingLocalMapping;
+		// hardware cache misses while building the local BA problem (-1 if not counted)
+		std::vector<double> cacheMissesL1LocalBASetup;
+		std::vector<double> cacheMissesLLCLocalBASetup;
 		std::vector<double> timingMapPointFusion;
 		std::vector<double> timingMKFInsertion;
 
@@ -101,6 +117,9 @@ namespace MultiColSLAM
 
 		void KeyFrameCulling();
 
+		// drops pointers to bad objects before announcing a quiescent state
+		void ReleaseBadReferences();
+
 		void ResetIfRequested();
 		bool CheckFinish();
 		void SetFinish();
@@ -112,6 +131,7 @@ namespace MultiColSLAM
 
 		cLoopClosing* mpLoopCloser;
 		cTracking* mpTracker;
+		cGlobalBA* mpGlobalBA;
 
 		std::list<cMultiKeyFrame*> mlNewMultiKeyFrames;
 
@@ -41,6 +41,7 @@ namespace MultiColSLAM
 	class cTracking;
 	class cLocalMapping;
 	class cKeyFrameDatabase;
+	class cGlobalBA;
 
 	class cLoopClosing
 	{
@@ -56,6 +57,9 @@ namespace MultiColSLAM
 
 		void SetLocalMapper(cLocalMapping* pLocalMapper);
 
+		// started after every loop correction, see cOptimizer::globalBAAfterLoop
+		void SetGlobalBA(cGlobalBA* pGlobalBA);
+
 		void Run();
 
 		void InsertKeyFrame(cMultiKeyFrame *pKF);
@@ -78,6 +82,9 @@ namespace MultiColSLAM
 
 		void CorrectLoop();
 
+		// drops pointers to bad objects before announcing a quiescent state
+		void ReleaseBadReferences();
+
 		void ResetIfRequested();
 		bool mbResetRequested;
 		std::mutex mMutexReset;
@@ -90,6 +97,8 @@ namespace MultiColSLAM
 
 		cLocalMapping *mpLocalMapper;
 
+		cGlobalBA* mpGlobalBA;
+
 		std::list<cMultiKeyFrame*> mlpLoopKeyFrameQueue;
 
 		std::mutex mMutexLoopQueue;
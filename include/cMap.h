@@ -30,9 +30,11 @@
 // own includes
 #include "cMapPoint.h"
 #include "cMultiKeyFrame.h"
+#include "cEpochReclaimer.h"
+#include "cSnapshotVector.h"
 // external includes
-#include <set>
 #include <mutex>
+#include <atomic>
 namespace MultiColSLAM
 {
 
@@ -55,6 +57,11 @@ namespace MultiColSLAM
 		std::vector<cMultiKeyFrame*> GetAllKeyFrames();
 		std::vector<cMapPoint*> GetAllMapPoints();
 
+		// cheap read only views, iterate them without holding the map lock
+		// instead of copying everything with GetAll*
+		cSnapshot<cMultiKeyFrame> GetKeyFrameSnapshot();
+		cSnapshot<cMapPoint> GetMapPointSnapshot();
+
 		std::vector<cMultiKeyFrame*> GetReferenceKeyFrames();
 		std::vector<cMapPoint*> GetReferenceMapPoints();
 
@@ -72,13 +79,29 @@ namespace MultiColSLAM
 
 		unsigned int GetMaxKFid();
 
+		// counts erased map points and keyframes. As long as it does not change,
+		// nothing turned bad and the tracker can skip the scan of its local map
+		// (see cTracking::ReleaseBadReferences). Changes of the observations
+		// are counted per keyframe (cMultiKeyFrame::GetObservationVersion)
+		void InformObjectErased() { ++mnEraseVersion; }
+		unsigned long GetEraseVersion() const { return mnEraseVersion; }
+
+		// counts changes of map point positions and scale invariance distances,
+		// the tracker keeps its culling bounds of the local keyframes as long as it does not change
+		void InformGeometryChange() { ++mnGeometryVersion; }
+		unsigned long GetGeometryVersion() const { return mnGeometryVersion; }
+
 		void clear();
 
+		// erased map points and keyframes are handed to the reclaimer
+		// and freed once no thread can reference them anymore
+		cEpochReclaimer* GetReclaimer() { return &mReclaimer; }
+
 		//std::mutex mMutexMapUpdate;
 
 	protected:
-		std::set<cMapPoint*> mspMapPoints;
-		std::set<cMultiKeyFrame*> mspKeyFrames;
+		cSnapshotVector<cMapPoint> mvpMapPoints;
+		cSnapshotVector<cMultiKeyFrame> mvpKeyFrames;
 		std::vector<cMapPoint*> mvpReferenceMapPoints;
 
 		unsigned int mnMaxKFid;
@@ -86,6 +109,11 @@ namespace MultiColSLAM
 		std::mutex mMutexMap;
 		bool mbMapUpdated;
 
+		std::atomic<unsigned long> mnEraseVersion;
+		std::atomic<unsigned long> mnGeometryVersion;
+
+		cEpochReclaimer mReclaimer;
+
 	};
 
 }
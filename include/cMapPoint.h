@@ -30,6 +30,7 @@
 #include <opencv2/core/core.hpp>
 #include "cMultiKeyFrame.h"
 #include "cMap.h"
+#include "cObjectPool.h"
 
 #include <mutex>
 namespace MultiColSLAM
@@ -92,6 +93,13 @@ namespace MultiColSLAM
 		double GetMinDistanceInvariance();
 		double GetMaxDistanceInvariance();
 
+		// map points are allocated from a slab pool, see cObjectPool
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+		// memory order of the points, sort by this before iterating over many of them
+		static bool AllocationOrder(const cMapPoint* pMP1, const cMapPoint* pMP2);
+		static cObjectPool<cMapPoint>& GetPool();
+
 	public:
 		long unsigned int mnId;
 		static long unsigned int nNextId;
@@ -115,6 +123,9 @@ namespace MultiColSLAM
 		long unsigned int mnCorrectedByKF;
 		long unsigned int mnCorrectedReference;
 
+		// Position in the map storage, only touched by cMap under its lock
+		size_t mnMapIndex;
+
 	protected:
 
 		// Position in absolute coordinates
@@ -144,7 +155,7 @@ namespace MultiColSLAM
 		int mnVisible;
 		int mnFound;
 
-		// Bad flag (we do not currently erase MapPoint from memory)
+		// Bad flag (the MapPoint is freed by the map reclaimer once no thread references it)
 		bool mbBad;
 		bool scaled;
 
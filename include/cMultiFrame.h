@@ -72,9 +72,13 @@ namespace MultiColSLAM
 
 		// images
 		std::vector<cv::Mat> images;
+		// image pyramids of the extractor for each camera (for the direct alignment)
+		std::vector<std::vector<cv::Mat> > mvImagePyramids;
 
 		// Frame timestamp
 		double mTimeStamp;
+		// time the feature extraction took in ms
+		double mdExtractionTime;
 
 		// contains all cameras
 		// camera model inside for projection
@@ -32,8 +32,10 @@
 // external
 #include <algorithm>
 #include <unordered_map>
+#include <set>
 #include <thread>
 #include <mutex>
+#include <atomic>
 // third party
 #include "DBoW2/DBoW2/BowVector.h"
 #include "DBoW2/DBoW2/FeatureVector.h"
@@ -44,6 +46,7 @@
 #include "cORBVocabulary.h"
 #include "cMultiFrame.h"
 #include "cMultiKeyFrameDatabase.h"
+#include "cObjectPool.h"
 
 namespace MultiColSLAM
 {
@@ -112,6 +115,12 @@ namespace MultiColSLAM
 		void EraseMapPointMatch(const size_t &idx);
 		//void EraseMapPointMatch(cMapPoint* pMP,const size_t& idx);
 		void ReplaceMapPointMatch(const size_t &idx, cMapPoint* pMP);
+		// drops matches to bad MapPoints, they will be freed by the map
+		void EraseBadMapPointMatches();
+		// counts changes of the map point matches and of the observations
+		// of this keyframe, see cTracking::UpdateReference
+		void InformObservationChange() { ++mnObservationVersion; }
+		unsigned long GetObservationVersion() const { return mnObservationVersion; }
 		std::set<cMapPoint*> GetMapPoints();
 		std::vector<cMapPoint*> GetMapPointMatches();
 		int TrackedMapPoints();
@@ -176,6 +185,13 @@ namespace MultiColSLAM
 		// Median MapPoint depth
 		double ComputeSceneMedianDepth(int q = 2);
 
+		// keyframes are allocated from a slab pool, see cObjectPool
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+		// memory order of the keyframes
+		static bool AllocationOrder(const cMultiKeyFrame* pKF1, const cMultiKeyFrame* pKF2);
+		static cObjectPool<cMultiKeyFrame, 128>& GetPool();
+
 		static long unsigned int nNextId;
 		long unsigned int mnId;
 		long unsigned int mnFrameId;
@@ -192,18 +208,19 @@ namespace MultiColSLAM
 		// Variables used by the tracking
 		long unsigned int mnTrackReferenceForFrame;
 		long unsigned int mnFuseTargetForKF;
+		// observation version when the keyframe entered the local map
+		unsigned long mnTrackObservationVersion;
 
 		// Variables used by the local mapping
 		long unsigned int mnBALocalForKF;
 		long unsigned int mnBAFixedForKF;
 
-		// Variables used by the keyframe database
-		long unsigned int mnLoopQuery;
-		int mnLoopWords;
-		double mLoopScore;
-		long unsigned int mnRelocQuery;
-		int mnRelocWords;
-		double mRelocScore;
+		// Position in the map storage, only touched by cMap under its lock
+		size_t mnMapIndex;
+
+		// Slot in the keyframe database, -1 if not in there.
+		// Queries keep their scores in own arrays indexed by this slot.
+		std::atomic<int> mnDatabaseSlot;
 
 		//BoW
 		// for all cams combined
@@ -272,6 +289,7 @@ namespace MultiColSLAM
 		std::vector<cv::Mat> mDescriptors;
 		std::vector<cv::Mat> mDescriptorMasks;
 		std::vector<cMapPoint*> mvpMapPoints;
+		std::atomic<unsigned long> mnObservationVersion;
 
 		// BoW
 		cMultiKeyFrameDatabase* mpKeyFrameDB;
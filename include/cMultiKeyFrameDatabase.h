@@ -36,6 +36,7 @@
 #include "cMultiKeyFrame.h"
 #include "cMultiFrame.h"
 #include "cORBVocabulary.h"
+#include "cSharedMutex.h"
 
 namespace MultiColSLAM
 {
@@ -57,12 +58,38 @@ namespace MultiColSLAM
 		// Relocalisation
 		std::vector<cMultiKeyFrame*> DetectRelocalisationCandidates(cMultiFrame* F);
 	protected:
+		// drops the entries of erased keyframes from the inverted file
+		// and hands their slots back, call with the mutex locked exclusively
+		void Compact();
+
+		// copies the keyframes sharing words with the BoW vector into the query arrays:
+		// the slot table, the number of shared words per slot and the touched slots
+		void GetKeyFramesSharingWords(const DBoW2::BowVector& bowVec,
+			std::vector<cMultiKeyFrame*>& vpSlotKFs,
+			std::vector<int>& vnWords,
+			std::vector<int>& vnSharingSlots);
+
+		// BoW scores of the given slots, written into vScores at the slot index
+		void ScoreKeyFrames(const DBoW2::BowVector& bowVec,
+			const std::vector<cMultiKeyFrame*>& vpSlotKFs,
+			const std::vector<int>& vnSlots,
+			std::vector<double>& vScores);
+
 		// Associated vocabulary
 		const ORBVocabulary* mpVoc;
-		// Inverted file
-		std::vector<std::list<cMultiKeyFrame*> > mvInvertedFile;
-		// Mutex
-		std::mutex mMutex;
+		// Inverted file, for each word the slots of the keyframes containing it.
+		// Erased keyframes leave tombstones which are removed by Compact
+		std::vector<std::vector<int> > mvInvertedFile;
+		// slot -> keyframe, NULL if erased or unused
+		std::vector<cMultiKeyFrame*> mvpSlotKeyFrames;
+		// erased slots with entries left in the inverted file
+		std::vector<int> mvnDeadSlots;
+		// slots that can be reused
+		std::vector<int> mvnFreeSlots;
+		size_t mnEntries;
+		size_t mnTombstones;
+		// add/erase/clear lock exclusively, queries share the lock
+		cSharedMutex mMutex;
 	};
 }
 #endif
@@ -71,7 +71,10 @@ namespace MultiColSLAM
 
 		// Project MapPoints tracked in last frame into the current frame and search matches.
 		// Used to track from previous frame (Tracking)
-		int SearchByProjection(cMultiFrame &CurrentFrame, const cMultiFrame &LastFrame, double th);
+		// With the covariance of the predicted pose (rotation, translation in the MCS frame)
+		// the window of each point is 3 sigma of its projection plus minTh, at most th.
+		int SearchByProjection(cMultiFrame &CurrentFrame, const cMultiFrame &LastFrame, double th,
+			const cv::Matx66d* pPoseCov = NULL, double minTh = 0.0);
 
 		// Project MapPoints seen in KeyFrame into the Frame and search matches.
 		// Used in relocalisation (Tracking)
@@ -165,6 +168,15 @@ namespace MultiColSLAM
 
 		double RadiusByViewingCos(const double &viewCos);
 
+		// largest standard deviation in pixels of the projection of a point,
+		// propagated from the pose covariance through the camera model
+		double ProjectionSigma(const cCamModelGeneral_& camModel,
+			const cv::Matx44d& Mt_inv,
+			const cv::Matx33d& Rc_t,
+			const cv::Matx44d& MtMc_inv,
+			const cv::Vec3d& x3Dw,
+			const cv::Matx66d& poseCov);
+
 		void ComputeThreeMaxima(std::vector<int>* histo,
 			const int L, int &ind1, int &ind2, int &ind3);
 
@@ -0,0 +1,148 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace MultiColSLAM
+{
+	// Slab allocator for the long living map objects (map points and keyframes).
+	// Objects are placed in large slabs that are never moved or given back,
+	// so addresses stay stable for the lifetime of the pool and objects that
+	// were created together also live next to each other in memory.
+	// Every slot carries its allocation index, which orders objects like
+	// they are laid out in memory (slab by slab). Sorting by it before
+	// iterating over many objects gives a linear walk through the slabs.
+	// Freed slots are reused last in first out, they are most likely still cached.
+	// The pool only hands out raw memory, construction and destruction is
+	// done by the class specific operator new/delete of T.
+	template<class T, size_t SlabSize = 1024>
+	class cObjectPool
+	{
+	public:
+		cObjectPool() : mnLive(0) {}
+
+		~cObjectPool()
+		{
+			for (size_t i = 0; i < mvpSlabMemory.size(); ++i)
+				::operator delete(mvpSlabMemory[i]);
+		}
+
+		void* Allocate()
+		{
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			if (mvpFreeSlots.empty())
+				AddSlab();
+			Slot* pSlot = mvpFreeSlots.back();
+			mvpFreeSlots.pop_back();
+			++mnLive;
+			return static_cast<void*>(&pSlot->data);
+		}
+
+		void Deallocate(void* p)
+		{
+			if (!p)
+				return;
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			mvpFreeSlots.push_back(ToSlot(p));
+			--mnLive;
+		}
+
+		// position of the object in the slabs, no locking needed
+		// as it is written once when the slab is created
+		static unsigned long AllocationIndex(const void* p)
+		{
+			return ToSlot(p)->nIndex;
+		}
+
+		size_t NrLive()
+		{
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			return mnLive;
+		}
+
+		size_t Capacity()
+		{
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			return mvpSlabMemory.size() * SlabSize;
+		}
+
+		size_t NrSlabs()
+		{
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			return mvpSlabMemory.size();
+		}
+
+		size_t BytesReserved()
+		{
+			std::unique_lock<std::mutex> lock(mMutexPool);
+			return mvpSlabMemory.size() * (SlabSize * sizeof(Slot) + alignof(Slot));
+		}
+
+	protected:
+		struct Slot
+		{
+			unsigned long nIndex;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+		};
+
+		static Slot* ToSlot(const void* p)
+		{
+			return reinterpret_cast<Slot*>(
+				const_cast<char*>(static_cast<const char*>(p)) - offsetof(Slot, data));
+		}
+
+		// has to be called with the pool mutex locked
+		void AddSlab()
+		{
+			// operator new only guarantees the default alignment,
+			// Eigen members might need more
+			size_t bytes = SlabSize * sizeof(Slot) + alignof(Slot);
+			void* pMemory = ::operator new(bytes);
+			void* pAligned = pMemory;
+			std::align(alignof(Slot), SlabSize * sizeof(Slot), pAligned, bytes);
+			mvpSlabMemory.push_back(pMemory);
+
+			Slot* pSlots = static_cast<Slot*>(pAligned);
+			const unsigned long firstIndex = (mvpSlabMemory.size() - 1) * SlabSize;
+			// push in reverse, so that the slab is handed out front to back
+			mvpFreeSlots.reserve(mvpFreeSlots.size() + SlabSize);
+			for (size_t i = SlabSize; i > 0; --i)
+			{
+				pSlots[i - 1].nIndex = firstIndex + i - 1;
+				mvpFreeSlots.push_back(&pSlots[i - 1]);
+			}
+		}
+
+		std::mutex mMutexPool;
+		std::vector<void*> mvpSlabMemory;
+		std::vector<Slot*> mvpFreeSlots;
+		size_t mnLive;
+	};
+}
+#endif // OBJECTPOOL_H
@@ -33,6 +33,10 @@
 #include "cLoopClosing.h"
 #include "cMultiFrame.h"
 
+#include <atomic>
+#include <unordered_map>
+#include "g2o/core/sparse_optimizer.h"
+
 namespace MultiColSLAM
 {
 	const double huberK = 3;
@@ -43,30 +47,97 @@ namespace MultiColSLAM
 	//{
 
 	class cLoopClosing;
+	class cLocalBAGraph;
+	class cIncrementalBA;
 
 	class cOptimizer
 	{
 	public:
-		void static BundleAdjustment(const std::vector<cMultiKeyFrame*> &vpKF,
-			const std::vector<cMapPoint*> &vpMP,
+		void static BundleAdjustment(const cSnapshot<cMultiKeyFrame> &vpKF,
+			const cSnapshot<cMapPoint> &vpMP,
 			bool poseOnly,
 			int nIterations = 5,
 			bool *pbStopFlag = NULL);
 
+		// adds the keyframes (vertex id = keyframe id), Mc and IO (fixed) and the
+		// points with their observations of the snapshots to the optimizer.
+		// Observations of keyframes that are not in vpKF are left out
+		static void SetupBundleAdjustment(g2o::SparseOptimizer& optimizer,
+			const cSnapshot<cMultiKeyFrame> &vpKF,
+			const cSnapshot<cMapPoint> &vpMP,
+			const bool& poseOnly,
+			std::unordered_map<long unsigned int, int>& mapPointId_to_vertexId);
+
 		void static GlobalBundleAdjustment(cMap* pMap,
 			bool poseOnly = false,
 			int nIterations = 5,
 			bool *pbStopFlag = NULL);
 
+		// keyframes covisible with pKF (pKF first), the points they see and the
+		// other keyframes observing these points. False if pKF has no covisible keyframes
+		static bool CollectLocalWindow(cMultiKeyFrame* pKF,
+			std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+			std::list<cMapPoint*>& lLocalMapPoints,
+			std::list<cMultiKeyFrame*>& lFixedCameras);
+
+		// pGraph: graph of the previous local BA to update, a new one is built if NULL.
+		// pnAllocations: g2o vertices, edges and kernels allocated for this BA
 		static std::list<cMultiKeyFrame*> LocalBundleAdjustment(cMultiKeyFrame* pKF,
 			cMap* pMap,
 			int nrIters = 10,
 			bool getCovMats = false,
-			bool *pbStopFlag = NULL);
+			bool *pbStopFlag = NULL,
+			cCacheMissCounter* pSetupCounter = NULL,
+			cLocalBAGraph* pGraph = NULL,
+			int* pnAllocations = NULL);
+
+		// local BA of the collected keyframes and points with cBundleAdjusterMC,
+		// same outlier rounds as the graph version. With bApply false the map is
+		// left untouched, pvPoses gets the poses of lLocalKeyFrames in any case.
+		// Returns the final robust cost
+		static double LocalBundleAdjustmentNative(cMultiKeyFrame* pKF,
+			const std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+			const std::list<cMultiKeyFrame*>& lFixedCameras,
+			const std::list<cMapPoint*>& lLocalMapPoints,
+			bool* pbStopFlag,
+			const bool& bApply,
+			const bool& bMixedPrecision,
+			int* pnInliers = NULL,
+			std::vector<cv::Matx61d>* pvPoses = NULL);
+
+		// local BA of the window of pKF with the incremental backend, which keeps
+		// its problem from the previous keyframes. Returns the number of outliers removed
+		static int IncrementalBundleAdjustment(cMultiKeyFrame* pKF,
+			cIncrementalBA* pBackend,
+			bool* pbStopFlag = NULL);
 
+		// dispatches to the dedicated solver or the g2o graph, see poseOnlyGN.
+		// nIterations per round, the outliers are removed between two rounds
 		int static PoseOptimization(cMultiFrame* pFrame,
 			double& inliers,
-			const double& huberMultiplier = 2);
+			const double& huberMultiplier = 2,
+			const int& nIterations = 10);
+
+		int static PoseOptimizationG2O(cMultiFrame* pFrame,
+			double& inliers,
+			const double& huberMultiplier = 2,
+			const int& nIterations = 10);
+
+		// same model and outlier rejection as the g2o version, but solved
+		// directly on the 6x6 normal equations in reused buffers
+		int static PoseOptimizationGN(cMultiFrame* pFrame,
+			double& inliers,
+			const double& huberMultiplier = 2,
+			const int& nIterations = 10);
+
+		// sparse direct alignment to the previous frame on the pyramid levels
+		// topLevel down to bottomLevel, refines the pose of pFrame in place.
+		// Returns the number of points used, 0 if the pose was left unchanged
+		int static PoseAlignmentDirect(cMultiFrame* pFrame,
+			const cMultiFrame& lastFrame,
+			const int& topLevel = 2,
+			const int& bottomLevel = 1,
+			const int& nIterations = 10);
 
 		bool static StructureOnly(cMultiKeyFrame* pKF,
 			cMapPoint* &vpMP,
@@ -80,11 +151,25 @@ namespace MultiColSLAM
 			const cLoopClosing::KeyFrameAndPose &CorrectedSim3,
 			const std::map<cMultiKeyFrame*, std::set<cMultiKeyFrame*> > &LoopConnections);
 
+		// dispatches to the dedicated solver or the g2o graph, see sim3GN.
+		// Outliers are removed from vpMatches1, returns the number of inliers
 		static int OptimizeSim3(cMultiKeyFrame* pKF1,
 			cMultiKeyFrame* pKF2,
 			std::vector<cMapPoint *> &vpMatches1,
 			g2o::Sim3 &g2oS12);
 
+		static int OptimizeSim3G2O(cMultiKeyFrame* pKF1,
+			cMultiKeyFrame* pKF2,
+			std::vector<cMapPoint *> &vpMatches1,
+			g2o::Sim3 &g2oS12);
+
+		// same model and outlier rejection as the g2o version, but solved
+		// directly on the 7x7 normal equations in reused buffers
+		static int OptimizeSim3GN(cMultiKeyFrame* pKF1,
+			cMultiKeyFrame* pKF2,
+			std::vector<cMapPoint *> &vpMatches1,
+			g2o::Sim3 &g2oS12);
+
 
 		static std::list<cMultiKeyFrame*> MotionOnlyBA(cMultiKeyFrame* pKF,
 			cMap* pMap);
@@ -102,6 +187,79 @@ namespace MultiColSLAM
 		static double stdPose;
 		static double stdSim;
 		static double stdModel;
+
+		// pose only optimization without g2o graph
+		static bool poseOnlyGN;
+		// run both pose optimizations and print the differences and timings,
+		// the result of the one selected by poseOnlyGN is used
+		static bool checkPoseOnlyGN;
+		// threads linearizing the edges in the local BA (see cParallelBlockSolver)
+		static int nBAThreads;
+		// local BA without g2o graph for the fixed rig, see cBundleAdjusterMC
+		static bool nativeLocalBA;
+		// run both local BAs from the same start and print the timings and final costs
+		static bool checkNativeLocalBA;
+		// float Jacobians in the native local BA, see cBundleAdjusterMC::SetMixedPrecision
+		static bool mixedPrecisionBA;
+		// run the native local BA in both precisions and print the timings, costs
+		// and the largest difference of the local keyframe positions
+		static bool checkMixedPrecisionBA;
+		// keep the g2o graph of the local BA between two runs, see cLocalBAGraph
+		static bool reuseLocalBAGraph;
+		// incremental smoothing instead of the local BA, see cIncrementalBA
+		static bool incrementalBackend;
+		// largest delta before a variable of the incremental backend is relinearized
+		static double relinearizeThreshold;
+		// relinearization steps per keyframe of the incremental backend
+		static int incrementalIterations;
+		// global BA in the background after every loop closure, see cGlobalBA
+		static bool globalBAAfterLoop;
+		static int globalBAIterations;
+		// linear solver of the essential graph optimization
+		enum ePoseGraphSolver
+		{
+			POSE_GRAPH_EIGEN = 0, // g2o::LinearSolverEigen (simplicial LDLT)
+			POSE_GRAPH_BLOCK_CHOLESKY = 1, // see cLinearSolverBlockCholesky
+			POSE_GRAPH_PCG = 2 // see cLinearSolverPCG
+		};
+		static int poseGraphSolver;
+		// run the essential graph with every linear solver and print the timings and final costs
+		static bool checkPoseGraphSolvers;
+		// sim3 of the loop candidates without g2o graph
+		static bool sim3GN;
+		// run both sim3 optimizations and print the differences and timings,
+		// the result of the one selected by sim3GN is used
+		static bool checkSim3GN;
+		// outlier aware schedule of the pose optimization and the local BA instead of
+		// the fixed two rounds: optimize until the gain falls below outlierGainThreshold,
+		// classify all observations again (outliers come back if they are under the
+		// threshold) and stop once the inlier set does not change anymore.
+		// Never more iterations than the two rounds.
+		static bool adaptiveOutliers;
+		static double outlierGainThreshold;
+
+		// iterations done against the iteration budget of the two rounds
+		struct sScheduleStats
+		{
+			sScheduleStats() : nRuns(0), nIterations(0), nBudget(0), nRounds(0), nReincluded(0) {}
+			void Add(const int& iterations, const int& budget, const int& rounds, const int& reincluded)
+			{
+				++nRuns;
+				nIterations += iterations;
+				nBudget += budget;
+				nRounds += rounds;
+				nReincluded += reincluded;
+			}
+			std::atomic<long long> nRuns;
+			std::atomic<long long> nIterations;
+			std::atomic<long long> nBudget;
+			std::atomic<long long> nRounds;
+			// observations that were outliers after a round and inliers again later
+			std::atomic<long long> nReincluded;
+		};
+		static sScheduleStats poseOptimizationStats;
+		// local BAs aborted by local mapping are not counted
+		static sScheduleStats localBAStats;
 	};
 
 }
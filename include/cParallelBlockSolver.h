@@ -0,0 +1,107 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLELBLOCKSOLVER_H
+#define PARALLELBLOCKSOLVER_H
+
+#include <algorithm>
+#include <vector>
+
+#include "g2o/core/block_solver.h"
+#include "g2o/core/jacobian_workspace.h"
+#include "g2o/core/sparse_optimizer.h"
+
+namespace MultiColSLAM
+{
+	// g2o block solver that linearizes the edges on several OpenMP threads.
+	// The edges are processed in fixed blocks: the Jacobians of a block are computed
+	// in parallel, every edge into its own workspace, then the quadratic forms are added
+	// to the Hessian on one thread in edge order. So the system is the same as
+	// with one thread, bit by bit, no matter how many threads are used.
+	// Computing the analytic Jacobians (mcsJacsChain) is the expensive part, adding
+	// the small blocks is cheap and needs no locks this way.
+	template <typename Traits>
+	class cParallelBlockSolver : public g2o::BlockSolver<Traits>
+	{
+	public:
+		typedef g2o::BlockSolver<Traits> Base;
+
+		cParallelBlockSolver(typename Base::LinearSolverType* linearSolver, const int& nThreads) :
+			Base(linearSolver), mnThreads(nThreads) {}
+
+		virtual bool init(g2o::SparseOptimizer* optimizer, bool online = false)
+		{
+			// the workspace size depends on the graph
+			mvWorkspaces.clear();
+			return Base::init(optimizer, online);
+		}
+
+		virtual bool buildSystem()
+		{
+			if (mnThreads <= 1)
+				return Base::buildSystem();
+
+			g2o::SparseOptimizer* optimizer = this->_optimizer;
+			const int nVertices = static_cast<int>(optimizer->indexMapping().size());
+			for (int i = 0; i < nVertices; ++i)
+				optimizer->indexMapping()[i]->clearQuadraticForm();
+			this->_Hpp->clear();
+			if (this->_doSchur)
+			{
+				this->_Hll->clear();
+				this->_Hpl->clear();
+			}
+
+			const g2o::OptimizableGraph::EdgeContainer& edges = optimizer->activeEdges();
+			const int nEdges = static_cast<int>(edges.size());
+			const int nBlock = std::min(nEdges, static_cast<int>(kBlockSize));
+			if (static_cast<int>(mvWorkspaces.size()) < nBlock)
+				mvWorkspaces.resize(nBlock, optimizer->jacobianWorkspace());
+
+			for (int first = 0; first < nEdges; first += kBlockSize)
+			{
+				const int last = std::min(nEdges, first + kBlockSize);
+#pragma omp parallel for schedule(static) num_threads(mnThreads)
+				for (int k = first; k < last; ++k)
+					edges[k]->linearizeOplus(mvWorkspaces[k - first]);
+				for (int k = first; k < last; ++k)
+					edges[k]->constructQuadraticForm();
+			}
+
+			for (int i = 0; i < nVertices; ++i)
+			{
+				g2o::OptimizableGraph::Vertex* v = optimizer->indexMapping()[i];
+				int iBase = v->colInHessian();
+				if (v->marginalized())
+					iBase += this->_sizePoses;
+				v->copyB(this->_b + iBase);
+			}
+			// same as g2o::BlockSolver::buildSystem
+			return 0;
+		}
+
+	private:
+		enum { kBlockSize = 1024 };
+		int mnThreads;
+		// one per edge of a block, the Jacobians stay there until the block is added
+		std::vector<g2o::JacobianWorkspace> mvWorkspaces;
+	};
+}
+#endif // PARALLELBLOCKSOLVER_H
@@ -0,0 +1,99 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHAREDMUTEX_H
+#define SHAREDMUTEX_H
+
+#include <mutex>
+#include <condition_variable>
+
+namespace MultiColSLAM
+{
+	// Reader-writer lock, we are on C++11 and have no std::shared_mutex.
+	// Writers are preferred: once a writer waits, new readers have to wait
+	// as well, so frequent queries can not starve add/erase.
+	// lock/unlock work with std::unique_lock, lock_shared/unlock_shared with cSharedLock.
+	class cSharedMutex
+	{
+	public:
+		cSharedMutex() : mnReaders(0), mnWaitingWriters(0), mbWriter(false) {}
+
+		void lock()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			++mnWaitingWriters;
+			mCondWriters.wait(lock, [this] { return !mbWriter && mnReaders == 0; });
+			--mnWaitingWriters;
+			mbWriter = true;
+		}
+
+		void unlock()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mbWriter = false;
+			}
+			mCondWriters.notify_one();
+			mCondReaders.notify_all();
+		}
+
+		void lock_shared()
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondReaders.wait(lock, [this] { return !mbWriter && mnWaitingWriters == 0; });
+			++mnReaders;
+		}
+
+		void unlock_shared()
+		{
+			bool bLast;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				bLast = --mnReaders == 0;
+			}
+			if (bLast)
+				mCondWriters.notify_one();
+		}
+
+	private:
+		cSharedMutex(const cSharedMutex&);
+		cSharedMutex& operator=(const cSharedMutex&);
+
+		std::mutex mMutex;
+		std::condition_variable mCondReaders;
+		std::condition_variable mCondWriters;
+		int mnReaders;
+		int mnWaitingWriters;
+		bool mbWriter;
+	};
+
+	class cSharedLock
+	{
+	public:
+		explicit cSharedLock(cSharedMutex& mutex) : mMutex(mutex) { mMutex.lock_shared(); }
+		~cSharedLock() { mMutex.unlock_shared(); }
+	private:
+		cSharedLock(const cSharedLock&);
+		cSharedLock& operator=(const cSharedLock&);
+
+		cSharedMutex& mMutex;
+	};
+}
+#endif // SHAREDMUTEX_H
@@ -0,0 +1,188 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNAPSHOTVECTOR_H
+#define SNAPSHOTVECTOR_H
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace MultiColSLAM
+{
+	template<class T, size_t ChunkSize>
+	class cSnapshotVector;
+
+	// Read only view of a cSnapshotVector at the time it was taken.
+	// It shares the chunks with the container, so taking it is cheap and
+	// iterating needs no lock. Later changes of the container are not visible.
+	// The objects themselves are not protected, they can turn bad at any time
+	// and are only kept alive until the next quiescent state of the thread
+	// (see cEpochReclaimer).
+	template<class T, size_t ChunkSize = 1024>
+	class cSnapshot
+	{
+	public:
+		typedef std::array<T*, ChunkSize> Chunk;
+		typedef std::vector<std::shared_ptr<const Chunk> > ChunkList;
+
+		class const_iterator : public std::iterator<std::forward_iterator_tag, T*>
+		{
+		public:
+			const_iterator(const cSnapshot* pSnapshot, size_t idx) :
+				mpSnapshot(pSnapshot), mnIdx(idx) {}
+			T* operator*() const { return (*mpSnapshot)[mnIdx]; }
+			const_iterator& operator++() { ++mnIdx; return *this; }
+			const_iterator operator++(int) { const_iterator it(*this); ++mnIdx; return it; }
+			bool operator==(const const_iterator& other) const { return mnIdx == other.mnIdx; }
+			bool operator!=(const const_iterator& other) const { return mnIdx != other.mnIdx; }
+		private:
+			const cSnapshot* mpSnapshot;
+			size_t mnIdx;
+		};
+
+		cSnapshot() : mnSize(0) {}
+
+		size_t size() const { return mnSize; }
+		bool empty() const { return mnSize == 0; }
+
+		T* operator[](const size_t& idx) const
+		{
+			return (*(*mpChunks)[idx / ChunkSize])[idx % ChunkSize];
+		}
+
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, mnSize); }
+
+		std::vector<T*> ToVector() const
+		{
+			std::vector<T*> vec;
+			vec.reserve(mnSize);
+			for (size_t i = 0; i < mnSize; ++i)
+				vec.push_back((*this)[i]);
+			return vec;
+		}
+
+	private:
+		friend class cSnapshotVector<T, ChunkSize>;
+		cSnapshot(const std::shared_ptr<const ChunkList>& pChunks, const size_t& size) :
+			mpChunks(pChunks), mnSize(size) {}
+
+		std::shared_ptr<const ChunkList> mpChunks;
+		size_t mnSize;
+	};
+
+	// Dense storage of map objects with O(1) add and erase and cheap snapshots.
+	// Erasing moves the last element into the hole, the position of each object
+	// is kept in its mnMapIndex member. The elements live in fixed size chunks
+	// which are shared with the snapshots and copied on write if a snapshot
+	// still holds them, so a write copies at most two chunks.
+	// Not thread safe itself, writers and Snapshot() have to be serialized
+	// (cMap does it with its map mutex).
+	template<class T, size_t ChunkSize = 1024>
+	class cSnapshotVector
+	{
+	public:
+		typedef typename cSnapshot<T, ChunkSize>::Chunk Chunk;
+		typedef typename cSnapshot<T, ChunkSize>::ChunkList ChunkList;
+
+		cSnapshotVector() : mnSize(0) {}
+
+		bool Contains(T* p) const
+		{
+			const size_t idx = p->mnMapIndex;
+			return idx < mnSize && (*mvpChunks[idx / ChunkSize])[idx % ChunkSize] == p;
+		}
+
+		// returns false if the object was already in here
+		bool Add(T* p)
+		{
+			if (Contains(p))
+				return false;
+			if (mnSize % ChunkSize == 0)
+				mvpChunks.push_back(std::make_shared<Chunk>());
+			Writable(mnSize) = p;
+			p->mnMapIndex = mnSize;
+			++mnSize;
+			return true;
+		}
+
+		// returns false if the object was not in here
+		bool Erase(T* p)
+		{
+			if (!Contains(p))
+				return false;
+			const size_t idx = p->mnMapIndex;
+			const size_t lastIdx = mnSize - 1;
+			T* pLast = (*mvpChunks[lastIdx / ChunkSize])[lastIdx % ChunkSize];
+			Writable(idx) = pLast;
+			pLast->mnMapIndex = idx;
+			Writable(lastIdx) = NULL;
+			--mnSize;
+			if (mnSize % ChunkSize == 0)
+				mvpChunks.pop_back();
+			return true;
+		}
+
+		void Clear()
+		{
+			mvpChunks.clear();
+			mpPublished.reset();
+			mnSize = 0;
+		}
+
+		size_t Size() const { return mnSize; }
+
+		T* operator[](const size_t& idx) const
+		{
+			return (*mvpChunks[idx / ChunkSize])[idx % ChunkSize];
+		}
+
+		// O(1) as long as nothing changed since the last snapshot,
+		// otherwise one pointer per chunk is copied
+		cSnapshot<T, ChunkSize> Snapshot()
+		{
+			if (!mpPublished)
+				mpPublished = std::make_shared<const ChunkList>(mvpChunks.begin(), mvpChunks.end());
+			return cSnapshot<T, ChunkSize>(mpPublished, mnSize);
+		}
+
+	private:
+		T*& Writable(const size_t& idx)
+		{
+			// the published list holds a reference to every chunk,
+			// drop it first, so only the snapshots in use count
+			mpPublished.reset();
+			std::shared_ptr<Chunk>& pChunk = mvpChunks[idx / ChunkSize];
+			// snapshots are only taken under the writer's lock, so the count can only
+			// go down concurrently, in the worst case we copy once too often
+			if (pChunk.use_count() > 1)
+				pChunk = std::make_shared<Chunk>(*pChunk);
+			return (*pChunk)[idx % ChunkSize];
+		}
+
+		std::vector<std::shared_ptr<Chunk> > mvpChunks;
+		std::shared_ptr<const ChunkList> mpPublished;
+		size_t mnSize;
+	};
+}
+#endif // SNAPSHOTVECTOR_H
@@ -29,6 +29,7 @@
 
 #include<string>
 #include<thread>
+#include<future>
 #include<opencv2/core/core.hpp>
 
 #include "cTracking.h"
@@ -41,6 +42,7 @@
 #include "cORBVocabulary.h"
 #include "cam_system_omni.h"
 #include "cViewer.h"
+#include "cTrackingPipeline.h"
 
 namespace MultiColSLAM
 {
@@ -52,6 +54,8 @@ namespace MultiColSLAM
 	class cLoopClosing;
 	class cMultiCamSys_;
 	class cViewer;
+	class cTrackingPipeline;
+	class cGlobalBA;
 
 	class cSystem
 	{
@@ -68,6 +72,26 @@ namespace MultiColSLAM
 		// Returns the camera pose (empty if tracking fails).
 		cv::Matx44d TrackMultiColSLAM(const std::vector<cv::Mat>& imgSet, const double &timestamp);
 
+		// Same as above, but feature extraction and tracking run in two threads (see cTrackingPipeline).
+		// Returns as soon as the image set is queued, the pose arrives through the future
+		// one frame later than with TrackMultiColSLAM. The images must not be modified until then.
+		// Once this was called, TrackMultiColSLAM also goes through the pipeline and waits for its pose.
+		std::future<cv::Matx44d> TrackMultiColSLAMAsync(const std::vector<cv::Mat>& imgSet, const double &timestamp);
+
+		// Non-blocking submit for live cameras, the caller is never blocked by tracking.
+		// If the input queue (Ingestion.QueueSize) is full, frames are dropped with the
+		// policy set by Ingestion.DropPolicy. Returns false if this image set was dropped.
+		// Poses are delivered through the callback or PollPose.
+		bool SubmitImageSet(const std::vector<cv::Mat>& imgSet, const double &timestamp);
+		// The callback runs on the tracking thread, it must return quickly
+		void SetPoseCallback(const cTrackingPipeline::PoseCallback& callback);
+		bool PollPose(cTrackingPipeline::sPoseResult& result);
+		cTrackingPipeline::sIngestionStats GetIngestionStats();
+
+		// Resets the tracker if a reset was requested, called right before tracking a frame
+		void CheckReset();
+		bool ResetRequested();
+
 		// This stops local mapping thread (map building) and performs only camera tracking.
 		void ActivateLocalizationMode();
 		// This resumes local mapping thread and performs SLAM again.
@@ -86,6 +110,12 @@ namespace MultiColSLAM
 		// See format details at: http://www.ipf.kit.edu/lafida.php
 		void SaveMKFTrajectoryLAFIDA(const string &filename);
 
+		// Map access, e.g. for memory statistics
+		cMap* GetMap() { return mpMap; }
+
+		// Global BA in the background: start, cancel, resume and progress
+		cGlobalBA* GetGlobalBA() { return mpGlobalBA; }
+
 	private:
 
 		// ORB vocabulary used for place recognition and feature matching.
@@ -109,6 +139,9 @@ namespace MultiColSLAM
 		// a pose graph optimization and full bundle adjustment (in a new thread) afterwards.
 		cLoopClosing* mpLoopCloser;
 
+		// Global bundle adjustment in its own thread, merged by local mapping.
+		cGlobalBA* mpGlobalBA;
+
 		// The viewer draws the map and the current camera pose. It uses Pangolin.
 		cViewer* mpViewer;
 		cMapPublisher* mpMapPublisher;
@@ -120,6 +153,14 @@ namespace MultiColSLAM
 		std::thread* mptLoopClosing;
 		std::thread* mptViewer;
 
+		// Optional two stage tracking, created by the first asynchronous call
+		cTrackingPipeline* GetTrackingPipeline();
+		std::mutex mMutexPipeline;
+		cTrackingPipeline* mpTrackingPipeline;
+		int mnIngestionQueueSize;
+		cTrackingPipeline::eDropPolicy meIngestionDropPolicy;
+		int mnIngestionKeepEveryK;
+
 		// Reset flag
 		std::mutex mMutexReset;
 		bool mbReset;
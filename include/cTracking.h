@@ -45,6 +45,9 @@
 #include <fstream>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <map>
+#include <unordered_map>
 
 #include <opencv2/opencv.hpp>
 
@@ -94,6 +97,14 @@ namespace MultiColSLAM
 		cv::Matx44d GrabImageSet(const std::vector<cv::Mat>& imgSet,
 			const double& timestamp);
 
+		// the two halves of GrabImageSet, so that the feature extraction
+		// of the next image set can run while the current one is tracked
+		// (see cTrackingPipeline). ExtractFrame only reads state that is
+		// constant after construction and may run on another thread.
+		void ExtractFrame(const std::vector<cv::Mat>& imgSet,
+			const double& timestamp, cMultiFrame& frame);
+		cv::Matx44d TrackFrame(const cMultiFrame& frame);
+
 		void ForceRelocalisation();
 
 		eTrackingState mState;
@@ -120,6 +131,35 @@ namespace MultiColSLAM
 		std::vector<double> timingTrackLocalMap;
 		std::vector<double> timingInitalPoseEst;
 
+		// degradation steps taken to stay within the frame budget
+		enum eDegradation
+		{
+			DEGRADE_NONE = 0,
+			DEGRADE_LOCAL_POINTS = 1,		// only part of the local map is projected
+			DEGRADE_POSE_ITERATIONS = 2,	// fewer iterations in the local map pose optimization
+			DEGRADE_FEATURES = 4			// fewer features per camera in the next frames
+		};
+		// per frame: extraction + tracking time in ms, budget missed, eDegradation flags
+		std::vector<double> timingFrame;
+		std::vector<bool> frameBudgetMissed;
+		std::vector<int> frameDegradation;
+		// per frame: point/camera pairs projected in the local map search
+		// and pairs rejected before by the keyframe bounds
+		std::vector<int> nrProjectionsTested;
+		std::vector<int> nrProjectionsCulled;
+		// per tracked frame: extracted features and tracked inliers per camera
+		std::vector<std::vector<int> > featuresPerCam;
+		std::vector<std::vector<int> > inliersPerCam;
+		// how often the frame to frame tracking needed the expensive paths
+		int nrFramesTracking;			// frames after the initialization
+		int nrMotionModelFrames;		// frames started with the motion model
+		int nrPreviousFrameFallbacks;	// motion model failed, matched against the previous frame
+		int nrRelocalisationFrames;		// frames that needed relocalisation
+		int nrDirectAlignments;			// direct alignments run / accepted
+		int nrDirectAlignmentsAccepted;
+		int nrLocalMapReused;			// local map kept from the last frame / rebuilt
+		int nrLocalMapRebuilt;
+
 		bool CheckFinished();
 		void Reset();
 
@@ -148,6 +188,8 @@ namespace MultiColSLAM
 
 		bool RelocalisationRequested();
 		bool Relocalisation();
+		// 0 -> no limit
+		double mdRelocBudgetMs;
 
 		void UpdateReference();
 		void UpdateReferencePoints();
@@ -156,12 +198,58 @@ namespace MultiColSLAM
 		bool TrackLocalMap();
 		int SearchReferencePointsInFrustum();
 
+		// Deadline aware tracking: extraction and tracking of a frame should take
+		// at most mdFrameBudgetMs (0 -> off). If frames miss it, the degradation
+		// level goes up one step per miss, after a while well below the budget it goes
+		// down again. Within a frame the local map search is cut as well if the
+		// remaining time is less than the last local map tracking took.
+		double RemainingFrameBudget();
+		void UpdateFrameBudget(const double& extractionTime);
+		double mdFrameBudgetMs;
+		int mnBudgetMaxLocalPoints;
+		int mnBudgetPoseIterations;
+		double mdBudgetFeatureScale;
+		int mnDegradationLevel;
+		int mnFramesUnderBudget;
+		int mnFrameDegradation;
+		size_t mnLocalPointsOffset;
+		double mdLastTrackLocalMapTime;
+		double mdCurrentExtractionTime;
+		HResClk::time_point mtFrameStart;
+		// features per camera, written by tracking, applied in ExtractFrame
+		int mnFeatures;
+		std::atomic<int> mnFeatureBudget;
+
 		bool NeedNewKeyFrame();
 		void CreateNewKeyFrame();
+
+		// the initialization extractor is used until tracking works,
+		// mirrors mState for ExtractFrame
+		std::atomic<bool> mbUseInitExtractor;
+
+		// drops pointers to bad objects before announcing a quiescent state
+		void ReleaseBadReferences();
+		int mnReclaimerId;
+
 		void CountNumberTrackedPointsPerCam();
 		std::vector<int> nbTrackedPtsInCam;
 		std::vector<double> nbTrackedRatios;
 
+		// Adaptive features per camera: after each tracked frame the features of all
+		// cameras are redistributed by the inlier yield (tracked inliers per extracted
+		// feature) of each camera, smoothed over the last frames. The yield is used
+		// instead of the plain inlier count, otherwise a camera that got fewer features
+		// would get even fewer in the next frame. The total stays the same and each
+		// camera keeps between mdFeatureScaleMin and mdFeatureScaleMax times its share.
+		void UpdateFeatureDistribution();
+		bool mbAdaptiveFeatures;
+		double mdFeatureScaleMin;
+		double mdFeatureScaleMax;
+		std::vector<double> mvdInlierYield;
+		// written by tracking, read in ExtractFrame, sums up to the number of cameras
+		std::mutex mMutexFeatureScales;
+		std::vector<double> mvdFeatureScales;
+
 		//Other Thread Pointers
 		cLocalMapping* mpLocalMapper;
 		cLoopClosing* mpLoopClosing;
@@ -185,6 +273,55 @@ namespace MultiColSLAM
 		std::vector<double> mvpLocalKeyFramesDistance2Frame;
 		std::vector<cMapPoint*> mvpLocalMapPoints;
 
+		// The local map is maintained incrementally between keyframe insertions:
+		// only tracked points that appear or disappear change the keyframe votes,
+		// only keyframes entering or leaving the local map change the point list.
+		// Everything is rebuilt after a new keyframe (in the tracker and once local
+		// mapping added it to the map), relocalisation, loop closure or reset, and
+		// when a keyframe of the local map changed its matches or observations
+		// (cMultiKeyFrame::GetObservationVersion). Erased objects are only pruned.
+		struct sLocalMapVoter
+		{
+			std::vector<cMultiKeyFrame*> vpKFs; // keyframes observing the point
+			int nVotes;							// occurrences in the frame counted in the votes
+			int nSeen;							// occurrences in the current frame
+			long unsigned int nLastFrame;
+		};
+		void ClearLocalMapCaches();
+		void AddLocalMapPoint(cMapPoint* pMP);
+		void RemoveLocalMapPoint(cMapPoint* pMP);
+		void PruneLocalMapCaches();
+		std::atomic<bool> mbLocalMapDirty;
+		unsigned long mnLocalMapEraseVersion;
+		unsigned int mnLocalMapMaxKFid;
+		std::map<cMultiKeyFrame*, int> mLocalKeyFrameVotes;
+		std::unordered_map<cMapPoint*, sLocalMapVoter> mLocalMapVoters;
+		// the points of each local keyframe at the time it entered the local map
+		std::unordered_map<cMultiKeyFrame*, std::vector<cMapPoint*> > mLocalKeyFramePoints;
+		// number of references from local keyframes and position in mvpLocalMapPoints
+		std::unordered_map<cMapPoint*, std::pair<int, size_t> > mLocalMapPointRefs;
+
+		// Coarse culling before the local map projection. Each local keyframe gets a
+		// bounding sphere of its points and the union of their scale invariance
+		// distances. If a camera is too close or too far from every point of the sphere,
+		// isInFrustum would reject all of them, so the projections are skipped. A point
+		// is skipped only if all local keyframes it belongs to were culled.
+		// The bounds are kept until a map point moves (cMap::GetGeometryVersion).
+		struct sLocalKeyFrameBounds
+		{
+			cv::Vec3d center;
+			double radius;
+			double minDistance;		// smallest GetMinDistanceInvariance of the points
+			double maxDistance;		// largest GetMaxDistanceInvariance of the points
+		};
+		void ComputeLocalKeyFrameBounds(const std::vector<cMapPoint*>& vpMPs,
+			sLocalKeyFrameBounds& bounds);
+		// counts culled local keyframes per point and camera in mvnCulledKeyFrames
+		int CullLocalMapPoints();
+		unsigned long mnLocalBoundsVersion;
+		std::unordered_map<cMultiKeyFrame*, sLocalKeyFrameBounds> mLocalKeyFrameBounds;
+		std::vector<int> mvnCulledKeyFrames;
+
 		//Publishers
 		cMultiFramePublisher* mpFramePublisher;
 		cMapPublisher* mpMapPublisher;
@@ -225,6 +362,24 @@ namespace MultiColSLAM
 		bool mbMotionModel;
 		cv::Matx44d mVelocity;
 
+		// Uncertainty of the constant velocity prediction: second moment of the difference
+		// (rotation, translation in the MCS frame) between predicted and optimized pose,
+		// averaged over the last frames. With Tracking.AdaptiveSearchWindow it sets the
+		// search window of each point in TrackWithMotionModel.
+		void UpdatePredictionCovariance();
+		bool mbAdaptiveSearchWindow;
+		double mdMinSearchRadius;
+		cv::Matx44d mPredictedPose;
+		bool mbPosePredicted;
+		cv::Matx66d mPredictionCov;
+		int mnPredictionSamples;
+
+		// refine the prediction by direct alignment to the last frame
+		// before the feature matching (see cOptimizer::PoseAlignmentDirect)
+		bool mbDirectAlignment;
+		int mnDirectAlignmentTopLevel;
+		int mnDirectAlignmentBottomLevel;
+
 		//Color order (true RGB, false BGR, ignored if grayscale)
 		bool mbRGB;
 
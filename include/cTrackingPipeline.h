@@ -0,0 +1,188 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACKINGPIPELINE_H
+#define TRACKINGPIPELINE_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "cBoundedQueue.h"
+#include "cMultiFrame.h"
+
+namespace MultiColSLAM
+{
+	class cSystem;
+	class cTracking;
+
+	// Two stage tracking: one thread extracts the features of the next image set
+	// (builds the cMultiFrame) while a second thread tracks the current one.
+	// Both stages are connected by a queue holding a single frame, so the
+	// extraction can run at most one frame ahead of tracking.
+	//
+	// Latency: a pose is only available once the frame has passed both stages.
+	// Submit returns immediately (unless the input queue is full), a caller
+	// that waits for the pose of frame N-1 before submitting frame N+1 keeps
+	// both stages busy and gets every pose one frame later than with
+	// cSystem::TrackMultiColSLAM. Throughput goes up to roughly
+	// 1 / max(extraction, tracking) instead of 1 / (extraction + tracking).
+	//
+	// The extractor (initialization or tracking) is chosen with the tracking
+	// state after the previously tracked frame, so it can lag by one frame.
+	// The images are not copied, the caller must not write into a submitted
+	// image before its pose is available.
+	//
+	// For live cameras TrySubmit never blocks. If tracking can not keep up and
+	// the input queue is full, frames are dropped according to the drop policy.
+	// Results can be received with a callback (called on the tracking thread,
+	// keep it short) or polled, and the futures of Submit still work.
+	//
+	// A requested reset is applied by the tracking thread while no frame is
+	// being extracted (frame ids and the extractor are reset with the tracker).
+	// Frames extracted before the reset are dropped, their futures throw.
+	class cTrackingPipeline
+	{
+	public:
+		// what TrySubmit does with a new frame if the input queue is full
+		enum eDropPolicy
+		{
+			DROP_OLDEST = 0,	// the oldest queued frame makes room, lowest latency
+			DROP_NEWEST = 1,	// the new frame is dropped, queued frames are kept
+			KEEP_EVERY_KTH = 2	// while full, only every k-th new frame replaces the oldest one
+		};
+
+		struct sPoseResult
+		{
+			double timestamp;
+			cv::Matx44d pose;
+			bool bTracked;	// false if tracking is lost or not initialized yet
+		};
+
+		struct sIngestionStats
+		{
+			unsigned long nSubmitted;
+			unsigned long nDropped;
+			unsigned long nProcessed;
+			size_t nQueueDepth;
+			size_t nMaxQueueDepth;
+		};
+
+		typedef std::function<void(const sPoseResult&)> PoseCallback;
+
+		cTrackingPipeline(cSystem* pSys, cTracking* pTracker,
+			const size_t& inputQueueSize = 1,
+			const eDropPolicy& dropPolicy = DROP_OLDEST,
+			const int& keepEveryK = 2);
+		~cTrackingPipeline();
+
+		// queues the image set for extraction, blocks while the input queue is full.
+		// The future throws if the image set could not be processed.
+		std::future<cv::Matx44d> Submit(const std::vector<cv::Mat>& imgSet,
+			const double& timestamp);
+
+		// queues the image set without blocking, applies the drop policy if the
+		// input queue is full. Returns false if this image set was dropped.
+		bool TrySubmit(const std::vector<cv::Mat>& imgSet,
+			const double& timestamp);
+
+		// replaces the callback, an empty one switches back to polling.
+		// The callback runs on the tracking thread without a pipeline lock held,
+		// a result already being published may still reach the old one
+		void SetPoseCallback(const PoseCallback& callback);
+		// oldest result that was not polled yet, returns false if there is none.
+		// Only the last kMaxPolledResults results are kept.
+		bool PollPose(sPoseResult& result);
+
+		sIngestionStats GetStats();
+
+		// processes everything that was submitted and stops both threads
+		void Finish();
+
+		static const size_t kMaxPolledResults = 128;
+
+	protected:
+		struct sImageSet
+		{
+			std::vector<cv::Mat> images;
+			double timestamp;
+			std::promise<cv::Matx44d> pose;
+		};
+
+		struct sFrame
+		{
+			std::unique_ptr<cMultiFrame> frame;
+			double timestamp;
+			std::promise<cv::Matx44d> pose;
+			// mnResets when the frame was extracted
+			unsigned long nResets;
+		};
+
+		sImageSet MakeImageSet(const std::vector<cv::Mat>& imgSet,
+			const double& timestamp, std::future<cv::Matx44d>* pPose);
+		void Dropped(sImageSet& imageSet);
+		// applies a requested reset, returns false if the frame was
+		// extracted before the last reset and has to be dropped
+		bool CheckReset(const sFrame& frame);
+		void Publish(const sPoseResult& result);
+
+		void RunExtraction();
+		void RunTracking();
+
+		cSystem* mpSystem;
+		cTracking* mpTracker;
+
+		cBoundedQueue<sImageSet> mqImageSets;
+		cBoundedQueue<sFrame> mqFrames;
+
+		const eDropPolicy meDropPolicy;
+		const int mnKeepEveryK;
+		// serializes the producers, so the overload counting stays consistent
+		std::mutex mMutexSubmit;
+		unsigned long mnOverloadCount;
+
+		std::mutex mMutexResults;
+		PoseCallback mPoseCallback;
+		std::deque<sPoseResult> mqResults;
+
+		std::atomic<unsigned long> mnSubmitted;
+		std::atomic<unsigned long> mnDropped;
+		std::atomic<unsigned long> mnProcessed;
+		std::atomic<size_t> mnMaxQueueDepth;
+
+		std::thread* mptExtraction;
+		std::thread* mptTracking;
+
+		// held while a frame is extracted, a reset waits for it
+		std::mutex mMutexExtraction;
+		unsigned long mnResets;
+
+		std::mutex mMutexFinish;
+		bool mbFinished;
+	};
+}
+#endif // TRACKINGPIPELINE_H
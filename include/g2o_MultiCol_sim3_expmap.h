@@ -97,6 +97,10 @@ namespace MultiColSLAM
 			_error = error_.log();
 		}
 
+		// numeric like g2o::BaseBinaryEdge, but on copies of the estimates,
+		// so edges sharing a vertex can be linearized at the same time
+		virtual void linearizeOplus();
+
 		virtual double initialEstimatePossible(
 			const g2o::OptimizableGraph::VertexSet&, g2o::OptimizableGraph::Vertex*)
 		{
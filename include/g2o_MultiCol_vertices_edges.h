@@ -32,11 +32,39 @@
 
 namespace MultiColSLAM
 {
-	void mcsJacs1(const cv::Vec3d& pt3,
-		const cv::Matx61d& M_t,
-		const cv::Matx61d& M_c,
+	// cayley2hom of a 6x1 pose as rotation and translation, together with
+	// the derivatives of the rotation by the three cayley parameters
+	struct sCayleyTransform
+	{
+		sCayleyTransform() { Set(cv::Matx61d::zeros()); }
+		explicit sCayleyTransform(const cv::Matx61d& cayley) { Set(cayley); }
+		void Set(const cv::Matx61d& cayley);
+
+		Eigen::Matrix3d R;
+		Eigen::Vector3d t;
+		Eigen::Matrix3d dR[3];
+	};
+
+	// point in the frame of the camera M_t * M_c (inverse of it applied to pt3)
+	inline Eigen::Vector3d mcsToCamera(const Eigen::Vector3d& pt3,
+		const sCayleyTransform& M_t,
+		const sCayleyTransform& M_c)
+	{
+		return M_c.R.transpose() * (M_t.R.transpose() * (pt3 - M_t.t) - M_c.t);
+	}
+
+	// Jacobians of the projection (not the error) by the chain rule
+	// from the transforms of M_t and M_c. Only the blocks with an output are computed:
+	// point (2x3), M_t (2x6), M_c (2x6) and the interior orientation (2x17).
+	// The interior orientation columns are in the order of camModelData.
+	void mcsJacsChain(const Eigen::Vector3d& pt3,
+		const sCayleyTransform& M_t,
+		const sCayleyTransform& M_c,
 		const Eigen::Matrix<double, 12 + 5, 1>& camModelData,
-		cv::Matx<double, 2, 32>& jacs);
+		Eigen::Matrix<double, 2, 3>* pJacPoint,
+		Eigen::Matrix<double, 2, 6>* pJacMt,
+		Eigen::Matrix<double, 2, 6>* pJacMc,
+		Eigen::Matrix<double, 2, 12 + 5>* pJacCam);
 
 	// newly defined in g2o related part
 	class VertexOmniCameraParameters : public g2o::BaseVertex<5 + 12, Eigen::Matrix<double, 5 + 12, 1>>
@@ -87,6 +115,15 @@ namespace MultiColSLAM
 
 			VertexMt_cayley() {}
 
+		// the transform of the estimate, kept up to date by updateCache,
+		// which g2o calls after every oplus, setEstimate and pop
+		const sCayleyTransform& Transform() const { return mTransform; }
+		virtual void updateCache()
+		{
+			g2o::BaseVertex<6, cv::Matx61d>::updateCache();
+			mTransform.Set(_estimate);
+		}
+
 		virtual void setToOriginImpl()
 		{
 			_estimate = cv::Matx61d(0, 0, 0, 0, 0, 0);
@@ -110,6 +147,8 @@ namespace MultiColSLAM
 			return false;
 		}
 
+	protected:
+		sCayleyTransform mTransform;
 	};
 
 	/**
@@ -121,6 +160,15 @@ namespace MultiColSLAM
 
 			VertexMc_cayley() {}
 
+		// the transform of the estimate, kept up to date by updateCache,
+		// which g2o calls after every oplus, setEstimate and pop
+		const sCayleyTransform& Transform() const { return mTransform; }
+		virtual void updateCache()
+		{
+			g2o::BaseVertex<6, cv::Matx61d>::updateCache();
+			mTransform.Set(_estimate);
+		}
+
 		virtual void setToOriginImpl()
 		{
 			_estimate = cv::Matx61d(0, 0, 0, 0, 0, 0);
@@ -143,6 +191,8 @@ namespace MultiColSLAM
 			return false;
 		}
 
+	protected:
+		sCayleyTransform mTransform;
 	};
 
 	/**
@@ -367,7 +367,14 @@ namespace MultiColSLAM
 		bool GetMasksLearned() { return learnMasks; }
 		int GetDescriptorSize() { return descSize; }
 
+		// changes the number of extracted features, must not be called while extracting
+		void SetNumFeatures(const int& _nfeatures);
+		int GetNumFeatures() { return nfeatures; }
+		// pyramid of the last image, every image gets newly allocated levels
+		std::vector<cv::Mat> GetImagePyramid() { return mvImagePyramid; }
+
 	protected:
+		void ComputeFeaturesPerLevel();
 		void ComputePyramid(cv::Mat image, cv::Mat Mask = cv::Mat());
 
 		void ComputeKeyPointsOctTree(
@@ -85,6 +85,32 @@ namespace MultiColSLAM
 	double T_in_ns(HResClk::time_point start,
 		HResClk::time_point end);
 
+	/**
+	* Hardware cache miss counters of the calling thread (Linux perf events)
+	* Counts L1 data cache read misses and last level cache misses
+	* between Start and Stop. If the counters are not available
+	* (no Linux, no permission, virtual machine) the counts are -1.
+	*/
+	class cCacheMissCounter
+	{
+	public:
+		cCacheMissCounter();
+		~cCacheMissCounter();
+
+		bool Available() const { return mFdL1 >= 0 || mFdLLC >= 0; }
+
+		void Start();
+		void Stop();
+
+		long long L1Misses() const { return mnL1Misses; }
+		long long LLCMisses() const { return mnLLCMisses; }
+	private:
+		int mFdL1;
+		int mFdLLC;
+		long long mnL1Misses;
+		long long mnLLCMisses;
+	};
+
 
 	/**
 	* median
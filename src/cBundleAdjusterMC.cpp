@@ -0,0 +1,630 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cBundleAdjusterMC.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "misc.h"
+
+namespace MultiColSLAM
+{
+	namespace
+	{
+		inline double HuberRho(const double& chi2, const double& delta)
+		{
+			const double delta2 = delta * delta;
+			if (chi2 <= delta2)
+				return chi2;
+			return 2.0 * delta * std::sqrt(chi2) - delta2;
+		}
+
+		inline double HuberWeight(const double& chi2, const double& delta)
+		{
+			if (chi2 <= delta * delta)
+				return 1.0;
+			return delta / std::sqrt(chi2);
+		}
+
+		// atan in float without calls, so the loops of LinearizeMixed vectorize.
+		// Cephes atanf: reduction to |x| <= tan(pi/8) and a polynomial of degree 9
+		inline float AtanF(const float& w)
+		{
+			const float a = std::fabs(w);
+			const bool bBig = a > 2.414213562f;
+			const bool bMid = a > 0.414213562f;
+			// both quotients unconditionally, selects instead of branches
+			const float xBig = -1.0f / (a + 1e-30f);
+			const float xMid = (a - 1.0f) / (a + 1.0f);
+			const float x = bBig ? xBig : (bMid ? xMid : a);
+			const float offset = bBig ? 1.570796327f : (bMid ? 0.785398163f : 0.0f);
+			const float z = x * x;
+			const float r = offset + ((((8.05374449538e-2f * z - 1.38776856032e-1f) * z +
+				1.99777106478e-1f) * z - 3.33329491539e-1f) * z * x + x);
+			return w < 0.0f ? -r : r;
+		}
+
+		// out = v^T M and out = M v for a row major 3x3 M
+		inline void RowTimes3x3(const float* v, const float* M, float* out)
+		{
+			out[0] = v[0] * M[0] + v[1] * M[3] + v[2] * M[6];
+			out[1] = v[0] * M[1] + v[1] * M[4] + v[2] * M[7];
+			out[2] = v[0] * M[2] + v[1] * M[5] + v[2] * M[8];
+		}
+
+		inline void MatTimes3(const float* M, const float* v, float* out)
+		{
+			out[0] = M[0] * v[0] + M[1] * v[1] + M[2] * v[2];
+			out[1] = M[3] * v[0] + M[4] * v[1] + M[5] * v[2];
+			out[2] = M[6] * v[0] + M[7] * v[1] + M[8] * v[2];
+		}
+	}
+
+	cBundleAdjusterMC::cBundleAdjusterMC() :
+		mnCams(0), mnFreePoses(0), mdHuberDelta(1.345 * 2.0), mdGainThreshold(1e-6), mnThreads(1),
+		mbMixedPrecision(false)
+	{
+	}
+
+	void cBundleAdjusterMC::SetCameraSystem(cMultiCamSys_& camSystem)
+	{
+		mnCams = camSystem.GetNrCams();
+		mvCamModels.resize(mnCams);
+		mvCamModelData.resize(mnCams);
+		mvMcTransforms.resize(mnCams);
+		for (int c = 0; c < mnCams; ++c)
+		{
+			mvCamModels[c] = camSystem.GetCamModelObj(c);
+			mvCamModelData[c] = mvCamModels[c].toVector();
+			mvMcTransforms[c].Set(camSystem.Get_M_c_min(c));
+		}
+	}
+
+	int cBundleAdjusterMC::AddPose(const cv::Matx61d& Mt, const bool& fixed)
+	{
+		mvPoses.push_back(Mt);
+		mvPoseFreeIdx.push_back(fixed ? -1 : mnFreePoses++);
+		return static_cast<int>(mvPoses.size()) - 1;
+	}
+
+	int cBundleAdjusterMC::AddPoint(const cv::Vec3d& pt3)
+	{
+		mvPoints.push_back(pt3(0));
+		mvPoints.push_back(pt3(1));
+		mvPoints.push_back(pt3(2));
+		return NrPoints() - 1;
+	}
+
+	int cBundleAdjusterMC::AddObservation(const int& pose, const int& point, const int& cam,
+		const double& u, const double& v, const double& invSigma2)
+	{
+		mvObsPose.push_back(pose);
+		mvObsPoint.push_back(point);
+		mvObsCam.push_back(cam);
+		mvObsU.push_back(u);
+		mvObsV.push_back(v);
+		mvObsInvSigma2.push_back(invSigma2);
+		mvbActive.push_back(1);
+		return NrObservations() - 1;
+	}
+
+	cv::Vec3d cBundleAdjusterMC::GetPoint(const int& point) const
+	{
+		const double* X = &mvPoints[3 * point];
+		return cv::Vec3d(X[0], X[1], X[2]);
+	}
+
+	void cBundleAdjusterMC::Clear()
+	{
+		mvPoses.clear();
+		mvPoseFreeIdx.clear();
+		mnFreePoses = 0;
+		mvPoints.clear();
+		mvObsPose.clear();
+		mvObsPoint.clear();
+		mvObsCam.clear();
+		mvObsU.clear();
+		mvObsV.clear();
+		mvObsInvSigma2.clear();
+		mvbActive.clear();
+	}
+
+	void cBundleAdjusterMC::UpdateTransforms()
+	{
+		mvPoseTransforms.resize(mvPoses.size());
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+			mvPoseTransforms[p].Set(mvPoses[p]);
+	}
+
+	// reprojection error like EdgeProjectXYZ2MCS::computeError
+	void cBundleAdjusterMC::ComputeErrors()
+	{
+		const int nObs = NrObservations();
+		mvErr.resize(2 * nObs);
+#pragma omp parallel for schedule(static) num_threads(mnThreads) if (mnThreads > 1)
+		for (int i = 0; i < nObs; ++i)
+		{
+			const int c = mvObsCam[i];
+			const Eigen::Vector3d Xc = mcsToCamera(Eigen::Map<const Eigen::Vector3d>(&mvPoints[3 * mvObsPoint[i]]),
+				mvPoseTransforms[mvObsPose[i]], mvMcTransforms[c]);
+			double u = 0.0, v = 0.0;
+			mvCamModels[c].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+			mvErr[2 * i] = mvObsU[i] - u;
+			mvErr[2 * i + 1] = mvObsV[i] - v;
+		}
+	}
+
+	double cBundleAdjusterMC::Chi2(const int& obs) const
+	{
+		const double eu = mvErr[2 * obs];
+		const double ev = mvErr[2 * obs + 1];
+		return mvObsInvSigma2[obs] * (eu * eu + ev * ev);
+	}
+
+	double cBundleAdjusterMC::RobustChi2() const
+	{
+		double chi2Sum = 0.0;
+		for (int i = 0, iend = NrObservations(); i < iend; ++i)
+			if (mvbActive[i])
+				chi2Sum += HuberRho(Chi2(i), mdHuberDelta);
+		return chi2Sum;
+	}
+
+	void cBundleAdjusterMC::BuildPointIndex()
+	{
+		// counting sort of the observations by point
+		const int nPoints = NrPoints();
+		const int nObs = NrObservations();
+		mvPointObsStart.assign(nPoints + 1, 0);
+		for (int i = 0; i < nObs; ++i)
+			++mvPointObsStart[mvObsPoint[i] + 1];
+		for (int j = 0; j < nPoints; ++j)
+			mvPointObsStart[j + 1] += mvPointObsStart[j];
+		mvPointObs.resize(nObs);
+		std::vector<int> vFill(mvPointObsStart.begin(), mvPointObsStart.end() - 1);
+		for (int i = 0; i < nObs; ++i)
+			mvPointObs[vFill[mvObsPoint[i]]++] = i;
+	}
+
+	void cBundleAdjusterMC::BuildRunIndex()
+	{
+		// counting sort of the observations by camera and pose
+		const int nObs = NrObservations();
+		const int nPoses = NrPoses();
+		mvRunStart.assign(mnCams * nPoses + 1, 0);
+		for (int i = 0; i < nObs; ++i)
+			++mvRunStart[mvObsCam[i] * nPoses + mvObsPose[i] + 1];
+		for (int q = 0; q < mnCams * nPoses; ++q)
+			mvRunStart[q + 1] += mvRunStart[q];
+		mvRunObs.resize(nObs);
+		std::vector<int> vFill(mvRunStart.begin(), mvRunStart.end() - 1);
+		for (int i = 0; i < nObs; ++i)
+			mvRunObs[vFill[mvObsCam[i] * nPoses + mvObsPose[i]]++] = i;
+	}
+
+	// the error is measurement - projection, see EdgeProjectXYZ2MCS::linearizeOplus
+	void cBundleAdjusterMC::Linearize()
+	{
+		const int nObs = NrObservations();
+		mvWeight.resize(nObs);
+		if (!mbMixedPrecision)
+		{
+			mvJacPose.resize(12 * nObs);
+			mvJacPoint.resize(6 * nObs);
+		}
+		ComputeErrors();
+#pragma omp parallel for schedule(static) num_threads(mnThreads) if (mnThreads > 1)
+		for (int i = 0; i < nObs; ++i)
+		{
+			if (!mvbActive[i])
+				continue;
+			const int c = mvObsCam[i];
+			mvWeight[i] = mvObsInvSigma2[i] * HuberWeight(Chi2(i), mdHuberDelta);
+			if (mbMixedPrecision)
+				continue;
+
+			// the pose Jacobian is not needed for fixed poses
+			const bool bFreePose = mvPoseFreeIdx[mvObsPose[i]] >= 0;
+			Eigen::Matrix<double, 2, 3> jacPoint;
+			Eigen::Matrix<double, 2, 6> jacPose;
+			mcsJacsChain(Eigen::Map<const Eigen::Vector3d>(&mvPoints[3 * mvObsPoint[i]]),
+				mvPoseTransforms[mvObsPose[i]], mvMcTransforms[c], mvCamModelData[c],
+				&jacPoint, bFreePose ? &jacPose : NULL, NULL, NULL);
+			Eigen::Map<Eigen::Matrix<double, 2, 3, Eigen::RowMajor> > Jl(&mvJacPoint[6 * i]);
+			Jl = -jacPoint;
+			if (bFreePose)
+			{
+				Eigen::Map<Eigen::Matrix<double, 2, 6, Eigen::RowMajor> > Jp(&mvJacPose[12 * i]);
+				Jp = -jacPose;
+			}
+		}
+		if (mbMixedPrecision)
+			LinearizeMixed();
+	}
+
+	// mcsJacsChain and ProjectionDerivatives in float. The points and the pose
+	// translations are taken relative to the first pose, the world coordinates
+	// could be too large for float. Within a run of one camera and one pose
+	// only the point differs, so the loop over the run vectorizes with one gather.
+	// The inactive observations and the pose Jacobians of the fixed poses are
+	// computed as well, that is cheaper than the branches
+	void cBundleAdjusterMC::LinearizeMixed()
+	{
+		const int nObs = NrObservations();
+		const int nPoints = NrPoints();
+		const int nPoses = NrPoses();
+		mvJacPoseRunF.resize(12 * nObs);
+		mvJacPointRunF.resize(6 * nObs);
+		const Eigen::Vector3d origin = mvPoseTransforms.empty() ?
+			Eigen::Vector3d::Zero() : mvPoseTransforms[0].t;
+		mvPoseDataF.resize(39 * nPoses);
+		for (int p = 0; p < nPoses; ++p)
+		{
+			float* R = &mvPoseDataF[39 * p];
+			const sCayleyTransform& T = mvPoseTransforms[p];
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int m = 0; m < 3; ++m)
+				{
+					R[3 * r + m] = static_cast<float>(T.R(m, r));
+					for (int k = 0; k < 3; ++k)
+						R[9 + 9 * k + 3 * r + m] = static_cast<float>(T.dR[k](m, r));
+				}
+				R[36 + r] = static_cast<float>(T.t(r) - origin(r));
+			}
+		}
+		mvPointsF.resize(3 * nPoints);
+		for (int j = 0; j < nPoints; ++j)
+			for (int r = 0; r < 3; ++r)
+				mvPointsF[3 * j + r] = static_cast<float>(mvPoints[3 * j + r] - origin(r));
+
+		const float* pPoints = mvPointsF.data();
+		const int* pRunObs = mvRunObs.data();
+		const int* pObsPoint = mvObsPoint.data();
+		float* pJacPose = mvJacPoseRunF.data();
+		float* pJacPoint = mvJacPointRunF.data();
+#pragma omp parallel for schedule(dynamic) num_threads(mnThreads) if (mnThreads > 1)
+		for (int q = 0; q < mnCams * nPoses; ++q)
+		{
+			const int begin = mvRunStart[q];
+			const int end = mvRunStart[q + 1];
+			if (begin == end)
+				continue;
+			const int c = q / nPoses;
+			const float* R = &mvPoseDataF[39 * (q % nPoses)];
+			// Rc^T, tc and the interior orientation
+			float Rc[9], tc[3], poly[12];
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int m = 0; m < 3; ++m)
+					Rc[3 * r + m] = static_cast<float>(mvMcTransforms[c].R(m, r));
+				tc[r] = static_cast<float>(mvMcTransforms[c].t(r));
+			}
+			const Eigen::Matrix<double, 12 + 5, 1>& camModelData = mvCamModelData[c];
+			const float ca = static_cast<float>(camModelData(0));
+			const float cd = static_cast<float>(camModelData(1));
+			const float ce = static_cast<float>(camModelData(2));
+			for (int k = 0; k < 12; ++k)
+				poly[k] = static_cast<float>(camModelData(5 + k));
+
+			// the slots are distinct, so the stores can not alias the loads
+#pragma GCC ivdep
+			for (int k = begin; k < end; ++k)
+			{
+				const int xi = 3 * pObsPoint[pRunObs[k]];
+				const float dX[3] = { pPoints[xi] - R[36], pPoints[xi + 1] - R[37], pPoints[xi + 2] - R[38] };
+
+				// Y = Rt^T (X - tt), Xc = Rc^T (Y - tc)
+				float dY[3], Xc[3];
+				MatTimes3(R, dX, dY);
+				for (int r = 0; r < 3; ++r)
+					dY[r] -= tc[r];
+				MatTimes3(Rc, dY, Xc);
+				const float x = Xc[0], y = Xc[1], z = Xc[2];
+
+				// derivatives of the projection by Xc
+				const float nxy = std::sqrt(x * x + y * y);
+				const float n = nxy > 0.0f ? nxy : 1e-14f;
+				const float n2 = n * n;
+				const float n3 = n2 * n;
+				const float w = -z / n;
+				const float theta = AtanF(w);
+				float rho = 0.0f, drho = 0.0f;
+				for (int m = 11; m >= 0; --m)
+				{
+					drho = drho * theta + rho;
+					rho = rho * theta + poly[m];
+				}
+				const float xn = x / n, yn = y / n;
+				const float dth = 1.0f / (1.0f + w * w);
+				const float tx = dth * z * x / n3, ty = dth * z * y / n3, tz = -dth / n;
+				const float u0 = y * y / n3 * rho + xn * drho * tx;
+				const float u1 = -x * y / n3 * rho + xn * drho * ty;
+				const float u2 = xn * drho * tz;
+				const float v0 = -x * y / n3 * rho + yn * drho * tx;
+				const float v1 = x * x / n3 * rho + yn * drho * ty;
+				const float v2 = yn * drho * tz;
+				const float P[6] = {
+					ca * u0 + cd * v0, ca * u1 + cd * v1, ca * u2 + cd * v2,
+					ce * u0 + v0, ce * u1 + v1, ce * u2 + v2 };
+
+				// P Rc^T, the point Jacobian P Rc^T Rt^T and the rotation columns
+				// P Rc^T dRt_k^T (X - tt), the error has the opposite sign
+				float PRc[6], PRcRt[6], D[9];
+				RowTimes3x3(P, Rc, PRc);
+				RowTimes3x3(P + 3, Rc, PRc + 3);
+				RowTimes3x3(PRc, R, PRcRt);
+				RowTimes3x3(PRc + 3, R, PRcRt + 3);
+				MatTimes3(R + 9, dX, D);
+				MatTimes3(R + 18, dX, D + 3);
+				MatTimes3(R + 27, dX, D + 6);
+				for (int m = 0; m < 3; ++m)
+				{
+					pJacPoint[m * nObs + k] = -PRcRt[m];
+					pJacPoint[(3 + m) * nObs + k] = -PRcRt[3 + m];
+					pJacPose[m * nObs + k] = -(PRc[0] * D[3 * m] + PRc[1] * D[3 * m + 1] + PRc[2] * D[3 * m + 2]);
+					pJacPose[(3 + m) * nObs + k] = PRcRt[m];
+					pJacPose[(6 + m) * nObs + k] = -(PRc[3] * D[3 * m] + PRc[4] * D[3 * m + 1] + PRc[5] * D[3 * m + 2]);
+					pJacPose[(9 + m) * nObs + k] = PRcRt[3 + m];
+				}
+			}
+		}
+
+		// by observation, rows of the 2x6 and 2x3 blocks one after the other
+		mvJacPoseF.resize(12 * nObs);
+		mvJacPointF.resize(6 * nObs);
+#pragma omp parallel for schedule(static) num_threads(mnThreads) if (mnThreads > 1)
+		for (int k = 0; k < nObs; ++k)
+		{
+			const int i = pRunObs[k];
+			float* Jp = &mvJacPoseF[12 * i];
+			float* Jl = &mvJacPointF[6 * i];
+			for (int m = 0; m < 12; ++m)
+				Jp[m] = pJacPose[m * nObs + k];
+			for (int m = 0; m < 6; ++m)
+				Jl[m] = pJacPoint[m * nObs + k];
+		}
+	}
+
+	inline Eigen::Matrix<double, 2, 6> cBundleAdjusterMC::JacPose(const int& obs) const
+	{
+		if (!mbMixedPrecision)
+			return Eigen::Map<const Eigen::Matrix<double, 2, 6, Eigen::RowMajor> >(&mvJacPose[12 * obs]);
+		return Eigen::Map<const Eigen::Matrix<float, 2, 6, Eigen::RowMajor> >(
+			&mvJacPoseF[12 * obs]).cast<double>();
+	}
+
+	inline Eigen::Matrix<double, 2, 3> cBundleAdjusterMC::JacPoint(const int& obs) const
+	{
+		if (!mbMixedPrecision)
+			return Eigen::Map<const Eigen::Matrix<double, 2, 3, Eigen::RowMajor> >(&mvJacPoint[6 * obs]);
+		return Eigen::Map<const Eigen::Matrix<float, 2, 3, Eigen::RowMajor> >(
+			&mvJacPointF[6 * obs]).cast<double>();
+	}
+
+	void cBundleAdjusterMC::BuildBlocks()
+	{
+		mvHpp.assign(mnFreePoses, Mat66::Zero());
+		mvGp.assign(mnFreePoses, Eigen::Matrix<double, 6, 1>::Zero());
+		mvHll.assign(NrPoints(), Mat33::Zero());
+		mvGl.assign(NrPoints(), Eigen::Vector3d::Zero());
+		mvHpl.resize(NrObservations());
+		for (int i = 0, iend = NrObservations(); i < iend; ++i)
+		{
+			if (!mvbActive[i])
+				continue;
+			const Eigen::Matrix<double, 2, 3> Jl = JacPoint(i);
+			const Eigen::Vector2d e(mvErr[2 * i], mvErr[2 * i + 1]);
+			const double w = mvWeight[i];
+
+			const int j = mvObsPoint[i];
+			mvHll[j].noalias() += w * Jl.transpose() * Jl;
+			mvGl[j].noalias() += w * Jl.transpose() * e;
+			const int f = mvPoseFreeIdx[mvObsPose[i]];
+			if (f < 0)
+				continue;
+			const Eigen::Matrix<double, 2, 6> Jp = JacPose(i);
+			mvHpp[f].noalias() += w * Jp.transpose() * Jp;
+			mvGp[f].noalias() += w * Jp.transpose() * e;
+			mvHpl[i].noalias() = w * Jp.transpose() * Jl;
+		}
+	}
+
+	// (Hpp - Hpl Hll^-1 Hpl^T) dp = -gp + Hpl Hll^-1 gl
+	// dl = Hll^-1 (-gl - Hpl^T dp)
+	// with lambda added to the diagonal of Hpp and Hll
+	bool cBundleAdjusterMC::SolveDamped(const double& lambda)
+	{
+		const int nPoints = NrPoints();
+		const int dim = 6 * mnFreePoses;
+		mS.setZero(dim, dim);
+		mRhs.resize(dim);
+		for (int f = 0; f < mnFreePoses; ++f)
+		{
+			mS.block<6, 6>(6 * f, 6 * f) = mvHpp[f] + lambda * Mat66::Identity();
+			mRhs.segment<6>(6 * f) = -mvGp[f];
+		}
+
+		mvHllInv.resize(nPoints);
+		std::vector<Mat63, Eigen::aligned_allocator<Mat63> > vW;
+		std::vector<Mat63, Eigen::aligned_allocator<Mat63> > vY;
+		std::vector<int> vF;
+		for (int j = 0; j < nPoints; ++j)
+		{
+			mvHllInv[j] = (mvHll[j] + lambda * Mat33::Identity()).inverse();
+			const Mat33& Hinv = mvHllInv[j];
+
+			// Hpl blocks of this point, one per observation from a free pose
+			vW.clear();
+			vY.clear();
+			vF.clear();
+			for (int k = mvPointObsStart[j]; k < mvPointObsStart[j + 1]; ++k)
+			{
+				const int i = mvPointObs[k];
+				const int f = mvPoseFreeIdx[mvObsPose[i]];
+				if (!mvbActive[i] || f < 0)
+					continue;
+				vW.push_back(mvHpl[i]);
+				vY.push_back(Mat63(mvHpl[i] * Hinv));
+				vF.push_back(f);
+			}
+			for (size_t a = 0; a < vW.size(); ++a)
+			{
+				mRhs.segment<6>(6 * vF[a]).noalias() += vY[a] * mvGl[j];
+				for (size_t b = 0; b < vW.size(); ++b)
+					mS.block<6, 6>(6 * vF[a], 6 * vF[b]).noalias() -= vY[a] * vW[b].transpose();
+			}
+		}
+
+		if (dim > 0)
+		{
+			mDeltaPoses = mS.ldlt().solve(mRhs);
+			if (!mDeltaPoses.allFinite())
+				return false;
+		}
+		else
+			mDeltaPoses.resize(0);
+
+		mvDeltaPoints.resize(3 * nPoints);
+		for (int j = 0; j < nPoints; ++j)
+		{
+			Eigen::Vector3d r = -mvGl[j];
+			for (int k = mvPointObsStart[j]; k < mvPointObsStart[j + 1]; ++k)
+			{
+				const int i = mvPointObs[k];
+				const int f = mvPoseFreeIdx[mvObsPose[i]];
+				if (!mvbActive[i] || f < 0)
+					continue;
+				r.noalias() -= mvHpl[i].transpose() * mDeltaPoses.segment<6>(6 * f);
+			}
+			const Eigen::Vector3d dl = mvHllInv[j] * r;
+			if (!dl.allFinite())
+				return false;
+			mvDeltaPoints[3 * j] = dl(0);
+			mvDeltaPoints[3 * j + 1] = dl(1);
+			mvDeltaPoints[3 * j + 2] = dl(2);
+		}
+		return true;
+	}
+
+	// Levenberg-Marquardt like g2o::OptimizationAlgorithmLevenberg,
+	// including the gain threshold of the terminate action used in the graph version
+	int cBundleAdjusterMC::Optimize(const int& nIterations, bool* pbStopFlag)
+	{
+		const double tau = 1e-5;
+		const int maxTrials = 10;
+
+		BuildPointIndex();
+		if (mbMixedPrecision)
+			BuildRunIndex();
+		UpdateTransforms();
+		ComputeErrors();
+		double currentChi = RobustChi2();
+		double lambda = 0.0;
+		double ni = 2.0;
+		int it = 0;
+		for (; it < nIterations; ++it)
+		{
+			if (pbStopFlag && *pbStopFlag)
+				break;
+
+			Linearize();
+			BuildBlocks();
+			if (it == 0)
+			{
+				double maxDiagonal = 0.0;
+				for (int f = 0; f < mnFreePoses; ++f)
+					maxDiagonal = std::max(maxDiagonal, mvHpp[f].diagonal().cwiseAbs().maxCoeff());
+				for (size_t j = 0; j < mvHll.size(); ++j)
+					maxDiagonal = std::max(maxDiagonal, mvHll[j].diagonal().cwiseAbs().maxCoeff());
+				lambda = tau * maxDiagonal;
+			}
+
+			const std::vector<cv::Matx61d> vPosesBackup = mvPoses;
+			const std::vector<double> vPointsBackup = mvPoints;
+			const double lastChi = currentChi;
+			bool bAccepted = false;
+			for (int trial = 0; trial < maxTrials && !bAccepted; ++trial)
+			{
+				if (!SolveDamped(lambda))
+				{
+					if (it == 0)
+						return -1;
+					break;
+				}
+
+				// dx^T (lambda dx - g) over the pose and point blocks
+				double scale = 1e-3;
+				for (size_t p = 0; p < mvPoses.size(); ++p)
+				{
+					const int f = mvPoseFreeIdx[p];
+					if (f < 0)
+						continue;
+					const Eigen::Matrix<double, 6, 1> dp = mDeltaPoses.segment<6>(6 * f);
+					scale += dp.dot(lambda * dp - mvGp[f]);
+					for (int k = 0; k < 6; ++k)
+						mvPoses[p](k, 0) = vPosesBackup[p](k, 0) + dp(k);
+				}
+				for (size_t j = 0; j < mvHll.size(); ++j)
+				{
+					const Eigen::Map<const Eigen::Vector3d> dl(&mvDeltaPoints[3 * j]);
+					scale += dl.dot(lambda * dl - mvGl[j]);
+					for (int k = 0; k < 3; ++k)
+						mvPoints[3 * j + k] = vPointsBackup[3 * j + k] + dl(k);
+				}
+				UpdateTransforms();
+				ComputeErrors();
+				const double newChi = RobustChi2();
+
+				const double rho = (currentChi - newChi) / scale;
+				if (rho > 0 && std::isfinite(newChi))
+				{
+					const double alpha = 1.0 - std::pow(2.0 * rho - 1.0, 3);
+					lambda *= std::max(1.0 / 3.0, std::min(alpha, 2.0 / 3.0));
+					ni = 2.0;
+					currentChi = newChi;
+					bAccepted = true;
+				}
+				else
+				{
+					lambda *= ni;
+					ni *= 2.0;
+				}
+			}
+			if (!bAccepted)
+			{
+				mvPoses = vPosesBackup;
+				mvPoints = vPointsBackup;
+				++it;
+				break;
+			}
+			const double gain = (lastChi - currentChi) / currentChi;
+			if (gain >= 0.0 && gain < mdGainThreshold)
+			{
+				++it;
+				break;
+			}
+		}
+		UpdateTransforms();
+		ComputeErrors();
+		return it;
+	}
+}
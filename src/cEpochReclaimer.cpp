@@ -0,0 +1,153 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cEpochReclaimer.h"
+#include "cMapPoint.h"
+#include "cMultiKeyFrame.h"
+
+namespace MultiColSLAM
+{
+	cEpochReclaimer::cEpochReclaimer() :
+		mnGlobalEpoch(1),
+		mnFreedMapPoints(0),
+		mnFreedKeyFrames(0)
+	{}
+
+	cEpochReclaimer::~cEpochReclaimer()
+	{
+		Flush();
+	}
+
+	int cEpochReclaimer::RegisterThread()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		// a new thread holds no pointers, so everything retired so far is safe for it
+		mvSafeEpochs.push_back(mnGlobalEpoch);
+		mvSeenEpochs.push_back(mnGlobalEpoch);
+		mvbRegistered.push_back(true);
+		return static_cast<int>(mvbRegistered.size()) - 1;
+	}
+
+	void cEpochReclaimer::UnregisterThread(const int& threadId)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutexEpoch);
+			mvbRegistered[threadId] = false;
+		}
+		Reclaim();
+	}
+
+	void cEpochReclaimer::QuiescentState(const int& threadId)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutexEpoch);
+			// The thread cleaned its containers after its last quiescent state.
+			// Everything retired before that point was already bad while cleaning,
+			// so it can not be referenced anymore.
+			mvSafeEpochs[threadId] = mvSeenEpochs[threadId];
+			mvSeenEpochs[threadId] = mnGlobalEpoch;
+		}
+		Reclaim();
+	}
+
+	void cEpochReclaimer::Retire(cMapPoint* pMP)
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		mdRetiredMapPoints.push_back(std::make_pair(mnGlobalEpoch++, pMP));
+	}
+
+	void cEpochReclaimer::Retire(cMultiKeyFrame* pKF)
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		mdRetiredKeyFrames.push_back(std::make_pair(mnGlobalEpoch++, pKF));
+	}
+
+	void cEpochReclaimer::Reclaim()
+	{
+		std::vector<cMapPoint*> vpMPs;
+		std::vector<cMultiKeyFrame*> vpKFs;
+		{
+			std::unique_lock<std::mutex> lock(mMutexEpoch);
+			unsigned long minEpoch = mnGlobalEpoch;
+			for (size_t i = 0; i < mvbRegistered.size(); ++i)
+				if (mvbRegistered[i] && mvSafeEpochs[i] < minEpoch)
+					minEpoch = mvSafeEpochs[i];
+
+			// retirement epochs are increasing, so we can stop at the first young object
+			while (!mdRetiredMapPoints.empty() &&
+				mdRetiredMapPoints.front().first < minEpoch)
+			{
+				vpMPs.push_back(mdRetiredMapPoints.front().second);
+				mdRetiredMapPoints.pop_front();
+			}
+			while (!mdRetiredKeyFrames.empty() &&
+				mdRetiredKeyFrames.front().first < minEpoch)
+			{
+				vpKFs.push_back(mdRetiredKeyFrames.front().second);
+				mdRetiredKeyFrames.pop_front();
+			}
+			mnFreedMapPoints += vpMPs.size();
+			mnFreedKeyFrames += vpKFs.size();
+		}
+
+		// free outside of the lock, the destructors are not for free
+		for (size_t i = 0; i < vpMPs.size(); ++i)
+			delete vpMPs[i];
+		for (size_t i = 0; i < vpKFs.size(); ++i)
+			delete vpKFs[i];
+	}
+
+	void cEpochReclaimer::Flush()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		for (size_t i = 0; i < mdRetiredMapPoints.size(); ++i)
+			delete mdRetiredMapPoints[i].second;
+		for (size_t i = 0; i < mdRetiredKeyFrames.size(); ++i)
+			delete mdRetiredKeyFrames[i].second;
+		mnFreedMapPoints += mdRetiredMapPoints.size();
+		mnFreedKeyFrames += mdRetiredKeyFrames.size();
+		mdRetiredMapPoints.clear();
+		mdRetiredKeyFrames.clear();
+	}
+
+	size_t cEpochReclaimer::PendingMapPoints()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		return mdRetiredMapPoints.size();
+	}
+
+	size_t cEpochReclaimer::PendingKeyFrames()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		return mdRetiredKeyFrames.size();
+	}
+
+	unsigned long cEpochReclaimer::FreedMapPoints()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		return mnFreedMapPoints;
+	}
+
+	unsigned long cEpochReclaimer::FreedKeyFrames()
+	{
+		std::unique_lock<std::mutex> lock(mMutexEpoch);
+		return mnFreedKeyFrames;
+	}
+}
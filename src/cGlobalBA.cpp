@@ -0,0 +1,399 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cGlobalBA.h"
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+
+#include "g2o/core/block_solver.h"
+#include "g2o/core/optimization_algorithm_levenberg.h"
+#include "g2o/solvers/linear_solver_eigen.h"
+
+#include "cConverter.h"
+#include "misc.h"
+#include "cOptimizer.h"
+#include "cParallelBlockSolver.h"
+#include "g2o_MultiCol_vertices_edges.h"
+
+namespace MultiColSLAM
+{
+	namespace
+	{
+		// counts the iterations, announces the quiescent state of the job thread
+		// (it holds no map pointers while optimizing) and stops the optimizer if
+		// the job was cancelled or the gain is below the threshold, like
+		// g2o::SparseOptimizerTerminateAction, which would reset a cancel
+		class cGlobalBAProgressAction : public g2o::HyperGraphAction
+		{
+		public:
+			cGlobalBAProgressAction(cEpochReclaimer* pReclaimer, const int& reclaimerId,
+				std::atomic<int>* pnIterations, std::atomic<bool>* pbCancel) :
+				mpReclaimer(pReclaimer),
+				mnReclaimerId(reclaimerId),
+				mpnIterations(pnIterations),
+				mpbCancel(pbCancel),
+				mdLastChi(-1.0)
+			{}
+
+			virtual g2o::HyperGraphAction* operator()(const g2o::HyperGraph* graph,
+				Parameters* parameters = 0)
+			{
+				g2o::SparseOptimizer* optimizer =
+					const_cast<g2o::SparseOptimizer*>(static_cast<const g2o::SparseOptimizer*>(graph));
+				++(*mpnIterations);
+				mpReclaimer->QuiescentState(mnReclaimerId);
+
+				optimizer->computeActiveErrors();
+				const double currentChi = optimizer->activeRobustChi2();
+				bool bStop = *mpbCancel;
+				if (mdLastChi > 0.0)
+				{
+					const double gain = (mdLastChi - currentChi) / currentChi;
+					if (gain >= 0 && gain < 1e-6)
+						bStop = true;
+				}
+				mdLastChi = currentChi;
+				if (bStop)
+					*optimizer->forceStopFlag() = true;
+				return this;
+			}
+
+		protected:
+			cEpochReclaimer* mpReclaimer;
+			int mnReclaimerId;
+			std::atomic<int>* mpnIterations;
+			std::atomic<bool>* mpbCancel;
+			double mdLastChi;
+		};
+	}
+
+	cGlobalBA::cGlobalBA(cMap* pMap) :
+		mpMap(pMap),
+		meState(IDLE),
+		mpThread(NULL),
+		mbStopFlag(false),
+		mbCancel(false),
+		mnIterationsDone(0),
+		mnIterations(0),
+		mpOptimizer(NULL),
+		mnMerged(0)
+	{
+		mCurrentStats = sStats();
+		mLastStats = sStats();
+	}
+
+	cGlobalBA::~cGlobalBA()
+	{
+		Cancel(false);
+	}
+
+	void cGlobalBA::Start(const int& nIterations)
+	{
+		Cancel(false);
+
+		std::unique_lock<std::mutex> lockControl(mMutexControl);
+		{
+			// Progress reads the counters under the state mutex
+			std::unique_lock<std::mutex> lock(mMutexState);
+			mnIterationsDone = 0;
+			mnIterations = nIterations;
+			meState = RUNNING;
+		}
+		mbStopFlag = false;
+		mbCancel = false;
+		mCurrentStats = sStats();
+
+		mpOptimizer = new g2o::SparseOptimizer();
+		g2o::BlockSolver_6_3::LinearSolverType* linearSolver =
+			new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+		g2o::BlockSolver_6_3* solver_ptr =
+			new cParallelBlockSolver<g2o::BlockSolverTraits<6, 3> >(linearSolver, cOptimizer::nBAThreads);
+		mpOptimizer->setAlgorithm(new g2o::OptimizationAlgorithmLevenberg(solver_ptr));
+		mpOptimizer->setVerbose(false);
+		mpOptimizer->setForceStopFlag(&mbStopFlag);
+
+		mpThread = new std::thread(&cGlobalBA::Run, this, true);
+	}
+
+	void cGlobalBA::Cancel(const bool& bKeep)
+	{
+		std::unique_lock<std::mutex> lockControl(mMutexControl);
+		// the post iteration action stops the optimizer once it sees it
+		mbCancel = true;
+		Join();
+
+		std::unique_lock<std::mutex> lock(mMutexState);
+		if (bKeep && meState != IDLE)
+			return;
+		delete mpOptimizer;
+		mpOptimizer = NULL;
+		mmMPIdToVertex.clear();
+		mvKFIds.clear();
+		mmKFPoses.clear();
+		mmMPPositions.clear();
+		meState = IDLE;
+	}
+
+	bool cGlobalBA::Resume()
+	{
+		std::unique_lock<std::mutex> lockControl(mMutexControl);
+		{
+			std::unique_lock<std::mutex> lock(mMutexState);
+			if (meState != INTERRUPTED)
+				return false;
+			meState = RUNNING;
+		}
+		Join();
+		mbStopFlag = false;
+		mbCancel = false;
+		mpThread = new std::thread(&cGlobalBA::Run, this, false);
+		return true;
+	}
+
+	void cGlobalBA::Join()
+	{
+		if (!mpThread)
+			return;
+		mpThread->join();
+		delete mpThread;
+		mpThread = NULL;
+	}
+
+	void cGlobalBA::Run(const bool bSetup)
+	{
+		cEpochReclaimer* pReclaimer = mpMap->GetReclaimer();
+		const int reclaimerId = pReclaimer->RegisterThread();
+
+		if (bSetup)
+		{
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			const cSnapshot<cMultiKeyFrame> vpKFs = mpMap->GetKeyFrameSnapshot();
+			const cSnapshot<cMapPoint> vpMP = mpMap->GetMapPointSnapshot();
+			if (vpKFs.empty())
+			{
+				pReclaimer->UnregisterThread(reclaimerId);
+				std::unique_lock<std::mutex> lock(mMutexState);
+				meState = IDLE;
+				return;
+			}
+			cOptimizer::SetupBundleAdjustment(*mpOptimizer, vpKFs, vpMP, false, mmMPIdToVertex);
+			mvKFIds.clear();
+			for (size_t i = 0, iend = vpKFs.size(); i < iend; ++i)
+				if (mpOptimizer->vertex(vpKFs[i]->mnId))
+					mvKFIds.push_back(vpKFs[i]->mnId);
+			mpOptimizer->initializeOptimization();
+			mCurrentStats.nKeyFrames = static_cast<int>(mvKFIds.size());
+			mCurrentStats.nMapPoints = static_cast<int>(mmMPIdToVertex.size());
+			mCurrentStats.setupMs = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - begin).count() / 1000.0;
+		}
+		// from here on only the graph is used
+		pReclaimer->QuiescentState(reclaimerId);
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		cGlobalBAProgressAction progressAction(pReclaimer, reclaimerId, &mnIterationsDone, &mbCancel);
+		mpOptimizer->addPostIterationAction(&progressAction);
+		const int nRemaining = mnIterations - mnIterationsDone;
+		if (nRemaining > 0 && !mbCancel)
+			mpOptimizer->optimize(nRemaining);
+		mpOptimizer->removePostIterationAction(&progressAction);
+		mCurrentStats.optimizationMs += std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - begin).count() / 1000.0;
+		pReclaimer->UnregisterThread(reclaimerId);
+
+		if (mbCancel)
+		{
+			std::unique_lock<std::mutex> lock(mMutexState);
+			meState = INTERRUPTED;
+			return;
+		}
+
+		mmKFPoses.clear();
+		for (size_t i = 0; i < mvKFIds.size(); ++i)
+		{
+			VertexMt_cayley* vSE3 = static_cast<VertexMt_cayley*>(mpOptimizer->vertex(mvKFIds[i]));
+			mmKFPoses[mvKFIds[i]] = cayley2hom(vSE3->estimate());
+		}
+		mmMPPositions.clear();
+		for (std::unordered_map<long unsigned int, int>::const_iterator it = mmMPIdToVertex.begin(),
+			itend = mmMPIdToVertex.end(); it != itend; ++it)
+		{
+			VertexPointXYZ* vPoint = static_cast<VertexPointXYZ*>(mpOptimizer->vertex(it->second));
+			mmMPPositions[it->first] = vPoint->estimate();
+		}
+		mCurrentStats.nIterations = mnIterationsDone;
+
+		std::unique_lock<std::mutex> lock(mMutexState);
+		meState = DONE;
+	}
+
+	bool cGlobalBA::MergeIfDone()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutexState);
+			if (meState != DONE)
+				return false;
+		}
+		std::unique_lock<std::mutex> lockControl(mMutexControl);
+		{
+			// might have been cancelled in between
+			std::unique_lock<std::mutex> lock(mMutexState);
+			if (meState != DONE)
+				return false;
+		}
+		Join();
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		Merge();
+		mCurrentStats.mergeMs = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - begin).count() / 1000.0;
+
+		delete mpOptimizer;
+		mpOptimizer = NULL;
+		mmMPIdToVertex.clear();
+		mvKFIds.clear();
+		mmKFPoses.clear();
+		mmMPPositions.clear();
+
+		std::unique_lock<std::mutex> lock(mMutexState);
+		mLastStats = mCurrentStats;
+		++mnMerged;
+		meState = IDLE;
+		return true;
+	}
+
+	void cGlobalBA::Merge()
+	{
+		// correction of every keyframe in world coordinates, M_new = C * M_old
+		std::unordered_map<long unsigned int, cv::Matx44d> mCorrections;
+		std::list<cMultiKeyFrame*> lpToPropagate;
+		const cSnapshot<cMultiKeyFrame> vpKFs = mpMap->GetKeyFrameSnapshot();
+		for (size_t i = 0, iend = vpKFs.size(); i < iend; ++i)
+		{
+			cMultiKeyFrame* pKF = vpKFs[i];
+			if (pKF->isBad())
+				continue;
+			std::unordered_map<long unsigned int, cv::Matx44d>::const_iterator it = mmKFPoses.find(pKF->mnId);
+			if (it == mmKFPoses.end())
+				continue;
+			mCorrections[pKF->mnId] = it->second * cConverter::invMat(pKF->GetPose());
+			lpToPropagate.push_back(pKF);
+		}
+
+		// keyframes that were created during the optimization keep their pose
+		// relative to their parent in the spanning tree
+		int nPropagatedKFs = 0;
+		while (!lpToPropagate.empty())
+		{
+			cMultiKeyFrame* pKF = lpToPropagate.front();
+			lpToPropagate.pop_front();
+			const cv::Matx44d C = mCorrections[pKF->mnId];
+			const std::set<cMultiKeyFrame*> sChilds = pKF->GetChilds();
+			for (std::set<cMultiKeyFrame*>::const_iterator sit = sChilds.begin(), send = sChilds.end();
+				sit != send; ++sit)
+			{
+				cMultiKeyFrame* pChild = *sit;
+				if (pChild->isBad() || mCorrections.count(pChild->mnId))
+					continue;
+				mCorrections[pChild->mnId] = C;
+				lpToPropagate.push_back(pChild);
+				++nPropagatedKFs;
+			}
+		}
+
+		for (size_t i = 0, iend = vpKFs.size(); i < iend; ++i)
+		{
+			cMultiKeyFrame* pKF = vpKFs[i];
+			if (pKF->isBad())
+				continue;
+			std::unordered_map<long unsigned int, cv::Matx44d>::const_iterator it = mmKFPoses.find(pKF->mnId);
+			if (it != mmKFPoses.end())
+				pKF->SetPose(it->second);
+			else
+			{
+				std::unordered_map<long unsigned int, cv::Matx44d>::const_iterator cit = mCorrections.find(pKF->mnId);
+				if (cit != mCorrections.end())
+					pKF->SetPose(cit->second * pKF->GetPose());
+			}
+		}
+
+		// new points move with their reference keyframe
+		int nPropagatedMPs = 0;
+		const cSnapshot<cMapPoint> vpMP = mpMap->GetMapPointSnapshot();
+		for (size_t i = 0, iend = vpMP.size(); i < iend; ++i)
+		{
+			cMapPoint* pMP = vpMP[i];
+			if (pMP->isBad())
+				continue;
+			std::unordered_map<long unsigned int, cv::Vec3d>::const_iterator it = mmMPPositions.find(pMP->mnId);
+			if (it != mmMPPositions.end())
+				pMP->SetWorldPos(it->second);
+			else
+			{
+				cMultiKeyFrame* pRefKF = pMP->GetReferenceKeyFrame();
+				if (!pRefKF)
+					continue;
+				std::unordered_map<long unsigned int, cv::Matx44d>::const_iterator cit = mCorrections.find(pRefKF->mnId);
+				if (cit == mCorrections.end())
+					continue;
+				const cv::Matx44d& C = cit->second;
+				const cv::Vec3d X = pMP->GetWorldPos();
+				pMP->SetWorldPos(cv::Vec3d(
+					C(0, 0) * X(0) + C(0, 1) * X(1) + C(0, 2) * X(2) + C(0, 3),
+					C(1, 0) * X(0) + C(1, 1) * X(1) + C(1, 2) * X(2) + C(1, 3),
+					C(2, 0) * X(0) + C(2, 1) * X(1) + C(2, 2) * X(2) + C(2, 3)));
+				++nPropagatedMPs;
+			}
+			pMP->UpdateNormalAndDepth();
+		}
+		mCurrentStats.nPropagatedKeyFrames = nPropagatedKFs;
+		mCurrentStats.nPropagatedMapPoints = nPropagatedMPs;
+
+		mpMap->SetFlagAfterBA();
+	}
+
+	cGlobalBA::eState cGlobalBA::GetState()
+	{
+		std::unique_lock<std::mutex> lock(mMutexState);
+		return meState;
+	}
+
+	double cGlobalBA::Progress()
+	{
+		std::unique_lock<std::mutex> lock(mMutexState);
+		if (meState == IDLE || mnIterations <= 0)
+			return 0.0;
+		return std::min(1.0, static_cast<double>(mnIterationsDone) / mnIterations);
+	}
+
+	cGlobalBA::sStats cGlobalBA::GetLastStats()
+	{
+		std::unique_lock<std::mutex> lock(mMutexState);
+		return mLastStats;
+	}
+
+	int cGlobalBA::NrMerged()
+	{
+		std::unique_lock<std::mutex> lock(mMutexState);
+		return mnMerged;
+	}
+}
@@ -0,0 +1,729 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cIncrementalBA.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "misc.h"
+
+namespace MultiColSLAM
+{
+	namespace
+	{
+		inline double HuberWeight(const double& chi2, const double& delta)
+		{
+			if (chi2 <= delta * delta)
+				return 1.0;
+			return delta / std::sqrt(chi2);
+		}
+
+		// same as g2o::RobustKernelHuber
+		inline double HuberCost(const double& chi2, const double& delta)
+		{
+			if (chi2 <= delta * delta)
+				return chi2;
+			return 2.0 * delta * std::sqrt(chi2) - delta * delta;
+		}
+
+		const double kLambdaInit = 1e-4;
+		const double kLambdaMax = 1e4;
+	}
+
+	cIncrementalBA::cIncrementalBA() :
+		mnCams(0),
+		mnFreePoses(0),
+		mnUpdate(0),
+		mdHuberDelta(1.345 * 2.0),
+		mdRelinearizeThreshold(1e-3),
+		mnMaxIterations(3),
+		mnThreads(1),
+		mdLambda(0.0),
+		mnRelinearized(0),
+		mnEliminated(0),
+		mnActiveFactors(0),
+		mnActivePoints(0),
+		mnRejected(0)
+	{
+	}
+
+	void cIncrementalBA::Clear()
+	{
+		mvPoses.clear();
+		mvPoints.clear();
+		mvFactors.clear();
+		mvFreePoses.clear();
+		mvFreePoints.clear();
+		mvFreeFactors.clear();
+		mmKFIdToPose.clear();
+		mmMPIdToPoint.clear();
+		mnCams = 0;
+		mdLambda = 0.0;
+	}
+
+	void cIncrementalBA::SetCameraSystem(cMultiCamSys_& camSystem)
+	{
+		mnCams = camSystem.GetNrCams();
+		mvCamModels.resize(mnCams);
+		mvCamModelData.resize(mnCams);
+		mvMcTransforms.resize(mnCams);
+		for (int c = 0; c < mnCams; ++c)
+		{
+			mvCamModels[c] = camSystem.GetCamModelObj(c);
+			mvCamModelData[c] = mvCamModels[c].toVector();
+			mvMcTransforms[c].Set(camSystem.Get_M_c_min(c));
+		}
+	}
+
+	cv::Matx61d cIncrementalBA::PoseEstimate(const sPose& pose) const
+	{
+		cv::Matx61d Mt = pose.linPoint;
+		for (int k = 0; k < 6; ++k)
+			Mt(k, 0) += pose.delta(k);
+		return Mt;
+	}
+
+	int cIncrementalBA::SyncPose(cMultiKeyFrame* pKF, const bool& bFree)
+	{
+		const cv::Matx61d Mt = pKF->camSystem.Get_M_t_min();
+		int idx;
+		std::unordered_map<long unsigned int, int>::iterator it = mmKFIdToPose.find(pKF->mnId);
+		if (it == mmKFIdToPose.end())
+		{
+			if (mvFreePoses.empty())
+			{
+				idx = static_cast<int>(mvPoses.size());
+				mvPoses.push_back(sPose());
+			}
+			else
+			{
+				idx = mvFreePoses.back();
+				mvFreePoses.pop_back();
+			}
+			mmKFIdToPose[pKF->mnId] = idx;
+			sPose& pose = mvPoses[idx];
+			pose.nKFId = pKF->mnId;
+			pose.linPoint = Mt;
+			pose.linTransform.Set(Mt);
+			pose.delta.setZero();
+			pose.bUsed = true;
+			pose.bFree = bFree;
+			pose.bRelinearize = false;
+			pose.bChanged = true;
+		}
+		else
+		{
+			idx = it->second;
+			sPose& pose = mvPoses[idx];
+			// changed outside (loop closing, global BA), start again from the map
+			if (cv::norm(Mt - PoseEstimate(pose)) > 1e-12)
+			{
+				pose.linPoint = Mt;
+				pose.linTransform.Set(Mt);
+				pose.delta.setZero();
+				pose.bRelinearize = true;
+				pose.bChanged = true;
+			}
+			// a fixed pose has no delta, take it into the linearization point
+			if (pose.bFree && !bFree && !pose.delta.isZero(0.0))
+			{
+				pose.linPoint = PoseEstimate(pose);
+				pose.linTransform.Set(pose.linPoint);
+				pose.delta.setZero();
+				pose.bRelinearize = true;
+				pose.bChanged = true;
+			}
+			pose.bFree = bFree;
+		}
+		mvPoses[idx].pKF = pKF;
+		mvPoses[idx].nUpdate = mnUpdate;
+		return idx;
+	}
+
+	int cIncrementalBA::SyncPoint(cMapPoint* pMP)
+	{
+		const cv::Vec3d X = pMP->GetWorldPos();
+		const Eigen::Vector3d pos(X(0), X(1), X(2));
+		int idx;
+		std::unordered_map<long unsigned int, int>::iterator it = mmMPIdToPoint.find(pMP->mnId);
+		if (it == mmMPIdToPoint.end())
+		{
+			if (mvFreePoints.empty())
+			{
+				idx = static_cast<int>(mvPoints.size());
+				mvPoints.push_back(sPoint());
+			}
+			else
+			{
+				idx = mvFreePoints.back();
+				mvFreePoints.pop_back();
+			}
+			mmMPIdToPoint[pMP->mnId] = idx;
+			sPoint& pt = mvPoints[idx];
+			pt.nMPId = pMP->mnId;
+			pt.linPoint = pos;
+			pt.delta.setZero();
+			pt.vFactors.clear();
+			pt.bUsed = true;
+			pt.bRelinearize = false;
+			pt.bAffected = true;
+		}
+		else
+		{
+			idx = it->second;
+			sPoint& pt = mvPoints[idx];
+			if ((pos - (pt.linPoint + pt.delta)).norm() > 1e-12)
+			{
+				pt.linPoint = pos;
+				pt.delta.setZero();
+				pt.bRelinearize = true;
+			}
+		}
+		mvPoints[idx].pMP = pMP;
+		mvPoints[idx].nUpdate = mnUpdate;
+		mvPoints[idx].bMoved = false;
+		return idx;
+	}
+
+	void cIncrementalBA::SyncFactor(const int& point, const int& pose, cMultiKeyFrame* pKF,
+		const size_t& obsIdx)
+	{
+		sPoint& pt = mvPoints[point];
+		for (size_t k = 0; k < pt.vFactors.size(); ++k)
+		{
+			sFactor& f = mvFactors[pt.vFactors[k]];
+			if (f.nKFId == pKF->mnId && f.nObsIdx == obsIdx && f.nPose == pose)
+			{
+				f.nUpdate = mnUpdate;
+				return;
+			}
+		}
+
+		int idx;
+		if (mvFreeFactors.empty())
+		{
+			idx = static_cast<int>(mvFactors.size());
+			mvFactors.push_back(sFactor());
+		}
+		else
+		{
+			idx = mvFreeFactors.back();
+			mvFreeFactors.pop_back();
+		}
+		sFactor& f = mvFactors[idx];
+		const cv::KeyPoint kpUn = pKF->GetKeyPoint(obsIdx);
+		f.nPose = pose;
+		f.nPoint = point;
+		f.nCam = pKF->keypoint_to_cam.find(obsIdx)->second;
+		f.nKFId = pKF->mnId;
+		f.nObsIdx = obsIdx;
+		f.u = kpUn.pt.x;
+		f.v = kpUn.pt.y;
+		f.invSigma2 = pKF->GetInvSigma2(kpUn.octave);
+		f.nUpdate = mnUpdate;
+		f.bUsed = true;
+		f.bLinearized = false;
+		pt.vFactors.push_back(idx);
+		pt.bAffected = true;
+	}
+
+	void cIncrementalBA::RemoveFactor(const int& factor)
+	{
+		mvFactors[factor].bUsed = false;
+		mvFreeFactors.push_back(factor);
+	}
+
+	// everything that was not synchronized in this update left the window
+	void cIncrementalBA::RemoveStale()
+	{
+		for (size_t j = 0; j < mvPoints.size(); ++j)
+		{
+			sPoint& pt = mvPoints[j];
+			if (!pt.bUsed)
+				continue;
+			const bool bPointUsed = pt.nUpdate == mnUpdate;
+			size_t nKept = 0;
+			for (size_t k = 0; k < pt.vFactors.size(); ++k)
+			{
+				if (bPointUsed && mvFactors[pt.vFactors[k]].nUpdate == mnUpdate)
+					pt.vFactors[nKept++] = pt.vFactors[k];
+				else
+				{
+					RemoveFactor(pt.vFactors[k]);
+					pt.bAffected = true;
+				}
+			}
+			pt.vFactors.resize(nKept);
+			if (!bPointUsed)
+			{
+				pt.bUsed = false;
+				mmMPIdToPoint.erase(pt.nMPId);
+				mvFreePoints.push_back(static_cast<int>(j));
+			}
+		}
+		// the observations of the poses are gone with their points
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+		{
+			sPose& pose = mvPoses[p];
+			if (!pose.bUsed || pose.nUpdate == mnUpdate)
+				continue;
+			pose.bUsed = false;
+			mmKFIdToPose.erase(pose.nKFId);
+			mvFreePoses.push_back(static_cast<int>(p));
+		}
+	}
+
+	// error, Huber weight and Jacobians at the linearization points,
+	// the error is measurement - projection, see EdgeProjectXYZ2MCS::linearizeOplus
+	void cIncrementalBA::LinearizeFactor(sFactor& f) const
+	{
+		const sPose& pose = mvPoses[f.nPose];
+		const sPoint& pt = mvPoints[f.nPoint];
+		const sCayleyTransform& Mc = mvMcTransforms[f.nCam];
+
+		const Eigen::Vector3d Xc = mcsToCamera(pt.linPoint, pose.linTransform, Mc);
+		double u = 0.0, v = 0.0;
+		mvCamModels[f.nCam].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+		f.e(0) = f.u - u;
+		f.e(1) = f.v - v;
+		f.w = f.invSigma2 * HuberWeight(f.invSigma2 * f.e.squaredNorm(), mdHuberDelta);
+
+		mcsJacsChain(pt.linPoint, pose.linTransform, Mc, mvCamModelData[f.nCam],
+			&f.Jl, &f.Jp, NULL, NULL);
+		f.Jl = -f.Jl;
+		f.Jp = -f.Jp;
+		f.bLinearized = true;
+	}
+
+	// Schur complement of the point, H dx = -g:
+	// S -= Hpl Hll^-1 Hpl^T, rhs += Hpl Hll^-1 gl
+	// the contributions are kept for all observing poses, so a pose
+	// can become fixed or free without eliminating its points again
+	void cIncrementalBA::EliminatePoint(sPoint& pt) const
+	{
+		Eigen::Matrix3d Hll = Eigen::Matrix3d::Zero();
+		pt.gl.setZero();
+		for (size_t k = 0; k < pt.vFactors.size(); ++k)
+		{
+			const sFactor& f = mvFactors[pt.vFactors[k]];
+			Hll.noalias() += f.w * f.Jl.transpose() * f.Jl;
+			pt.gl.noalias() += f.w * f.Jl.transpose() * f.e;
+		}
+		Hll.diagonal() *= 1.0 + mdLambda;
+		// a little damping for badly conditioned points (small baseline)
+		Hll.diagonal().array() += 1e-9 * Hll.trace() + 1e-12;
+		pt.HllInv = Hll.inverse();
+
+		pt.vBlockRows.clear();
+		pt.vBlockCols.clear();
+		pt.vBlocks.clear();
+		pt.vRhsRows.clear();
+		pt.vRhs.clear();
+		const size_t nObs = pt.vFactors.size();
+		std::vector<Mat63, Eigen::aligned_allocator<Mat63> > vW(nObs);
+		std::vector<Mat63, Eigen::aligned_allocator<Mat63> > vY(nObs);
+		for (size_t a = 0; a < nObs; ++a)
+		{
+			const sFactor& f = mvFactors[pt.vFactors[a]];
+			vW[a] = f.w * f.Jp.transpose() * f.Jl;
+			vY[a] = vW[a] * pt.HllInv;
+			pt.vRhsRows.push_back(f.nPose);
+			pt.vRhs.push_back(vY[a] * pt.gl);
+		}
+		for (size_t a = 0; a < nObs; ++a)
+		{
+			for (size_t b = 0; b < nObs; ++b)
+			{
+				pt.vBlockRows.push_back(mvFactors[pt.vFactors[a]].nPose);
+				pt.vBlockCols.push_back(mvFactors[pt.vFactors[b]].nPose);
+				pt.vBlocks.push_back(vY[a] * vW[b].transpose());
+			}
+		}
+	}
+
+	bool cIncrementalBA::SolveReduced()
+	{
+		mnFreePoses = 0;
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+		{
+			sPose& pose = mvPoses[p];
+			pose.nFreeIdx = (pose.bUsed && pose.bFree) ? mnFreePoses++ : -1;
+		}
+		const int dim = 6 * mnFreePoses;
+		if (dim == 0)
+			return true;
+		mS.setZero(dim, dim);
+		mRhs.setZero(dim);
+
+		// pose blocks from the kept linearizations
+		for (size_t i = 0; i < mvFactors.size(); ++i)
+		{
+			const sFactor& f = mvFactors[i];
+			if (!f.bUsed)
+				continue;
+			const int fi = mvPoses[f.nPose].nFreeIdx;
+			if (fi < 0)
+				continue;
+			mS.block<6, 6>(6 * fi, 6 * fi).noalias() += f.w * f.Jp.transpose() * f.Jp;
+			mRhs.segment<6>(6 * fi).noalias() -= f.w * f.Jp.transpose() * f.e;
+		}
+		// only the pose blocks are in S so far, the points are damped in EliminatePoint
+		mS.diagonal() *= 1.0 + mdLambda;
+		// and the kept contributions of the points
+		for (size_t j = 0; j < mvPoints.size(); ++j)
+		{
+			const sPoint& pt = mvPoints[j];
+			if (!pt.bUsed)
+				continue;
+			for (size_t k = 0; k < pt.vRhs.size(); ++k)
+			{
+				const int fi = mvPoses[pt.vRhsRows[k]].nFreeIdx;
+				if (fi >= 0)
+					mRhs.segment<6>(6 * fi) += pt.vRhs[k];
+			}
+			for (size_t k = 0; k < pt.vBlocks.size(); ++k)
+			{
+				const int fr = mvPoses[pt.vBlockRows[k]].nFreeIdx;
+				const int fc = mvPoses[pt.vBlockCols[k]].nFreeIdx;
+				if (fr >= 0 && fc >= 0)
+					mS.block<6, 6>(6 * fr, 6 * fc) -= pt.vBlocks[k];
+			}
+		}
+		mS.diagonal().array() += 1e-9 * mS.diagonal().cwiseAbs().maxCoeff();
+
+		const Eigen::VectorXd dp = mS.ldlt().solve(mRhs);
+		if (!dp.allFinite())
+			return false;
+
+		// wildfire: only poses that moved noticeably trigger a back substitution
+		const double thChanged = 0.1 * mdRelinearizeThreshold;
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+		{
+			sPose& pose = mvPoses[p];
+			if (pose.nFreeIdx < 0)
+				continue;
+			const Vec6 delta = dp.segment<6>(6 * pose.nFreeIdx);
+			if ((delta - pose.delta).lpNorm<Eigen::Infinity>() > thChanged)
+				pose.bChanged = true;
+			pose.delta = delta;
+		}
+		return true;
+	}
+
+	// dl = Hll^-1 (-gl - Hpl^T dp), fixed poses have no delta
+	void cIncrementalBA::BackSubstitute(sPoint& pt) const
+	{
+		Eigen::Vector3d r = -pt.gl;
+		for (size_t k = 0; k < pt.vFactors.size(); ++k)
+		{
+			const sFactor& f = mvFactors[pt.vFactors[k]];
+			const sPose& pose = mvPoses[f.nPose];
+			if (pose.nFreeIdx < 0)
+				continue;
+			r.noalias() -= f.w * f.Jl.transpose() * (f.Jp * pose.delta);
+		}
+		pt.delta = pt.HllInv * r;
+		pt.bMoved = true;
+	}
+
+	double cIncrementalBA::RobustCost() const
+	{
+		std::vector<sCayleyTransform> vPoseTransforms(mvPoses.size());
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+			if (mvPoses[p].bUsed)
+				vPoseTransforms[p].Set(PoseEstimate(mvPoses[p]));
+
+		const int nFactors = static_cast<int>(mvFactors.size());
+		double cost = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:cost) num_threads(mnThreads) if (mnThreads > 1)
+		for (int i = 0; i < nFactors; ++i)
+		{
+			const sFactor& f = mvFactors[i];
+			if (!f.bUsed)
+				continue;
+			const sPoint& pt = mvPoints[f.nPoint];
+			const Eigen::Vector3d Xc = mcsToCamera(pt.linPoint + pt.delta,
+				vPoseTransforms[f.nPose], mvMcTransforms[f.nCam]);
+			double u = 0.0, v = 0.0;
+			mvCamModels[f.nCam].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+			const double eu = f.u - u;
+			const double ev = f.v - v;
+			cost += HuberCost(f.invSigma2 * (eu * eu + ev * ev), mdHuberDelta);
+		}
+		return cost;
+	}
+
+	int cIncrementalBA::MarkRelinearization()
+	{
+		int nMarked = 0;
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+		{
+			sPose& pose = mvPoses[p];
+			if (!pose.bUsed || pose.delta.lpNorm<Eigen::Infinity>() <= mdRelinearizeThreshold)
+				continue;
+			pose.linPoint = PoseEstimate(pose);
+			pose.linTransform.Set(pose.linPoint);
+			pose.delta.setZero();
+			pose.bRelinearize = true;
+			++nMarked;
+		}
+		for (size_t j = 0; j < mvPoints.size(); ++j)
+		{
+			sPoint& pt = mvPoints[j];
+			if (!pt.bUsed || pt.delta.lpNorm<Eigen::Infinity>() <= mdRelinearizeThreshold)
+				continue;
+			pt.linPoint += pt.delta;
+			pt.delta.setZero();
+			pt.bRelinearize = true;
+			++nMarked;
+		}
+		return nMarked;
+	}
+
+	// same test as after the rounds of the local BA, at the current estimate.
+	// The observations are erased in the map, the next update drops them here
+	int cIncrementalBA::RemoveOutliers()
+	{
+		const double thHuber2 = mdHuberDelta * mdHuberDelta;
+		std::vector<sCayleyTransform> vPoseTransforms(mvPoses.size());
+		for (size_t p = 0; p < mvPoses.size(); ++p)
+			if (mvPoses[p].bUsed)
+				vPoseTransforms[p].Set(PoseEstimate(mvPoses[p]));
+
+		int nOutliers = 0;
+		for (size_t j = 0; j < mvPoints.size(); ++j)
+		{
+			sPoint& pt = mvPoints[j];
+			if (!pt.bUsed || !pt.bMoved || pt.pMP->isBad())
+				continue;
+			const Eigen::Vector3d X = pt.linPoint + pt.delta;
+			for (size_t k = 0; k < pt.vFactors.size(); ++k)
+			{
+				const sFactor& f = mvFactors[pt.vFactors[k]];
+				const Eigen::Vector3d Xc = mcsToCamera(X, vPoseTransforms[f.nPose], mvMcTransforms[f.nCam]);
+				double u = 0.0, v = 0.0;
+				mvCamModels[f.nCam].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+				const double eu = f.u - u;
+				const double ev = f.v - v;
+				if (f.invSigma2 * (eu * eu + ev * ev) > thHuber2)
+				{
+					cMultiKeyFrame* pKFi = mvPoses[f.nPose].pKF;
+					pKFi->EraseMapPointMatch(f.nObsIdx);
+					pt.pMP->EraseObservation(pKFi, f.nObsIdx);
+					++nOutliers;
+				}
+			}
+		}
+		return nOutliers;
+	}
+
+	void cIncrementalBA::WriteBack(const std::list<cMultiKeyFrame*>& lLocalKeyFrames)
+	{
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+			lit != lend; ++lit)
+		{
+			cMultiKeyFrame* pKFl = *lit;
+			if (pKFl->isBad())
+				continue;
+			const sPose& pose = mvPoses[mmKFIdToPose[pKFl->mnId]];
+			if (pose.bFree)
+				pKFl->camSystem.Set_M_t_from_min(PoseEstimate(pose));
+		}
+		for (size_t j = 0; j < mvPoints.size(); ++j)
+		{
+			sPoint& pt = mvPoints[j];
+			if (!pt.bUsed || !pt.bMoved)
+				continue;
+			cMapPoint* pMP = pt.pMP;
+			if (pMP->isBad() || pMP->TotalNrObservations() <= 1 || pt.vFactors.size() < 2)
+				continue;
+			const Eigen::Vector3d X = pt.linPoint + pt.delta;
+			pMP->SetWorldPos(cv::Vec3d(X(0), X(1), X(2)));
+			pMP->UpdateNormalAndDepth();
+			pMP->ComputeDistinctiveDescriptors();
+		}
+	}
+
+	int cIncrementalBA::Update(cMultiKeyFrame* pKF,
+		const std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+		const std::list<cMultiKeyFrame*>& lFixedCameras,
+		const std::list<cMapPoint*>& lLocalMapPoints,
+		bool* pbStopFlag)
+	{
+		++mnUpdate;
+		mnRelinearized = 0;
+		mnEliminated = 0;
+		mnRejected = 0;
+		if (mnCams != pKF->camSystem.GetNrCams())
+			Clear();
+		// the damping of the last update is in the kept eliminations
+		const bool bWasDamped = mdLambda > 0.0;
+		mdLambda = 0.0;
+		SetCameraSystem(pKF->camSystem);
+
+		// same gauge as the local BA: keyframe 0 is fixed, and if there are no
+		// fixed keyframes the first local one (unless the last one is keyframe 0)
+		const bool bFixFirst = lFixedCameras.empty() && lLocalKeyFrames.back()->mnId != 0;
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+			lit != lend; ++lit)
+		{
+			const bool bFixed = (*lit)->mnId == 0 || (bFixFirst && lit == lLocalKeyFrames.begin());
+			SyncPose(*lit, !bFixed);
+		}
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lFixedCameras.begin(), lend = lFixedCameras.end();
+			lit != lend; ++lit)
+			SyncPose(*lit, false);
+
+		for (std::list<cMapPoint*>::const_iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end();
+			lit != lend; ++lit)
+		{
+			cMapPoint* pMP = *lit;
+			if (pMP->isBad())
+				continue;
+			const int point = SyncPoint(pMP);
+			std::map<cMultiKeyFrame*, std::vector<size_t> > observations = pMP->GetObservations();
+			for (std::map<cMultiKeyFrame*, std::vector<size_t> >::iterator mit =
+				observations.begin(), mend = observations.end(); mit != mend; ++mit)
+			{
+				cMultiKeyFrame* pKFi = mit->first;
+				if (pKFi->isBad())
+					continue;
+				std::unordered_map<long unsigned int, int>::const_iterator pit = mmKFIdToPose.find(pKFi->mnId);
+				if (pit == mmKFIdToPose.end() || mvPoses[pit->second].nUpdate != mnUpdate)
+					continue;
+				for (size_t k = 0; k < mit->second.size(); ++k)
+					SyncFactor(point, pit->second, pKFi, mit->second[k]);
+			}
+		}
+		RemoveStale();
+		if (bWasDamped)
+			for (size_t j = 0; j < mvPoints.size(); ++j)
+				mvPoints[j].bAffected = true;
+
+		std::vector<int> vToLinearize;
+		std::vector<int> vToEliminate;
+		std::vector<Vec6, Eigen::aligned_allocator<Vec6> > vPoseDeltas;
+		std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > vPointDeltas;
+		double cost = RobustCost();
+		for (int it = 0; it < mnMaxIterations; ++it)
+		{
+			if (pbStopFlag && *pbStopFlag)
+				break;
+
+			// new observations and the ones of relinearized variables
+			vToLinearize.clear();
+			for (size_t i = 0; i < mvFactors.size(); ++i)
+			{
+				sFactor& f = mvFactors[i];
+				if (!f.bUsed)
+					continue;
+				if (!f.bLinearized || mvPoses[f.nPose].bRelinearize || mvPoints[f.nPoint].bRelinearize)
+				{
+					vToLinearize.push_back(static_cast<int>(i));
+					mvPoints[f.nPoint].bAffected = true;
+				}
+			}
+			const int nLinearize = static_cast<int>(vToLinearize.size());
+#pragma omp parallel for schedule(static) num_threads(mnThreads) if (mnThreads > 1)
+			for (int k = 0; k < nLinearize; ++k)
+				LinearizeFactor(mvFactors[vToLinearize[k]]);
+			mnRelinearized += nLinearize;
+			for (size_t p = 0; p < mvPoses.size(); ++p)
+				mvPoses[p].bRelinearize = false;
+
+			vToEliminate.clear();
+			for (size_t j = 0; j < mvPoints.size(); ++j)
+			{
+				sPoint& pt = mvPoints[j];
+				pt.bRelinearize = false;
+				if (pt.bUsed && pt.bAffected)
+					vToEliminate.push_back(static_cast<int>(j));
+			}
+			const int nEliminate = static_cast<int>(vToEliminate.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(mnThreads) if (mnThreads > 1)
+			for (int k = 0; k < nEliminate; ++k)
+				EliminatePoint(mvPoints[vToEliminate[k]]);
+			mnEliminated += nEliminate;
+
+			vPoseDeltas.resize(mvPoses.size());
+			for (size_t p = 0; p < mvPoses.size(); ++p)
+				vPoseDeltas[p] = mvPoses[p].delta;
+			vPointDeltas.resize(mvPoints.size());
+			for (size_t j = 0; j < mvPoints.size(); ++j)
+				vPointDeltas[j] = mvPoints[j].delta;
+
+			const bool bSolved = SolveReduced();
+			for (size_t j = 0; j < mvPoints.size() && bSolved; ++j)
+			{
+				sPoint& pt = mvPoints[j];
+				if (!pt.bUsed)
+					continue;
+				bool bBackSubstitute = pt.bAffected;
+				for (size_t k = 0; k < pt.vFactors.size() && !bBackSubstitute; ++k)
+					bBackSubstitute = mvPoses[mvFactors[pt.vFactors[k]].nPose].bChanged;
+				if (bBackSubstitute)
+					BackSubstitute(pt);
+				pt.bAffected = false;
+			}
+			for (size_t p = 0; p < mvPoses.size(); ++p)
+				mvPoses[p].bChanged = false;
+
+			// the step is only written if it lowers the cost, otherwise undo it and
+			// damp. The delta is damped towards the linearization point, which is
+			// the estimate up to the relinearization threshold
+			const double newCost = bSolved ? RobustCost() : cost;
+			if (!bSolved || newCost > cost)
+			{
+				++mnRejected;
+				for (size_t p = 0; p < mvPoses.size(); ++p)
+					mvPoses[p].delta = vPoseDeltas[p];
+				for (size_t j = 0; j < mvPoints.size(); ++j)
+					mvPoints[j].delta = vPointDeltas[j];
+				if (mdLambda >= kLambdaMax)
+					break;
+				mdLambda = mdLambda > 0.0 ? 10.0 * mdLambda : kLambdaInit;
+				// the damping changes every elimination
+				for (size_t j = 0; j < mvPoints.size(); ++j)
+					mvPoints[j].bAffected = true;
+				continue;
+			}
+			cost = newCost;
+			if (mdLambda > 0.0)
+			{
+				mdLambda = mdLambda > kLambdaInit ? 0.1 * mdLambda : 0.0;
+				for (size_t j = 0; j < mvPoints.size(); ++j)
+					mvPoints[j].bAffected = true;
+			}
+
+			if (MarkRelinearization() == 0)
+				break;
+		}
+
+		mnActiveFactors = static_cast<int>(mvFactors.size() - mvFreeFactors.size());
+		mnActivePoints = static_cast<int>(mvPoints.size() - mvFreePoints.size());
+		if (pbStopFlag && *pbStopFlag)
+			return 0;
+
+		const int nOutliers = RemoveOutliers();
+		WriteBack(lLocalKeyFrames);
+		return nOutliers;
+	}
+}
@@ -0,0 +1,354 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cLocalBAGraph.h"
+
+#include "g2o/core/block_solver.h"
+#include "g2o/core/optimization_algorithm_levenberg.h"
+#include "g2o/core/robust_kernel_impl.h"
+#include "g2o/solvers/linear_solver_eigen.h"
+
+#include "cOptimizer.h"
+#include "cParallelBlockSolver.h"
+
+namespace MultiColSLAM
+{
+	namespace
+	{
+		// g2o::SparseOptimizerTerminateAction sets the stop flag of the optimizer
+		// on convergence and never resets it, with the stop flag of local mapping
+		// as force stop flag a converged round looked like an abort.
+		// This one only stops the optimizer and keeps the gain of its own run.
+		class cLocalBATerminateAction : public g2o::HyperGraphAction
+		{
+		public:
+			cLocalBATerminateAction(const bool* pbStopFlag, const double& gainThreshold) :
+				mpbStopFlag(pbStopFlag),
+				mdGainThreshold(gainThreshold),
+				mdLastChi(-1.0)
+			{}
+
+			virtual g2o::HyperGraphAction* operator()(const g2o::HyperGraph* graph,
+				Parameters* parameters = 0)
+			{
+				g2o::SparseOptimizer* optimizer =
+					const_cast<g2o::SparseOptimizer*>(static_cast<const g2o::SparseOptimizer*>(graph));
+				bool bStop = mpbStopFlag && *mpbStopFlag;
+				optimizer->computeActiveErrors();
+				const double currentChi = optimizer->activeRobustChi2();
+				if (mdLastChi > 0.0)
+				{
+					const double gain = (mdLastChi - currentChi) / currentChi;
+					if (gain >= 0 && gain < mdGainThreshold)
+						bStop = true;
+				}
+				mdLastChi = currentChi;
+				if (bStop)
+					*optimizer->forceStopFlag() = true;
+				return this;
+			}
+
+		private:
+			const bool* mpbStopFlag;
+			double mdGainThreshold;
+			double mdLastChi;
+		};
+	}
+
+	cLocalBAGraph::cLocalBAGraph() :
+		mbAlgorithmSet(false),
+		mpbStopFlag(NULL),
+		mbStop(false),
+		mnUpdate(0),
+		mnNextVertexId(0),
+		mnAllocations(0)
+	{
+		mOptimizer.setVerbose(false);
+	}
+
+	cLocalBAGraph::~cLocalBAGraph()
+	{
+		Clear();
+	}
+
+	void cLocalBAGraph::Clear()
+	{
+		// deletes everything in the graph, Mc and IO included
+		mOptimizer.clear();
+		mvpMc.clear();
+		mvpIO.clear();
+		mmPoses.clear();
+		mmPoints.clear();
+		for (size_t i = 0; i < mvpFreePoses.size(); ++i)
+			delete mvpFreePoses[i];
+		for (size_t i = 0; i < mvpFreePoints.size(); ++i)
+			delete mvpFreePoints[i];
+		for (size_t i = 0; i < mvpFreeEdges.size(); ++i)
+			delete mvpFreeEdges[i];
+		mvpFreePoses.clear();
+		mvpFreePoints.clear();
+		mvpFreeEdges.clear();
+		mnNextVertexId = 0;
+	}
+
+	void cLocalBAGraph::BeginUpdate(cMultiCamSys_& camSystem, bool* pbStopFlag)
+	{
+		++mnUpdate;
+		mnAllocations = 0;
+		if (!mbAlgorithmSet)
+		{
+			// the edges are linearized on nBAThreads threads
+			g2o::BlockSolver_6_3::LinearSolverType* linearSolver =
+				new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
+			g2o::BlockSolver_6_3* solver_ptr =
+				new cParallelBlockSolver<g2o::BlockSolverTraits<6, 3> >(linearSolver, cOptimizer::nBAThreads);
+			mOptimizer.setAlgorithm(new g2o::OptimizationAlgorithmLevenberg(solver_ptr));
+			mOptimizer.setForceStopFlag(&mbStop);
+			mbAlgorithmSet = true;
+		}
+		mpbStopFlag = pbStopFlag;
+
+		const int nrCams = camSystem.GetNrCams();
+		// a different rig, start from scratch
+		if (!mvpMc.empty() && static_cast<int>(mvpMc.size()) != nrCams)
+			Clear();
+		if (mvpMc.empty())
+		{
+			mvpMc.assign(nrCams, NULL);
+			mvpIO.assign(nrCams, NULL);
+			for (int c = 0; c < nrCams; ++c)
+			{
+				mvpMc[c] = new VertexMc_cayley();
+				mvpMc[c]->setId(mnNextVertexId++);
+				mvpMc[c]->setFixed(true);
+				mOptimizer.addVertex(mvpMc[c]);
+				mvpIO[c] = new VertexOmniCameraParameters(camSystem.GetCamModelObj(c));
+				mvpIO[c]->setId(mnNextVertexId++);
+				mvpIO[c]->setFixed(true);
+				mOptimizer.addVertex(mvpIO[c]);
+				mnAllocations += 2;
+			}
+		}
+		for (int c = 0; c < nrCams; ++c)
+		{
+			mvpMc[c]->setEstimate(camSystem.Get_M_c_min(c));
+			mvpIO[c]->camModel = camSystem.GetCamModelObj(c);
+			mvpIO[c]->setEstimate(mvpIO[c]->camModel.toVector());
+		}
+	}
+
+	VertexMt_cayley* cLocalBAGraph::AddPose(cMultiKeyFrame* pKF, const bool& fixed)
+	{
+		std::unordered_map<long unsigned int, sPoseEntry>::iterator it = mmPoses.find(pKF->mnId);
+		if (it == mmPoses.end())
+		{
+			sPoseEntry entry;
+			if (mvpFreePoses.empty())
+			{
+				entry.pVertex = new VertexMt_cayley();
+				entry.pVertex->setId(mnNextVertexId++);
+				++mnAllocations;
+			}
+			else
+			{
+				entry.pVertex = mvpFreePoses.back();
+				mvpFreePoses.pop_back();
+			}
+			mOptimizer.addVertex(entry.pVertex);
+			it = mmPoses.insert(std::make_pair(pKF->mnId, entry)).first;
+		}
+		sPoseEntry& entry = it->second;
+		entry.nUpdate = mnUpdate;
+		entry.pVertex->setEstimate(pKF->camSystem.Get_M_t_min());
+		entry.pVertex->setFixed(fixed);
+		return entry.pVertex;
+	}
+
+	VertexPointXYZ* cLocalBAGraph::AddPoint(cMapPoint* pMP)
+	{
+		std::unordered_map<long unsigned int, sPointEntry>::iterator it = mmPoints.find(pMP->mnId);
+		if (it == mmPoints.end())
+		{
+			sPointEntry entry;
+			if (mvpFreePoints.empty())
+			{
+				entry.pVertex = new VertexPointXYZ();
+				entry.pVertex->setId(mnNextVertexId++);
+				++mnAllocations;
+			}
+			else
+			{
+				entry.pVertex = mvpFreePoints.back();
+				mvpFreePoints.pop_back();
+			}
+			mOptimizer.addVertex(entry.pVertex);
+			it = mmPoints.insert(std::make_pair(pMP->mnId, entry)).first;
+		}
+		sPointEntry& entry = it->second;
+		entry.nUpdate = mnUpdate;
+		entry.pVertex->setEstimate(pMP->GetWorldPos());
+		// for local ba, landmarks are not fixed
+		entry.pVertex->setFixed(false);
+		entry.pVertex->setMarginalized(true);
+		return entry.pVertex;
+	}
+
+	EdgeProjectXYZ2MCS* cLocalBAGraph::AddObservation(cMultiKeyFrame* pKF, cMapPoint* pMP,
+		const size_t& obsIdx, const int& cam,
+		const cv::KeyPoint& kpUn, const double& thHuber)
+	{
+		sPointEntry& point = mmPoints.find(pMP->mnId)->second;
+		VertexMt_cayley* vPose = mmPoses.find(pKF->mnId)->second.pVertex;
+
+		EdgeProjectXYZ2MCS* e = NULL;
+		for (size_t i = 0; i < point.vEdges.size(); ++i)
+		{
+			sEdgeEntry& edge = point.vEdges[i];
+			if (edge.nKFId != pKF->mnId || edge.nObsIdx != obsIdx)
+				continue;
+			// the keyframe vertex was recycled in between, connect it again
+			if (edge.pEdge->vertex(0) != vPose || edge.pEdge->vertex(2) != mvpMc[cam])
+			{
+				DetachEdge(edge.pEdge);
+				mvpFreeEdges.push_back(edge.pEdge);
+				point.vEdges.erase(point.vEdges.begin() + i);
+				break;
+			}
+			edge.nUpdate = mnUpdate;
+			e = edge.pEdge;
+			break;
+		}
+
+		if (!e)
+		{
+			if (mvpFreeEdges.empty())
+			{
+				e = new EdgeProjectXYZ2MCS();
+				e->setRobustKernel(new g2o::RobustKernelHuber);
+				mnAllocations += 2;
+			}
+			else
+			{
+				e = mvpFreeEdges.back();
+				mvpFreeEdges.pop_back();
+			}
+			// Mt, 3D point, Mc, IO
+			e->setVertex(0, vPose);
+			e->setVertex(1, point.pVertex);
+			e->setVertex(2, mvpMc[cam]);
+			e->setVertex(3, mvpIO[cam]);
+			mOptimizer.addEdge(e);
+
+			sEdgeEntry edge;
+			edge.nKFId = pKF->mnId;
+			edge.nObsIdx = obsIdx;
+			edge.pEdge = e;
+			edge.nUpdate = mnUpdate;
+			point.vEdges.push_back(edge);
+		}
+
+		e->setMeasurement(Eigen::Vector2d(kpUn.pt.x, kpUn.pt.y));
+		e->setInformation(Eigen::Matrix2d::Identity() * pKF->GetInvSigma2(kpUn.octave));
+		e->robustKernel()->setDelta(thHuber);
+		e->setLevel(0);
+		return e;
+	}
+
+	void cLocalBAGraph::EndUpdate()
+	{
+		// edges first, every edge left in the graph then has all its vertices there
+		std::unordered_map<long unsigned int, sPointEntry>::iterator pit = mmPoints.begin();
+		while (pit != mmPoints.end())
+		{
+			sPointEntry& point = pit->second;
+			const bool bPointUsed = point.nUpdate == mnUpdate;
+			size_t nKept = 0;
+			for (size_t i = 0; i < point.vEdges.size(); ++i)
+			{
+				if (bPointUsed && point.vEdges[i].nUpdate == mnUpdate)
+					point.vEdges[nKept++] = point.vEdges[i];
+				else
+				{
+					DetachEdge(point.vEdges[i].pEdge);
+					mvpFreeEdges.push_back(point.vEdges[i].pEdge);
+				}
+			}
+			point.vEdges.resize(nKept);
+			if (bPointUsed)
+				++pit;
+			else
+			{
+				DetachVertex(point.pVertex);
+				mvpFreePoints.push_back(point.pVertex);
+				pit = mmPoints.erase(pit);
+			}
+		}
+
+		std::unordered_map<long unsigned int, sPoseEntry>::iterator kit = mmPoses.begin();
+		while (kit != mmPoses.end())
+		{
+			if (kit->second.nUpdate == mnUpdate)
+				++kit;
+			else
+			{
+				DetachVertex(kit->second.pVertex);
+				mvpFreePoses.push_back(kit->second.pVertex);
+				kit = mmPoses.erase(kit);
+			}
+		}
+	}
+
+	int cLocalBAGraph::Optimize(const int& nIterations, const double& gainThreshold)
+	{
+		mbStop = mpbStopFlag && *mpbStopFlag;
+		if (mbStop)
+			return 0;
+		cLocalBATerminateAction terminateAction(mpbStopFlag, gainThreshold);
+		mOptimizer.addPostIterationAction(&terminateAction);
+		const int result = mOptimizer.optimize(nIterations);
+		mOptimizer.removePostIterationAction(&terminateAction);
+		// the flag is clear, so g2o ran at least one iteration unless the solver failed
+		if (result == 0 && nIterations > 0)
+			return -1;
+		return result;
+	}
+
+	VertexMt_cayley* cLocalBAGraph::PoseVertex(cMultiKeyFrame* pKF) const
+	{
+		std::unordered_map<long unsigned int, sPoseEntry>::const_iterator it = mmPoses.find(pKF->mnId);
+		if (it == mmPoses.end() || it->second.nUpdate != mnUpdate)
+			return NULL;
+		return it->second.pVertex;
+	}
+
+	void cLocalBAGraph::DetachEdge(EdgeProjectXYZ2MCS* e)
+	{
+		mOptimizer.edges().erase(e);
+		for (size_t i = 0; i < e->vertices().size(); ++i)
+			if (e->vertex(i))
+				e->vertex(i)->edges().erase(e);
+	}
+
+	void cLocalBAGraph::DetachVertex(g2o::OptimizableGraph::Vertex* v)
+	{
+		// the hessian index is reset by the next initializeOptimization
+		mOptimizer.vertices().erase(v->id());
+	}
+}
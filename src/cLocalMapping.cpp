@@ -28,6 +28,9 @@
 #include "cLoopClosing.h"
 #include "cORBmatcher.h"
 #include "cOptimizer.h"
+#include "cLocalBAGraph.h"
+#include "cIncrementalBA.h"
+#include "cGlobalBA.h"
 #include "cConverter.h"
 
 // opengv
@@ -45,6 +48,7 @@ namespace MultiColSLAM
 	cLocalMapping::cLocalMapping(cMap *pMap) :
 		mbResetRequested(false),
 		mpMap(pMap),
+		mpGlobalBA(NULL),
 		mbAbortBA(false),
 		mbStopped(false),
 		mbStopRequested(false),
@@ -66,17 +70,34 @@ namespace MultiColSLAM
 		mpTracker = pTracker;
 	}
 
+	void cLocalMapping::SetGlobalBA(cGlobalBA* pGlobalBA)
+	{
+		mpGlobalBA = pGlobalBA;
+	}
+
 	void cLocalMapping::Run()
 	{
 		std::chrono::steady_clock::time_point begin;
 		std::chrono::steady_clock::time_point end;
+		cEpochReclaimer* pReclaimer = mpMap->GetReclaimer();
+		const int reclaimerId = pReclaimer->RegisterThread();
+		// counts for this thread, so it has to be opened here
+		cCacheMissCounter cacheMissCounter;
+		// updated from one local BA to the next
+		cLocalBAGraph localBAGraph;
+		// or the problem of the incremental backend
+		cIncrementalBA incrementalBA;
 		while (true)
 		{
 			// Tracking will see that Local Mapping is busy
 			SetAcceptMultiKeyFrames(false);
+			// a finished global BA is merged here, nothing else changes the map meanwhile
+			if (mpGlobalBA && mpGlobalBA->MergeIfDone())
+				cout << "Global BA merged" << endl;
 			// Check if there are keyframes in the queue
 			if (CheckNewMultiKeyFrames())
 			{
+				std::chrono::steady_clock::time_point beginKF = std::chrono::steady_clock::now();
 				// BoW conversion and insertion in Map
 				// and rendering of depth images
 				ProcessNewMultiKeyFrame();
@@ -96,19 +117,46 @@ namespace MultiColSLAM
 					!stopRequested())
 				{
 					// Local BA
-					cOptimizer::LocalBundleAdjustment(mpCurrentMultiKeyFrame, mpMap,
-						5, true, &mbAbortBA);
+					begin = std::chrono::steady_clock::now();
+					int nAllocations = 0;
+					if (cOptimizer::incrementalBackend)
+					{
+						cOptimizer::IncrementalBundleAdjustment(mpCurrentMultiKeyFrame,
+							&incrementalBA, &mbAbortBA);
+						relinearizedLocalBA.push_back(incrementalBA.NrRelinearized());
+						eliminatedLocalBA.push_back(incrementalBA.NrEliminated());
+						rejectedLocalBA.push_back(incrementalBA.NrRejected());
+					}
+					else
+						cOptimizer::LocalBundleAdjustment(mpCurrentMultiKeyFrame, mpMap,
+							5, true, &mbAbortBA, &cacheMissCounter,
+							cOptimizer::reuseLocalBAGraph ? &localBAGraph : NULL, &nAllocations);
+					end = std::chrono::steady_clock::now();
+					allocationsLocalBA.push_back(nAllocations);
+					timingLocalBA.push_back(
+						std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0);
+					if (cacheMissCounter.Available())
+					{
+						cacheMissesL1LocalBASetup.push_back(cacheMissCounter.L1Misses());
+						cacheMissesLLCLocalBASetup.push_back(cacheMissCounter.LLCMisses());
+					}
 
 					// Check redundant local Keyframes
 					KeyFrameCulling();
 				}
 				mpLoopCloser->InsertKeyFrame(mpCurrentMultiKeyFrame);
+				timingLocalMapping.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - beginKF).count() / 1000.0);
 			}
 			// Safe area to stop
 			else if (Stop())
 			{
 				while (isStopped() && !CheckFinish())
+				{
+					ReleaseBadReferences();
+					pReclaimer->QuiescentState(reclaimerId);
 					std::this_thread::sleep_for(std::chrono::milliseconds(500));
+				}
 				if (CheckFinish())
 					break;
 			}
@@ -119,17 +167,99 @@ namespace MultiColSLAM
 			if (CheckFinish())
 				break;
 
+			// no references to bad map points or keyframes survive this point
+			ReleaseBadReferences();
+			pReclaimer->QuiescentState(reclaimerId);
+
 			if (mpMap->KeyFramesInMap() > 4)
 				std::this_thread::sleep_for(std::chrono::milliseconds(100));
 			else
 				std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
 		}
+		pReclaimer->UnregisterThread(reclaimerId);
+		if (!timingLocalBA.empty())
+		{
+			double meanBA = 0.0;
+			for (size_t i = 0; i < timingLocalBA.size(); ++i)
+				meanBA += timingLocalBA[i];
+			meanBA /= timingLocalBA.size();
+			cout << "local BA (mean over " << timingLocalBA.size() << " runs): " << meanBA <<
+				"ms with " << cOptimizer::nBAThreads << " linearization threads" << endl;
+		}
+		if (!allocationsLocalBA.empty())
+		{
+			double meanAllocations = 0.0;
+			for (size_t i = 0; i < allocationsLocalBA.size(); ++i)
+				meanAllocations += allocationsLocalBA[i];
+			meanAllocations /= allocationsLocalBA.size();
+			cout << "local BA g2o allocations (mean over " << allocationsLocalBA.size() << " runs): " <<
+				meanAllocations << (cOptimizer::reuseLocalBAGraph ? ", graph reused" : ", new graph per run") << endl;
+		}
+		if (!relinearizedLocalBA.empty())
+		{
+			double meanRelinearized = 0.0, meanEliminated = 0.0, meanRejected = 0.0;
+			for (size_t i = 0; i < relinearizedLocalBA.size(); ++i)
+			{
+				meanRelinearized += relinearizedLocalBA[i];
+				meanEliminated += eliminatedLocalBA[i];
+				meanRejected += rejectedLocalBA[i];
+			}
+			meanRelinearized /= relinearizedLocalBA.size();
+			meanEliminated /= eliminatedLocalBA.size();
+			meanRejected /= rejectedLocalBA.size();
+			cout << "incremental backend (mean over " << relinearizedLocalBA.size() << " runs): " <<
+				meanRelinearized << " observations relinearized, " << meanEliminated << " points eliminated, " <<
+				meanRejected << " steps rejected" << endl;
+		}
+		if (!timingLocalMapping.empty())
+		{
+			double meanLM = 0.0;
+			for (size_t i = 0; i < timingLocalMapping.size(); ++i)
+				meanLM += timingLocalMapping[i];
+			meanLM /= timingLocalMapping.size();
+			cout << "local mapping per keyframe (mean over " << timingLocalMapping.size() << " keyframes): " <<
+				meanLM << "ms" << endl;
+		}
+		if (!cacheMissesL1LocalBASetup.empty())
+		{
+			double meanL1 = 0.0, meanLLC = 0.0;
+			for (size_t i = 0; i < cacheMissesL1LocalBASetup.size(); ++i)
+			{
+				meanL1 += cacheMissesL1LocalBASetup[i];
+				meanLLC += cacheMissesLLCLocalBASetup[i];
+			}
+			meanL1 /= cacheMissesL1LocalBASetup.size();
+			meanLLC /= cacheMissesLLCLocalBASetup.size();
+			cout << "local BA setup cache misses (mean over " << cacheMissesL1LocalBASetup.size()
+				<< " runs) L1D: " << meanL1 << " LLC: " << meanLLC << endl;
+		}
 		SetFinish();
 	}
 
+	void cLocalMapping::ReleaseBadReferences()
+	{
+		// recently added points might have been fused by the loop closer
+		std::list<cMapPoint*>::iterator lit = mlpRecentAddedMapPoints.begin();
+		while (lit != mlpRecentAddedMapPoints.end())
+		{
+			if ((*lit)->isBad())
+				lit = mlpRecentAddedMapPoints.erase(lit);
+			else
+				lit++;
+		}
+
+		// queued keyframes are not in the map yet, so nobody else unlinks their points
+		std::unique_lock<std::mutex> lock(mMutexNewKFs);
+		for (std::list<cMultiKeyFrame*>::iterator kit = mlNewMultiKeyFrames.begin(),
+			kend = mlNewMultiKeyFrames.end(); kit != kend; ++kit)
+			(*kit)->EraseBadMapPointMatches();
+	}
+
 	void cLocalMapping::InsertMultiKeyFrame(cMultiKeyFrame *pKF)
 	{
+		// the frame the keyframe was created from may still point to culled map points
+		pKF->EraseBadMapPointMatches();
 		std::unique_lock<std::mutex> lock(mMutexNewKFs);
 		mlNewMultiKeyFrames.push_back(pKF);
 		mbAbortBA = true;
@@ -174,6 +304,8 @@ namespace MultiColSLAM
 						pMP->ComputeDistinctiveDescriptors();
 					}
 				}
+				else // no observation links it, so it would never be unlinked
+					mpCurrentMultiKeyFrame->EraseMapPointMatch(i);
 			}
 		}
 
@@ -195,25 +327,22 @@ namespace MultiColSLAM
 			if (pMP->isBad())
 			{
 				lit = mlpRecentAddedMapPoints.erase(lit);
-				//mpMap->EraseMapPoint(pMP);
 			}
 			else if (pMP->GetFoundRatio() < 0.25)
 			{
+				// SetBadFlag erases the point from the map, which retires it
 				pMP->SetBadFlag();
 				lit = mlpRecentAddedMapPoints.erase(lit);
-				//mpMap->EraseMapPoint(pMP);
 			}
 			else if ((nCurrentKFid - pMP->mnFirstKFid) >= 2 &&
 				pMP->Observations() <= 2)
 			{
 				pMP->SetBadFlag();
 				lit = mlpRecentAddedMapPoints.erase(lit);
-				//mpMap->EraseMapPoint(pMP);
 			}
 			else if ((nCurrentKFid - pMP->mnFirstKFid) >= 3)
 			{
 				lit = mlpRecentAddedMapPoints.erase(lit);
-				//mpMap->EraseMapPoint(pMP);
 			}
 			else
 				lit++;
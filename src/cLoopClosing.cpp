@@ -29,6 +29,7 @@
 #include "cConverter.h"
 #include "cOptimizer.h"
 #include "cORBmatcher.h"
+#include "cGlobalBA.h"
 
 
 
@@ -41,6 +42,7 @@ namespace MultiColSLAM
 		mpMap(pMap),
 		mpKeyFrameDB(pDB),
 		mpORBVocabulary(pVoc),
+		mpGlobalBA(NULL),
 		mLastLoopKFid(0),
 		mbFinishRequested(false),
 		mbFinished(false)
@@ -54,6 +56,11 @@ namespace MultiColSLAM
 		mpTracker = pTracker;
 	}
 
+	void cLoopClosing::SetGlobalBA(cGlobalBA* pGlobalBA)
+	{
+		mpGlobalBA = pGlobalBA;
+	}
+
 	void cLoopClosing::SetLocalMapper(cLocalMapping *pLocalMapper)
 	{
 		mpLocalMapper = pLocalMapper;
@@ -62,6 +69,8 @@ namespace MultiColSLAM
 
 	void cLoopClosing::Run()
 	{
+		cEpochReclaimer* pReclaimer = mpMap->GetReclaimer();
+		const int reclaimerId = pReclaimer->RegisterThread();
 
 		while (1)
 		{
@@ -87,23 +96,64 @@ namespace MultiColSLAM
 			if (CheckFinish())
 				break;
 			// for display purposes
-			vector<cMultiKeyFrame*> vKeyFrames = mpMap->GetAllKeyFrames();
+			const cSnapshot<cMultiKeyFrame> vKeyFrames = mpMap->GetKeyFrameSnapshot();
 			for (size_t i = 0; i < vKeyFrames.size(); ++i)
 				vKeyFrames[i]->SetLoopCandidate(false);
 
+			// no references to bad map points or keyframes survive this point
+			ReleaseBadReferences();
+			pReclaimer->QuiescentState(reclaimerId);
+
 			std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 		}
 
+		pReclaimer->UnregisterThread(reclaimerId);
 		SetFinish();
 	}
 
 	void cLoopClosing::InsertKeyFrame(cMultiKeyFrame *pKF)
 	{
 		std::unique_lock<std::mutex> lock(mMutexLoopQueue);
-		if (pKF->mnId != 0)
+		if (pKF->mnId != 0 && !pKF->isBad())
 			mlpLoopKeyFrameQueue.push_back(pKF);
 	}
 
+	void cLoopClosing::ReleaseBadReferences()
+	{
+		{
+			// keyframes can be culled by local mapping while they are queued
+			std::unique_lock<std::mutex> lock(mMutexLoopQueue);
+			std::list<cMultiKeyFrame*>::iterator lit = mlpLoopKeyFrameQueue.begin();
+			while (lit != mlpLoopKeyFrameQueue.end())
+			{
+				if ((*lit)->isBad())
+					lit = mlpLoopKeyFrameQueue.erase(lit);
+				else
+					lit++;
+			}
+		}
+
+		// the consistency groups are kept across keyframes, so a freed
+		// keyframe address could be reused and wrongly match a group
+		for (size_t iG = 0; iG < mvConsistentGroups.size(); ++iG)
+		{
+			std::set<cMultiKeyFrame*>& sGroup = mvConsistentGroups[iG].first;
+			for (std::set<cMultiKeyFrame*>::iterator sit = sGroup.begin(); sit != sGroup.end();)
+			{
+				if ((*sit)->isBad())
+					sGroup.erase(sit++);
+				else
+					++sit;
+			}
+		}
+
+		// the remaining members are only valid during one loop detection
+		mvpEnoughConsistentCandidates.clear();
+		mvpCurrentConnectedKFs.clear();
+		mvpCurrentMatchedPoints.clear();
+		mvpLoopMapPoints.clear();
+	}
+
 	bool cLoopClosing::CheckNewKeyFrames()
 	{
 		std::unique_lock<std::mutex>  lock(mMutexLoopQueue);
@@ -465,6 +515,10 @@ namespace MultiColSLAM
 	{
 
 		cout << "======= IN LOOP CORRECTION ========" << endl;
+		// a running global BA works on the map before the loop, its result is useless now
+		if (mpGlobalBA)
+			mpGlobalBA->Cancel();
+
 		// Send a stop signal to Local Mapping
 		// Avoid new MKFs are inserted while correcting the loop
 		mpLocalMapper->RequestStop();
@@ -579,7 +633,8 @@ namespace MultiColSLAM
 		// Update matched map points and replace if duplicated
 		for (size_t i = 0; i < mvpCurrentMatchedPoints.size(); ++i)
 		{
-			if (mvpCurrentMatchedPoints[i])
+			// the loop point could have been culled before local mapping stopped
+			if (mvpCurrentMatchedPoints[i] && !mvpCurrentMatchedPoints[i]->isBad())
 			{
 				cMapPoint* pLoopMP = mvpCurrentMatchedPoints[i];
 				cMapPoint* pCurMP = mpCurrentKF->GetMapPoint(i);
@@ -665,6 +720,10 @@ namespace MultiColSLAM
 
 		cout << "Loop Closed!" << endl;
 		mpMap->SetFlagAfterBA();
+
+		// the essential graph only corrected the poses, refine everything in the background
+		if (mpGlobalBA && cOptimizer::globalBAAfterLoop)
+			mpGlobalBA->Start(cOptimizer::globalBAIterations);
 	}
 
 	void cLoopClosing::SearchAndFuse(KeyFrameAndPose &CorrectedPosesMap)
@@ -707,7 +766,10 @@ namespace MultiColSLAM
 		if (mbResetRequested)
 		{
 			mlpLoopKeyFrameQueue.clear();
+			mvConsistentGroups.clear();
 			mLastLoopKFid = 0;
+			if (mpGlobalBA)
+				mpGlobalBA->Cancel();
 			mbResetRequested = false;
 		}
 	}
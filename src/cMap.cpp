@@ -32,12 +32,14 @@ namespace MultiColSLAM
 	{
 		mbMapUpdated = false;
 		mnMaxKFid = 0;
+		mnEraseVersion = 0;
+		mnGeometryVersion = 0;
 	}
 
 	void cMap::AddKeyFrame(cMultiKeyFrame *pKF)
 	{
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		mspKeyFrames.insert(pKF);
+		mvpKeyFrames.Add(pKF);
 		if (pKF->mnId > mnMaxKFid)
 			mnMaxKFid = pKF->mnId;
 		mbMapUpdated = true;
@@ -46,21 +48,27 @@ namespace MultiColSLAM
 	void cMap::AddMapPoint(cMapPoint *pMP)
 	{
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		mspMapPoints.insert(pMP);
+		mvpMapPoints.Add(pMP);
 		mbMapUpdated = true;
 	}
 
 	void cMap::EraseMapPoint(cMapPoint *pMP)
 	{
+		// before retiring, so the tracker notices in time (see cEpochReclaimer)
+		InformObjectErased();
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		mspMapPoints.erase(pMP);
+		// SetBadFlag and Replace may both end up here, retire only once
+		if (mvpMapPoints.Erase(pMP))
+			mReclaimer.Retire(pMP);
 		mbMapUpdated = true;
 	}
 
 	void cMap::EraseKeyFrame(cMultiKeyFrame *pKF)
 	{
+		InformObjectErased();
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		mspKeyFrames.erase(pKF);
+		if (mvpKeyFrames.Erase(pKF))
+			mReclaimer.Retire(pKF);
 		mbMapUpdated = true;
 	}
 
@@ -73,26 +81,37 @@ namespace MultiColSLAM
 
 	std::vector<cMultiKeyFrame*> cMap::GetAllKeyFrames()
 	{
-		std::unique_lock<std::mutex> lock(mMutexMap);
-		return std::vector<cMultiKeyFrame*>(mspKeyFrames.begin(), mspKeyFrames.end());
+		// copy outside of the lock
+		return GetKeyFrameSnapshot().ToVector();
 	}
 
 	std::vector<cMapPoint*> cMap::GetAllMapPoints()
+	{
+		return GetMapPointSnapshot().ToVector();
+	}
+
+	cSnapshot<cMultiKeyFrame> cMap::GetKeyFrameSnapshot()
+	{
+		std::unique_lock<std::mutex> lock(mMutexMap);
+		return mvpKeyFrames.Snapshot();
+	}
+
+	cSnapshot<cMapPoint> cMap::GetMapPointSnapshot()
 	{
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		return std::vector<cMapPoint*>(mspMapPoints.begin(), mspMapPoints.end());
+		return mvpMapPoints.Snapshot();
 	}
 
 	int cMap::MapPointsInMap()
 	{
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		return mspMapPoints.size();
+		return mvpMapPoints.Size();
 	}
 
 	int cMap::KeyFramesInMap()
 	{
 		std::unique_lock<std::mutex> lock(mMutexMap);
-		return mspKeyFrames.size();
+		return mvpKeyFrames.Size();
 	}
 
 	std::vector<cMapPoint*> cMap::GetReferenceMapPoints()
@@ -127,17 +146,18 @@ namespace MultiColSLAM
 
 	void cMap::clear()
 	{
-		for (std::set<cMapPoint*>::iterator sit = mspMapPoints.begin(), send = mspMapPoints.end();
-			sit != send; ++sit)
-			delete *sit;
+		for (size_t i = 0; i < mvpMapPoints.Size(); ++i)
+			delete mvpMapPoints[i];
 
-		for (std::set<cMultiKeyFrame*>::iterator sit = mspKeyFrames.begin(), send = mspKeyFrames.end();
-			sit != send; ++sit)
-			delete *sit;
+		for (size_t i = 0; i < mvpKeyFrames.Size(); ++i)
+			delete mvpKeyFrames[i];
 
-		mspMapPoints.clear();
-		mspKeyFrames.clear();
+		mvpMapPoints.Clear();
+		mvpKeyFrames.Clear();
 		mnMaxKFid = 0;
+		mReclaimer.Flush();
 		mvpReferenceMapPoints.clear();
+		InformObjectErased();
+		InformGeometryChange();
 	}
 }
\ No newline at end of file
@@ -31,6 +31,33 @@ namespace MultiColSLAM
 {
 	long unsigned int cMapPoint::nNextId = 0;
 
+	cObjectPool<cMapPoint>& cMapPoint::GetPool()
+	{
+		// never destroyed, points might still be deleted by other static destructors
+		static cObjectPool<cMapPoint>* pPool = new cObjectPool<cMapPoint>();
+		return *pPool;
+	}
+
+	void* cMapPoint::operator new(size_t size)
+	{
+		if (size != sizeof(cMapPoint))
+			return ::operator new(size);
+		return GetPool().Allocate();
+	}
+
+	void cMapPoint::operator delete(void* p, size_t size)
+	{
+		if (size != sizeof(cMapPoint))
+			return ::operator delete(p);
+		GetPool().Deallocate(p);
+	}
+
+	bool cMapPoint::AllocationOrder(const cMapPoint* pMP1, const cMapPoint* pMP2)
+	{
+		return cObjectPool<cMapPoint>::AllocationIndex(pMP1) <
+			cObjectPool<cMapPoint>::AllocationIndex(pMP2);
+	}
+
 	cMapPoint::cMapPoint(const cv::Vec3d &Pos,
 		cMultiKeyFrame *pRefKF, cMap* pMap) :
 		mnFirstKFid(pRefKF->mnId),
@@ -40,6 +67,7 @@ namespace MultiColSLAM
 		mnLoopPointForKF(0),
 		mnCorrectedByKF(0),
 		mnCorrectedReference(0),
+		mnMapIndex(static_cast<size_t>(-1)),
 		mpRefKF(pRefKF),
 		mnVisible(1),
 		mnFound(1),
@@ -67,6 +95,7 @@ namespace MultiColSLAM
 	{
 		std::unique_lock<std::mutex> lock(mMutexPos);
 		mWorldPos = Pos;
+		mpMap->InformGeometryChange();
 	}
 
 	cv::Vec3d cMapPoint::GetWorldPos()
@@ -93,6 +122,7 @@ namespace MultiColSLAM
 		// here it means, for a single mappoint, it may be observed by different cameras in a single MF
 		// TODO check if other places use this different formulation, at least for covisibility it's not used!
 		mObservations[pKF].push_back(idx); // push back since multiple image points per 3d point exist
+		pKF->InformObservationChange();
 	}
 
 	void cMapPoint::EraseAllObservations(cMultiKeyFrame* pKF)
@@ -112,6 +142,7 @@ namespace MultiColSLAM
 					bBad = true;
 			}
 		}
+		pKF->InformObservationChange();
 
 		if (bBad)
 			SetBadFlag();
@@ -146,6 +177,7 @@ namespace MultiColSLAM
 			if (nrObs < 2)
 				bBad = true;
 		}
+		pKF->InformObservationChange();
 
 		if (bBad)
 			SetBadFlag();
@@ -493,6 +525,7 @@ namespace MultiColSLAM
 			mfMaxDistance = scaleFactor * dist * pRefKF->GetScaleFactor(nLevels - 1 - level);
 			mNormalVector = normal / n;
 		}
+		mpMap->InformGeometryChange();
 	}
 
 	double cMapPoint::GetMinDistanceInvariance()
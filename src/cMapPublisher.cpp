@@ -59,7 +59,7 @@ namespace MultiColSLAM
 	void cMapPublisher::PublishMapPoints()
 	{
 #ifndef _DEBUG
-		vector<cMapPoint*> vpMPs = mpMap->GetAllMapPoints();
+		const cSnapshot<cMapPoint> vpMPs = mpMap->GetMapPointSnapshot();
 		vector<cMapPoint*> vpRefMPs = mpMap->GetReferenceMapPoints();
 		set<cMapPoint*> spRefMPs(vpRefMPs.begin(), vpRefMPs.end());
 
@@ -105,7 +105,7 @@ namespace MultiColSLAM
 		const float h = w*0.75;
 		const float z = w*0.6;
 
-		const vector<cMultiKeyFrame*> vpMKFs = mpMap->GetAllKeyFrames();
+		const cSnapshot<cMultiKeyFrame> vpMKFs = mpMap->GetKeyFrameSnapshot();
 
 		if (bDrawKF)
 		{
@@ -35,7 +35,7 @@ namespace MultiColSLAM
 	std::vector<int> cMultiFrame::mnMinX, cMultiFrame::mnMinY;
 	std::vector<int> cMultiFrame::mnMaxX, cMultiFrame::mnMaxY;
 
-	cMultiFrame::cMultiFrame()
+	cMultiFrame::cMultiFrame() : mdExtractionTime(0.0)
 	{}
 
 	//Copy Constructor
@@ -43,7 +43,9 @@ namespace MultiColSLAM
 		:
 		mpORBvocabulary(mframe.mpORBvocabulary),
 		images(mframe.images),
+		mvImagePyramids(mframe.mvImagePyramids),
 		mTimeStamp(mframe.mTimeStamp),
+		mdExtractionTime(mframe.mdExtractionTime),
 		camSystem(mframe.camSystem),
 		N(mframe.N),
 		totalN(mframe.totalN),
@@ -72,21 +74,9 @@ namespace MultiColSLAM
 		imgCnt(mframe.imgCnt),
 		mp_mdBRIEF_extractorOct(mframe.mp_mdBRIEF_extractorOct)
 	{
-		int nrCams = camSystem.GetNrCams();
-		mGrids.resize(nrCams);
-		mnMinX.resize(nrCams);
-		mnMaxX.resize(nrCams);
-		mnMinY.resize(nrCams);
-		mnMaxY.resize(nrCams);
-		for (int c = 0; c < camSystem.GetNrCams(); ++c)
-		{
-			mGrids[c] = mframe.mGrids[c];
-
-			mnMinX[c] = 0;
-			mnMaxX[c] = camSystem.GetCamModelObj(c).GetWidth();
-			mnMinY[c] = 0;
-			mnMaxY[c] = camSystem.GetCamModelObj(c).GetHeight();
-		}
+		// the image bounds were computed by the first frame,
+		// frames can be copied on a different thread than they were extracted
+		mGrids = mframe.mGrids;
 	}
 
 	cMultiFrame::cMultiFrame(const std::vector<cv::Mat>& images_,
@@ -109,11 +99,23 @@ namespace MultiColSLAM
 		int nrCams = camSystem.GetNrCams();
 		mDescriptors.resize(nrCams);
 		mDescriptorMasks.resize(nrCams);
+		mvImagePyramids.resize(nrCams);
 		N.resize(nrCams);
-		mnMinX.resize(nrCams);
-		mnMaxX.resize(nrCams);
-		mnMinY.resize(nrCams);
-		mnMaxY.resize(nrCams);
+		if (mbInitialComputations)
+		{
+			mnMinX.resize(nrCams);
+			mnMaxX.resize(nrCams);
+			mnMinY.resize(nrCams);
+			mnMaxY.resize(nrCams);
+			for (int c = 0; c < nrCams; ++c)
+			{
+				mnMinX[c] = 0;
+				mnMaxX[c] = camSystem.GetCamModelObj(c).GetWidth();
+				mnMinY[c] = 0;
+				mnMaxY[c] = camSystem.GetCamModelObj(c).GetHeight();
+			}
+			mbInitialComputations = false;
+		}
 		mfGridElementWidthInv.resize(nrCams);
 		mfGridElementHeightInv.resize(nrCams);
 
@@ -129,14 +131,11 @@ namespace MultiColSLAM
 		for (int c = 0; c < nrCams; ++c)
 		{
 			cCamModelGeneral_ camModel = camSystem.GetCamModelObj(c);
-			mnMinX[c] = 0;
-			mnMaxX[c] = camModel.GetWidth();
-			mnMinY[c] = 0;
-			mnMaxY[c] = camModel.GetHeight();
 
 			// First step feature extraction ORB in the mirror mask
 			(*mp_mdBRIEF_extractorOct[c])(images[c], camModel.GetMirrorMask(0),
 				keyPtsTemp[c], camModel, mDescriptors[c], mDescriptorMasks[c]);
+			mvImagePyramids[c] = mp_mdBRIEF_extractorOct[c]->GetImagePyramid();
 
 			N[c] = (int)keyPtsTemp[c].size();
 
@@ -212,7 +211,8 @@ namespace MultiColSLAM
 		this->descDimension = extractor[0]->GetDescriptorSize();
 
 		HResClk::time_point end = HResClk::now();
-		cout << "---Feature Extraction (" << T_in_ms(begin, end) << "ms) - ImageId: " << mnId << "---" << endl;
+		mdExtractionTime = T_in_ms(begin, end);
+		cout << "---Feature Extraction (" << mdExtractionTime << "ms) - ImageId: " << mnId << "---" << endl;
 	}
 
 	bool cMultiFrame::isInFrustum(int cam, cMapPoint *pMP, double viewingCosLimit)
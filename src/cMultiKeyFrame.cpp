@@ -32,6 +32,33 @@ namespace MultiColSLAM
 {
 	long unsigned int cMultiKeyFrame::nNextId = 0;
 
+	cObjectPool<cMultiKeyFrame, 128>& cMultiKeyFrame::GetPool()
+	{
+		// never destroyed, see cMapPoint::GetPool
+		static cObjectPool<cMultiKeyFrame, 128>* pPool = new cObjectPool<cMultiKeyFrame, 128>();
+		return *pPool;
+	}
+
+	void* cMultiKeyFrame::operator new(size_t size)
+	{
+		if (size != sizeof(cMultiKeyFrame))
+			return ::operator new(size);
+		return GetPool().Allocate();
+	}
+
+	void cMultiKeyFrame::operator delete(void* p, size_t size)
+	{
+		if (size != sizeof(cMultiKeyFrame))
+			return ::operator delete(p);
+		GetPool().Deallocate(p);
+	}
+
+	bool cMultiKeyFrame::AllocationOrder(const cMultiKeyFrame* pKF1, const cMultiKeyFrame* pKF2)
+	{
+		return cObjectPool<cMultiKeyFrame, 128>::AllocationIndex(pKF1) <
+			cObjectPool<cMultiKeyFrame, 128>::AllocationIndex(pKF2);
+	}
+
 	cMultiKeyFrame::cMultiKeyFrame(cMultiFrame &F,
 		cMap *pMap,
 		cMultiKeyFrameDatabase *pKFDB) :
@@ -39,10 +66,10 @@ namespace MultiColSLAM
 		mTimeStamp(F.mTimeStamp),
 		mfGridElementWidthInv(F.mfGridElementWidthInv),
 		mfGridElementHeightInv(F.mfGridElementHeightInv),
-		mnTrackReferenceForFrame(0), mnBALocalForKF(0),
+		mnTrackReferenceForFrame(0), mnTrackObservationVersion(0), mnBALocalForKF(0),
 		mnBAFixedForKF(0),
-		mnLoopQuery(0),
-		mnRelocQuery(0),
+		mnMapIndex(static_cast<size_t>(-1)),
+		mnDatabaseSlot(-1),
 		mBowVec(F.mBowVec),
 		mBowVecs(F.mBowVecs),
 		mFeatVec(F.mFeatVec),
@@ -53,6 +80,7 @@ namespace MultiColSLAM
 		mvKeysRays(F.mvKeysRays),
 		mDescriptors(F.mDescriptors),
 		mvpMapPoints(F.mvpMapPoints),
+		mnObservationVersion(0),
 		keypoint_to_cam(F.keypoint_to_cam),
 		cont_idx_to_local_cam_idx(F.cont_idx_to_local_cam_idx),
 		mpKeyFrameDB(pKFDB),
@@ -272,20 +300,37 @@ namespace MultiColSLAM
 
 	void cMultiKeyFrame::AddMapPoint(cMapPoint *pMP, const size_t &idx)
 	{
-		std::unique_lock<std::mutex> lock(mMutexFeatures);
-		mvpMapPoints[idx] = pMP;
+		{
+			std::unique_lock<std::mutex> lock(mMutexFeatures);
+			mvpMapPoints[idx] = pMP;
+		}
+		InformObservationChange();
 	}
 
 	void cMultiKeyFrame::EraseMapPointMatch(const size_t &idx)
 	{
-		std::unique_lock<std::mutex> lock(mMutexFeatures);
-		mvpMapPoints[idx] = NULL;
+		{
+			std::unique_lock<std::mutex> lock(mMutexFeatures);
+			mvpMapPoints[idx] = NULL;
+		}
+		InformObservationChange();
 	}
 
 	void cMultiKeyFrame::ReplaceMapPointMatch(const size_t &idx, cMapPoint* pMP)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutexFeatures);
+			mvpMapPoints[idx] = pMP;
+		}
+		InformObservationChange();
+	}
+
+	void cMultiKeyFrame::EraseBadMapPointMatches()
 	{
 		std::unique_lock<std::mutex> lock(mMutexFeatures);
-		mvpMapPoints[idx] = pMP;
+		for (size_t i = 0, iend = mvpMapPoints.size(); i < iend; ++i)
+			if (mvpMapPoints[i] && mvpMapPoints[i]->isBad())
+				mvpMapPoints[i] = NULL;
 	}
 
 	std::set<cMapPoint*> cMultiKeyFrame::GetMapPoints()
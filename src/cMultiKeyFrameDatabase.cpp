@@ -29,12 +29,16 @@
 #include "cMultiKeyFrame.h"
 #include "DBoW2/DBoW2/BowVector.h"
 
+#include <omp.h>
+
 namespace MultiColSLAM
 {
 	using namespace std;
 
 	cMultiKeyFrameDatabase::cMultiKeyFrameDatabase(const ORBVocabulary &voc) :
-		mpVoc(&voc)
+		mpVoc(&voc),
+		mnEntries(0),
+		mnTombstones(0)
 	{
 		mvInvertedFile.resize(voc.size());
 	}
@@ -42,40 +46,155 @@ namespace MultiColSLAM
 
 	void cMultiKeyFrameDatabase::add(cMultiKeyFrame *pKF)
 	{
-		std::unique_lock<std::mutex> lock(mMutex);
+		std::unique_lock<cSharedMutex> lock(mMutex);
+
+		if (pKF->mnDatabaseSlot >= 0)
+			return;
+
+		int slot;
+		if (!mvnFreeSlots.empty())
+		{
+			slot = mvnFreeSlots.back();
+			mvnFreeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<int>(mvpSlotKeyFrames.size());
+			mvpSlotKeyFrames.push_back(NULL);
+		}
+		mvpSlotKeyFrames[slot] = pKF;
+		pKF->mnDatabaseSlot = slot;
 
 		for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end();
 			vit != vend; vit++)
-			mvInvertedFile[vit->first].push_back(pKF);
+			mvInvertedFile[vit->first].push_back(slot);
+		mnEntries += pKF->mBowVec.size();
 	}
 
 	void cMultiKeyFrameDatabase::erase(cMultiKeyFrame* pKF)
 	{
-		std::unique_lock<std::mutex> lock(mMutex);
+		std::unique_lock<cSharedMutex> lock(mMutex);
 
-		// Erase elements in the Inverse File for the entry
-		for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end();
+		const int slot = pKF->mnDatabaseSlot;
+		if (slot < 0 || mvpSlotKeyFrames[slot] != pKF)
+			return;
+
+		// the entries in the inverted file stay as tombstones
+		// until there are enough of them to be worth a compaction
+		mvpSlotKeyFrames[slot] = NULL;
+		mvnDeadSlots.push_back(slot);
+		pKF->mnDatabaseSlot = -1;
+		mnTombstones += pKF->mBowVec.size();
+
+		if (mnTombstones > 1000 && 4 * mnTombstones > mnEntries)
+			Compact();
+	}
+
+	void cMultiKeyFrameDatabase::Compact()
+	{
+		for (size_t w = 0; w < mvInvertedFile.size(); ++w)
+		{
+			std::vector<int>& vSlots = mvInvertedFile[w];
+			vSlots.erase(std::remove_if(vSlots.begin(), vSlots.end(),
+				[this](const int& slot) { return mvpSlotKeyFrames[slot] == NULL; }),
+				vSlots.end());
+		}
+		mvnFreeSlots.insert(mvnFreeSlots.end(), mvnDeadSlots.begin(), mvnDeadSlots.end());
+		mvnDeadSlots.clear();
+		mnEntries -= mnTombstones;
+		mnTombstones = 0;
+	}
+
+	void cMultiKeyFrameDatabase::clear()
+	{
+		std::unique_lock<cSharedMutex> lock(mMutex);
+		for (size_t i = 0; i < mvpSlotKeyFrames.size(); ++i)
+			if (mvpSlotKeyFrames[i])
+				mvpSlotKeyFrames[i]->mnDatabaseSlot = -1;
+		mvInvertedFile.clear();
+		mvInvertedFile.resize(mpVoc->size());
+		mvpSlotKeyFrames.clear();
+		mvnDeadSlots.clear();
+		mvnFreeSlots.clear();
+		mnEntries = 0;
+		mnTombstones = 0;
+	}
+
+	void cMultiKeyFrameDatabase::GetKeyFramesSharingWords(const DBoW2::BowVector& bowVec,
+		std::vector<cMultiKeyFrame*>& vpSlotKFs,
+		std::vector<int>& vnWords,
+		std::vector<int>& vnSharingSlots)
+	{
+		cSharedLock lock(mMutex);
+
+		// the slot table is small (one pointer per keyframe),
+		// with a copy the scoring can run without the lock
+		vpSlotKFs = mvpSlotKeyFrames;
+		const size_t nSlots = vpSlotKFs.size();
+		vnWords.assign(nSlots, 0);
+
+		std::vector<const std::vector<int>*> vpPostings;
+		vpPostings.reserve(bowVec.size());
+		size_t nEntries = 0;
+		for (DBoW2::BowVector::const_iterator vit = bowVec.begin(), vend = bowVec.end();
 			vit != vend; ++vit)
 		{
-			// List of keyframes that share the word
-			std::list<cMultiKeyFrame*> &lKFs = mvInvertedFile[vit->first];
+			vpPostings.push_back(&mvInvertedFile[vit->first]);
+			nEntries += vpPostings.back()->size();
+		}
 
-			for (std::list<cMultiKeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-				lit != lend; ++lit)
+		// large maps: each thread counts a part of the posting lists into its own array
+		const size_t minEntriesParallel = 50000;
+		if (nEntries > minEntriesParallel && omp_get_max_threads() > 1)
+		{
+			std::vector<std::vector<int> > vnThreadWords(omp_get_max_threads());
+			const int nPostings = static_cast<int>(vpPostings.size());
+#pragma omp parallel
 			{
-				if (pKF == *lit)
+				std::vector<int>& vnMyWords = vnThreadWords[omp_get_thread_num()];
+				vnMyWords.assign(nSlots, 0);
+#pragma omp for schedule(dynamic, 16)
+				for (int p = 0; p < nPostings; ++p)
 				{
-					lKFs.erase(lit);
-					break;
+					const std::vector<int>& vSlots = *vpPostings[p];
+					for (size_t i = 0, iend = vSlots.size(); i < iend; ++i)
+						vnMyWords[vSlots[i]]++;
 				}
 			}
+			for (size_t t = 0; t < vnThreadWords.size(); ++t)
+				for (size_t slot = 0; slot < vnThreadWords[t].size(); ++slot)
+					vnWords[slot] += vnThreadWords[t][slot];
+			for (size_t slot = 0; slot < nSlots; ++slot)
+				if (vnWords[slot] > 0 && vpSlotKFs[slot])
+					vnSharingSlots.push_back(static_cast<int>(slot));
+			return;
+		}
+
+		for (size_t p = 0; p < vpPostings.size(); ++p)
+		{
+			const std::vector<int>& vSlots = *vpPostings[p];
+			for (size_t i = 0, iend = vSlots.size(); i < iend; ++i)
+			{
+				const int slot = vSlots[i];
+				if (!vpSlotKFs[slot])
+					continue;
+				if (vnWords[slot] == 0)
+					vnSharingSlots.push_back(slot);
+				vnWords[slot]++;
+			}
 		}
 	}
 
-	void cMultiKeyFrameDatabase::clear()
+	void cMultiKeyFrameDatabase::ScoreKeyFrames(const DBoW2::BowVector& bowVec,
+		const std::vector<cMultiKeyFrame*>& vpSlotKFs,
+		const std::vector<int>& vnSlots,
+		std::vector<double>& vScores)
 	{
-		mvInvertedFile.clear();
-		mvInvertedFile.resize(mpVoc->size());
+		// the BoW scoring dominates the query, the vocabulary is only read
+		const int nSlots = static_cast<int>(vnSlots.size());
+#pragma omp parallel for schedule(dynamic, 8) if (nSlots > 64)
+		for (int i = 0; i < nSlots; ++i)
+			vScores[vnSlots[i]] = mpVoc->score(bowVec, vpSlotKFs[vnSlots[i]]->mBowVec);
 	}
 
 	// the whole BoW for MF will be used to compare
@@ -85,76 +204,61 @@ namespace MultiColSLAM
 		// TODO what's connected keyframes?? very similar to covisibility
 		// same as single-camera
 		set<cMultiKeyFrame*> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
-		list<cMultiKeyFrame*> lKFsSharingWords;
 
 		// Step1: get bow word sharing keyframes for multi-camera
 		// same as single-camera
 		// Search all keyframes that share a word with current keyframes
 		// Discard keyframes connected to the query keyframe
-		{
-			std::unique_lock<std::mutex> lock(mMutex);
-
-			for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end();
-				vit != vend; ++vit)
-			{
-				list<cMultiKeyFrame*> &lKFs = mvInvertedFile[vit->first];
-
-				for (list<cMultiKeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-					lit != lend; ++lit)
-				{
-					cMultiKeyFrame* pKFi = *lit;
-					if (pKFi->mnLoopQuery != pKF->mnId)
-					{
-						pKFi->mnLoopWords = 0;
-						if (!spConnectedKeyFrames.count(pKFi))
-						{
-							pKFi->mnLoopQuery = pKF->mnId;
-							lKFsSharingWords.push_back(pKFi);
-						}
-					}
-					pKFi->mnLoopWords++;
-				}
-			}
-		}
-
-		if (lKFsSharingWords.empty())
+		// All scoring state is local to this query, indexed by the database slot
+		std::vector<cMultiKeyFrame*> vpSlotKFs;
+		std::vector<int> vnLoopWords;
+		std::vector<int> vnSharingSlots;
+		GetKeyFramesSharingWords(pKF->mBowVec, vpSlotKFs, vnLoopWords, vnSharingSlots);
+
+		std::vector<int> vnKFsSharingWords;
+		vnKFsSharingWords.reserve(vnSharingSlots.size());
+		for (size_t i = 0; i < vnSharingSlots.size(); ++i)
+			if (!spConnectedKeyFrames.count(vpSlotKFs[vnSharingSlots[i]]))
+				vnKFsSharingWords.push_back(vnSharingSlots[i]);
+
+		if (vnKFsSharingWords.empty())
 			return vector<cMultiKeyFrame*>();
 
+		// connected keyframes are no candidates and do not accumulate scores
+		std::vector<bool> vbLoopCandidate(vpSlotKFs.size(), false);
+		for (size_t i = 0; i < vnKFsSharingWords.size(); ++i)
+			vbLoopCandidate[vnKFsSharingWords[i]] = true;
+		std::vector<double> vLoopScores(vpSlotKFs.size(), 0.0);
+
 		list<pair<double, cMultiKeyFrame*> > lScoreAndMatch;
 
 		// Step2: compare with those that beyond certain threshold and get max common words
 		// same as single-camera
 		// Only compare against those multikeyframes that share enough words
 		int maxCommonWords = 0;
-		for (list<cMultiKeyFrame*>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-			lit != lend; ++lit)
+		for (size_t i = 0; i < vnKFsSharingWords.size(); ++i)
 		{
-			if ((*lit)->mnLoopWords > maxCommonWords)
-				maxCommonWords = (*lit)->mnLoopWords;
+			if (vnLoopWords[vnKFsSharingWords[i]] > maxCommonWords)
+				maxCommonWords = vnLoopWords[vnKFsSharingWords[i]];
 		}
 
 		int minCommonWords = static_cast<int>((double)maxCommonWords * 0.8);
 
-		int nscores = 0;
-
 		// Step3: use similarity score and common words to filter again
 		// same as single-camera
 		// Compute similarity score. Retain the matches whose score is higher than minScore
-		for (list<cMultiKeyFrame*>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-			lit != lend; lit++)
-		{
-			cMultiKeyFrame* pKFi = *lit;
+		std::vector<int> vnScoredSlots;
+		for (size_t i = 0; i < vnKFsSharingWords.size(); ++i)
+			if (vnLoopWords[vnKFsSharingWords[i]] > minCommonWords)
+				vnScoredSlots.push_back(vnKFsSharingWords[i]);
 
-			if (pKFi->mnLoopWords > minCommonWords)
-			{
-				nscores++;
+		ScoreKeyFrames(pKF->mBowVec, vpSlotKFs, vnScoredSlots, vLoopScores);
 
-				double si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-
-				pKFi->mLoopScore = si;
-				if (si >= minScore)
-					lScoreAndMatch.push_back(make_pair(si, pKFi));
-			}
+		for (size_t i = 0; i < vnScoredSlots.size(); ++i)
+		{
+			const double si = vLoopScores[vnScoredSlots[i]];
+			if (si >= minScore)
+				lScoreAndMatch.push_back(make_pair(si, vpSlotKFs[vnScoredSlots[i]]));
 		}
 
 		if (lScoreAndMatch.empty())
@@ -179,13 +283,18 @@ namespace MultiColSLAM
 				vit != vend; ++vit)
 			{
 				cMultiKeyFrame* pKF2 = *vit;
-				if (pKF2->mnLoopQuery == pKF->mnId && pKF2->mnLoopWords > minCommonWords)
+				// the slot is only valid if it still maps to this keyframe in our copy
+				const int slot2 = pKF2->mnDatabaseSlot;
+				if (slot2 < 0 || slot2 >= static_cast<int>(vpSlotKFs.size()) ||
+					vpSlotKFs[slot2] != pKF2)
+					continue;
+				if (vbLoopCandidate[slot2] && vnLoopWords[slot2] > minCommonWords)
 				{
-					accScore += pKF2->mLoopScore;
-					if (pKF2->mLoopScore > bestScore)
+					accScore += vLoopScores[slot2];
+					if (vLoopScores[slot2] > bestScore)
 					{
 						pBestKF = pKF2;
-						bestScore = pKF2->mLoopScore;
+						bestScore = vLoopScores[slot2];
 					}
 				}
 			}
@@ -222,63 +331,38 @@ namespace MultiColSLAM
 
 	std::vector<cMultiKeyFrame*> cMultiKeyFrameDatabase::DetectRelocalisationCandidates(cMultiFrame *F)
 	{
-		std::list<cMultiKeyFrame*> lKFsSharingWords;
-
 		// Search all keyframes that share a word with current frame
-		{
-			std::unique_lock<std::mutex> lock(mMutex);
-
-			for (DBoW2::BowVector::const_iterator vit = F->mBowVec.begin(), vend = F->mBowVec.end();
-				vit != vend; ++vit)
-			{
-				std::list<cMultiKeyFrame*> &lKFs = mvInvertedFile[vit->first];
+		std::vector<cMultiKeyFrame*> vpSlotKFs;
+		std::vector<int> vnRelocWords;
+		std::vector<int> vnKFsSharingWords;
+		GetKeyFramesSharingWords(F->mBowVec, vpSlotKFs, vnRelocWords, vnKFsSharingWords);
 
-				for (std::list<cMultiKeyFrame*>::iterator lit = lKFs.begin(), lend = lKFs.end();
-					lit != lend; lit++)
-				{
-					cMultiKeyFrame* pKFi = *lit;
-					if (pKFi->mnRelocQuery != F->mnId)
-					{
-						pKFi->mnRelocWords = 0;
-						pKFi->mnRelocQuery = F->mnId;
-						lKFsSharingWords.push_back(pKFi);
-					}
-					pKFi->mnRelocWords++;
-				}
-			}
-		}
-		if (lKFsSharingWords.empty())
+		if (vnKFsSharingWords.empty())
 			return vector<cMultiKeyFrame*>();
 
 		// Only compare against those keyframes that share enough words
 		int maxCommonWords = 0;
-		for (list<cMultiKeyFrame*>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-			lit != lend; lit++)
+		for (size_t i = 0; i < vnKFsSharingWords.size(); ++i)
 		{
-			if ((*lit)->mnRelocWords > maxCommonWords)
-				maxCommonWords = (*lit)->mnRelocWords;
+			if (vnRelocWords[vnKFsSharingWords[i]] > maxCommonWords)
+				maxCommonWords = vnRelocWords[vnKFsSharingWords[i]];
 		}
 
 		int minCommonWords = static_cast<int>(maxCommonWords * 0.8);
 
 		list<pair<double, cMultiKeyFrame*> > lScoreAndMatch;
-
-		int nscores = 0;
+		std::vector<double> vRelocScores(vpSlotKFs.size(), 0.0);
 
 		// Compute similarity score.
-		for (list<cMultiKeyFrame*>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-			lit != lend; lit++)
-		{
-			cMultiKeyFrame* pKFi = *lit;
+		std::vector<int> vnScoredSlots;
+		for (size_t i = 0; i < vnKFsSharingWords.size(); ++i)
+			if (vnRelocWords[vnKFsSharingWords[i]] > minCommonWords)
+				vnScoredSlots.push_back(vnKFsSharingWords[i]);
 
-			if (pKFi->mnRelocWords > minCommonWords)
-			{
-				nscores++;
-				double si = mpVoc->score(F->mBowVec, pKFi->mBowVec);
-				pKFi->mRelocScore = si;
-				lScoreAndMatch.push_back(make_pair(si, pKFi));
-			}
-		}
+		ScoreKeyFrames(F->mBowVec, vpSlotKFs, vnScoredSlots, vRelocScores);
+
+		for (size_t i = 0; i < vnScoredSlots.size(); ++i)
+			lScoreAndMatch.push_back(make_pair(vRelocScores[vnScoredSlots[i]], vpSlotKFs[vnScoredSlots[i]]));
 
 		if (lScoreAndMatch.empty())
 			return vector<cMultiKeyFrame*>();
@@ -300,14 +384,19 @@ namespace MultiColSLAM
 				vit != vend; vit++)
 			{
 				cMultiKeyFrame* pKF2 = *vit;
-				if (pKF2->mnRelocQuery != F->mnId)
+				const int slot2 = pKF2->mnDatabaseSlot;
+				if (slot2 < 0 || slot2 >= static_cast<int>(vpSlotKFs.size()) ||
+					vpSlotKFs[slot2] != pKF2)
+					continue;
+				// unscored neighbours add nothing
+				if (vnRelocWords[slot2] <= minCommonWords)
 					continue;
 
-				accScore += pKF2->mRelocScore;
-				if (pKF2->mRelocScore > bestScore)
+				accScore += vRelocScores[slot2];
+				if (vRelocScores[slot2] > bestScore)
 				{
 					pBestKF = pKF2;
-					bestScore = pKF2->mRelocScore;
+					bestScore = vRelocScores[slot2];
 				}
 
 			}
@@ -1404,7 +1404,7 @@ int cORBmatcher::Fuse(cMultiKeyFrame *pKF,
 						++nFused;
 					}
 				}
-				else
+				else if (!pMP->isBad()) // bad after a fusion, must not be linked again
 				{
 					pMP->AddObservation(pKF, bestIdxs[f]);
 					pKF->AddMapPoint(pMP, bestIdxs[f]);
@@ -1554,7 +1554,7 @@ int cORBmatcher::Fuse(cMultiKeyFrame* pKF,
 						++nFused;
 					}
 				}
-				else
+				else if (!pMP->isBad()) // bad after a fusion, must not be linked again
 				{
 					pMP->AddObservation(pKF, bestIdxs[f]);
 					pKF->AddMapPoint(pMP, bestIdxs[f]);
@@ -1706,7 +1706,7 @@ int cORBmatcher::Fuse(cMultiKeyFrame *pKF, cv::Matx44d Scw,
 						++nFused;
 					}
 				}
-				else
+				else if (!pMP->isBad()) // bad after a fusion, must not be linked again
 				{
 					pMP->AddObservation(pKF, bestIdxs[f]);
 					pKF->AddMapPoint(pMP, bestIdxs[f]);
@@ -1987,9 +1987,52 @@ int cORBmatcher::SearchBySim3(cMultiKeyFrame *pKF1,
     return nFound;
 }
 
+double cORBmatcher::ProjectionSigma(const cCamModelGeneral_& camModel,
+	const cv::Matx44d& Mt_inv,
+	const cv::Matx33d& Rc_t,
+	const cv::Matx44d& MtMc_inv,
+	const cv::Vec3d& x3Dw,
+	const cv::Matx66d& poseCov)
+{
+	const cv::Vec4d X(x3Dw(0), x3Dw(1), x3Dw(2), 1.0);
+	// the pose changes by (w, t) in the MCS frame:
+	// the point in the MCS frame moves by [Xb]x * w - t
+	const cv::Vec4d Xb = Mt_inv * X;
+	const double Jv[] = {
+		0.0, -Xb(2), Xb(1), -1.0, 0.0, 0.0,
+		Xb(2), 0.0, -Xb(0), 0.0, -1.0, 0.0,
+		-Xb(1), Xb(0), 0.0, 0.0, 0.0, -1.0 };
+	const cv::Matx<double, 3, 6> J(Jv);
+	const cv::Matx33d covCam = Rc_t * (J * poseCov * J.t()) * Rc_t.t();
+
+	// Jacobian of the camera model by forward differences
+	const cv::Vec4d Xc = MtMc_inv * X;
+	double u0 = 0.0, v0 = 0.0;
+	camModel.WorldToImg(Xc(0), Xc(1), Xc(2), u0, v0);
+	const double h = 1e-6 * cv::norm(cv::Vec3d(Xc(0), Xc(1), Xc(2))) + 1e-12;
+	cv::Matx23d Jp;
+	for (int k = 0; k < 3; ++k)
+	{
+		cv::Vec3d Xh(Xc(0), Xc(1), Xc(2));
+		Xh(k) += h;
+		double u = 0.0, v = 0.0;
+		camModel.WorldToImg(Xh(0), Xh(1), Xh(2), u, v);
+		Jp(0, k) = (u - u0) / h;
+		Jp(1, k) = (v - v0) / h;
+	}
+	const cv::Matx22d covPix = Jp * covCam * Jp.t();
+
+	// largest eigenvalue of the 2x2 covariance
+	const double halfTrace = 0.5 * (covPix(0, 0) + covPix(1, 1));
+	const double det = covPix(0, 0) * covPix(1, 1) - covPix(0, 1) * covPix(1, 0);
+	const double maxEig = halfTrace + sqrt(std::max(0.0, halfTrace * halfTrace - det));
+	return sqrt(std::max(0.0, maxEig));
+}
+
 // take this as an example
 int cORBmatcher::SearchByProjection(cMultiFrame &CurrentFrame,
-	const cMultiFrame &LastFrame, double th)
+	const cMultiFrame &LastFrame, double th,
+	const cv::Matx66d* pPoseCov, double minTh)
 {
     int nmatches = 0;
 
@@ -2001,6 +2044,25 @@ int cORBmatcher::SearchByProjection(cMultiFrame &CurrentFrame,
 
 	cMultiCamSys_& camSys = CurrentFrame.camSystem;
 
+	// transformations for the propagation of the pose covariance
+	cv::Matx44d Mt_inv;
+	vector<cv::Matx33d> vRc_t;
+	vector<cv::Matx44d> vMtMc_inv;
+	vector<cCamModelGeneral_> vCamModels;
+	if (pPoseCov)
+	{
+		Mt_inv = cConverter::invMat(camSys.Get_M_t());
+		for (int c = 0; c < camSys.GetNrCams(); ++c)
+		{
+			const cv::Matx44d Mc = camSys.Get_M_c(c);
+			vRc_t.push_back(cv::Matx33d(Mc(0, 0), Mc(1, 0), Mc(2, 0),
+				Mc(0, 1), Mc(1, 1), Mc(2, 1),
+				Mc(0, 2), Mc(1, 2), Mc(2, 2)));
+			vMtMc_inv.push_back(camSys.Get_MtMc_inv(c));
+			vCamModels.push_back(camSys.GetCamModelObj(c));
+		}
+	}
+
 	// essentially, the overall pipeline is similar to single-camera slam
 	// it doesn't specify different cameras, instead it only adds camera finding during looping all landmarks
 	for (size_t i = 0, iend = LastFrame.mvpMapPoints.size(); i < iend; ++i)
@@ -2030,6 +2092,14 @@ int cORBmatcher::SearchByProjection(cMultiFrame &CurrentFrame,
 
 			// Search in a window. Size depends on scale
 			double radius = th*CurrentFrame.mvScaleFactors[nPredictedOctave];
+			// and on the uncertainty of the pose
+			if (pPoseCov)
+			{
+				const double sigma = ProjectionSigma(vCamModels[cam], Mt_inv,
+					vRc_t[cam], vMtMc_inv[cam], x3Dw, *pPoseCov);
+				radius = std::min(radius,
+					3.0*sigma + minTh*CurrentFrame.mvScaleFactors[nPredictedOctave]);
+			}
 
 			vector<size_t> vIndices2 =
 				CurrentFrame.GetFeaturesInArea(cam, uv(0), uv(1), radius,
@@ -48,11 +48,35 @@
 
 #include "g2o_MultiCol_vertices_edges.h"
 #include "g2o_MultiCol_sim3_expmap.h"
+#include "cParallelBlockSolver.h"
+#include "cBundleAdjusterMC.h"
+#include "cLocalBAGraph.h"
+#include "cIncrementalBA.h"
+
+#include <algorithm>
+#include <chrono>
 
 namespace MultiColSLAM
 {
 	double cOptimizer::stdRecon = 2.0;
 	double cOptimizer::stdPose = 2.0;
+	int cOptimizer::nBAThreads = 1;
+	bool cOptimizer::nativeLocalBA = false;
+	bool cOptimizer::checkNativeLocalBA = false;
+	bool cOptimizer::mixedPrecisionBA = false;
+	bool cOptimizer::checkMixedPrecisionBA = false;
+	bool cOptimizer::reuseLocalBAGraph = false;
+	bool cOptimizer::incrementalBackend = false;
+	double cOptimizer::relinearizeThreshold = 1e-3;
+	int cOptimizer::incrementalIterations = 3;
+	bool cOptimizer::globalBAAfterLoop = false;
+	int cOptimizer::globalBAIterations = 15;
+	int cOptimizer::poseGraphSolver = cOptimizer::POSE_GRAPH_EIGEN;
+	bool cOptimizer::checkPoseGraphSolvers = false;
+	bool cOptimizer::adaptiveOutliers = false;
+	double cOptimizer::outlierGainThreshold = 1e-6;
+	cOptimizer::sScheduleStats cOptimizer::poseOptimizationStats;
+	cOptimizer::sScheduleStats cOptimizer::localBAStats;
 
 	// TODO no transform_optimizer for sim3 optimization?
 
@@ -61,8 +85,8 @@ namespace MultiColSLAM
 		int nIterations,
 		bool *pbStopFlag)
 	{
-		std::vector<cMultiKeyFrame*> vpKFs = pMap->GetAllKeyFrames();
-		std::vector<cMapPoint*> vpMP = pMap->GetAllMapPoints();
+		const cSnapshot<cMultiKeyFrame> vpKFs = pMap->GetKeyFrameSnapshot();
+		const cSnapshot<cMapPoint> vpMP = pMap->GetMapPointSnapshot();
 		BundleAdjustment(vpKFs, vpMP,
 			poseOnly,
 			nIterations, pbStopFlag);
@@ -70,13 +94,12 @@ namespace MultiColSLAM
 
 	// it's nice to reuse the implementation! actually it is only used for globalBA...
 	// the overall pipeline seems to be the same as poseoptimization
-	void cOptimizer::BundleAdjustment(const std::vector<cMultiKeyFrame*> &vpKFs,
-		const std::vector<cMapPoint*> &vpMP,
+	void cOptimizer::BundleAdjustment(const cSnapshot<cMultiKeyFrame> &vpKFs,
+		const cSnapshot<cMapPoint> &vpMP,
 		bool poseOnly,
 		int nIterations,
 		bool *pbStopFlag)
 	{
-		int redundancy = 1;
 		g2o::SparseOptimizer optimizer;
 		g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
 
@@ -98,10 +121,48 @@ namespace MultiColSLAM
 		if (pbStopFlag)
 			optimizer.setForceStopFlag(pbStopFlag);
 
-		//long unsigned int maxKFid = 0;
+		std::unordered_map<long unsigned int, int> mapPointId_to_cont_g2oId;
+		SetupBundleAdjustment(optimizer, vpKFs, vpMP, poseOnly, mapPointId_to_cont_g2oId);
+
+		// Optimize!
+		optimizer.initializeOptimization();
+		optimizer.optimize(15);
+
+		// Recover optimized data
+		//Keyframes
+		for (size_t i = 0, iend = vpKFs.size(); i < iend; ++i)
+		{
+			cMultiKeyFrame* pKF = vpKFs[i];
+			VertexMt_cayley* vSE3 = static_cast<VertexMt_cayley*>(optimizer.vertex(pKF->mnId));
+			if (!vSE3)
+				continue;
+			cv::Matx61d mincayley = vSE3->estimate();
+			pKF->SetPose(cayley2hom(mincayley));
+			//pKF->SetPose(rodrigues2hom(mincayley));
+		}
 
+		//Points
+		for (size_t i = 0, iend = vpMP.size(); i < iend; ++i)
+		{
+			cMapPoint* pMP = vpMP[i];
+			std::unordered_map<long unsigned int, int>::const_iterator it =
+				mapPointId_to_cont_g2oId.find(pMP->mnId);
+			if (it == mapPointId_to_cont_g2oId.end())
+				continue;
+			VertexPointXYZ* vPoint = static_cast<VertexPointXYZ*>(optimizer.vertex(it->second));
+			pMP->SetWorldPos(vPoint->estimate());
+			pMP->UpdateNormalAndDepth();
+		}
+
+	}
+
+	void cOptimizer::SetupBundleAdjustment(g2o::SparseOptimizer& optimizer,
+		const cSnapshot<cMultiKeyFrame> &vpKFs,
+		const cSnapshot<cMapPoint> &vpMP,
+		const bool& poseOnly,
+		std::unordered_map<long unsigned int, int>& mapPointId_to_cont_g2oId)
+	{
 		unsigned long currVertexIdx = 0;
-		unsigned long maxKF = 0;
 		unsigned long maxKFid = 0;
 		unsigned long maxMcid = 0;
 		unsigned long maxIOid = 0;
@@ -116,20 +177,13 @@ namespace MultiColSLAM
 			VertexMt_cayley * vSE3 = new VertexMt_cayley();
 			vSE3->setEstimate(hom2cayley(pKF->GetPose()));
 			vSE3->setId(pKF->mnId);
-			if (pKF->mnId == 0)
-				vSE3->setFixed(true);
-			else
-			{
-				vSE3->setFixed(false);
-				redundancy -= vSE3->dimension();
-			}
+			vSE3->setFixed(pKF->mnId == 0);
 			optimizer.addVertex(vSE3);
 			if (pKF->mnId > maxKFid)
-				maxKF = pKF->mnId;
-
+				maxKFid = pKF->mnId;
 		}
-		// because the keyframe ids are not continuous
-		currVertexIdx = maxKF + 1;
+		// because the keyframe ids are not continuous (and the snapshot is not sorted)
+		currVertexIdx = maxKFid + 1;
 
 		const int nrCams = vpKFs[0]->camSystem.GetNrCams();
 		// SET Mc VERTICES 
@@ -160,7 +214,6 @@ namespace MultiColSLAM
 
 		const double thHuber = sqrt(5.991);
 
-		std::unordered_map<int, int> mapPointId_to_cont_g2oId;
 		// SET MAP POINT VERTICES
 		for (size_t i = 0, iend = vpMP.size(); i < iend; ++i)
 		{
@@ -176,8 +229,6 @@ namespace MultiColSLAM
 			mapPointId_to_cont_g2oId[pMP->mnId] = currVertexIdx;
 
 			vPoint->setFixed(poseOnly); // add flag to determine if only optimize pose or not
-			if (!poseOnly)
-				redundancy -= vPoint->dimension();
 			vPoint->setMarginalized(true);
 			optimizer.addVertex(vPoint);
 
@@ -192,7 +243,8 @@ namespace MultiColSLAM
 			{
 				cMultiKeyFrame* pKF = mit->first;
 
-				if (pKF->isBad())
+				// keyframes that were added after the snapshot have no vertex
+				if (pKF->isBad() || pKF->mnId > maxKFid || !optimizer.vertex(pKF->mnId))
 					continue;
 				// get all image points for this keyframe corresponding to one map point
 				std::vector<size_t>& imagePoints = mit->second;
@@ -202,12 +254,10 @@ namespace MultiColSLAM
 					int cam = pKF->keypoint_to_cam.find(obsIdx)->second;
 
 					cv::KeyPoint kpUn = pKF->GetKeyPoint(obsIdx);
-					cv::Vec2d obs(kpUn.pt.x, kpUn.pt.y);
 
 					EdgeProjectXYZ2MCS* e = new EdgeProjectXYZ2MCS();
 					e->setMeasurement(Eigen::Vector2d(kpUn.pt.x, kpUn.pt.y));
 					e->setInformation(Eigen::Matrix2d::Identity());
-					redundancy += 2;
 					// Mt
 					e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(
 						optimizer.vertex(pKF->mnId)));
@@ -232,38 +282,14 @@ namespace MultiColSLAM
 			}
 			currVertexIdx++;
 		}
-
-		// Optimize!
-		optimizer.initializeOptimization();
-		optimizer.optimize(15);
-
-		// Recover optimized data
-		//Keyframes
-		for (size_t i = 0, iend = vpKFs.size(); i < iend; ++i)
-		{
-			cMultiKeyFrame* pKF = vpKFs[i];
-			VertexMt_cayley* vSE3 = static_cast<VertexMt_cayley*>(optimizer.vertex(pKF->mnId));
-			cv::Matx61d mincayley = vSE3->estimate();
-			pKF->SetPose(cayley2hom(mincayley));
-			//pKF->SetPose(rodrigues2hom(mincayley));
-		}
-
-		//Points
-		for (size_t i = 0, iend = vpMP.size(); i < iend; ++i)
-		{
-			cMapPoint* pMP = vpMP[i];
-			int contId = mapPointId_to_cont_g2oId.find(pMP->mnId)->second;
-			VertexPointXYZ* vPoint = static_cast<VertexPointXYZ*>(optimizer.vertex(contId));
-			pMP->SetWorldPos(vPoint->estimate());
-			pMP->UpdateNormalAndDepth();
-		}
-
 	}
 
 	// almost understand poseoptimization
-	int cOptimizer::PoseOptimization(cMultiFrame *pFrame,
+	// the graph based version, PoseOptimizationGN in cOptimizerPoseOnly.cpp solves the same problem
+	int cOptimizer::PoseOptimizationG2O(cMultiFrame *pFrame,
 		double& inliers,
-		const double& huberMultiplier)
+		const double& huberMultiplier,
+		const int& nIterations)
 	{
 #ifdef VERBOSE
 		cout << " ---OPTIMIZING POSE--- " << endl;
@@ -429,12 +455,66 @@ namespace MultiColSLAM
 			}
 		}
 
+		double thHuber2 = thHuber*thHuber;
+		int nBad = 0;
+		if (adaptiveOutliers)
+		{
+			// same schedule as PoseOptimizationGN, outliers are moved to level 1
+			// and come back if they fit again after a round
+			terminateAction->setGainThreshold(outlierGainThreshold);
+			optimizer.initializeOptimization(0);
+			const int nBudget = 2 * nIterations;
+			int nDone = 0, nRounds = 0, nReincluded = 0;
+			while (nDone < nBudget)
+			{
+				// the terminate action sets the flag on convergence but never resets it
+				if (optimizer.forceStopFlag())
+					*optimizer.forceStopFlag() = false;
+				const int nMax = std::min(nIterations, nBudget - nDone);
+				const int result = optimizer.optimize(nMax);
+				if (result <= 0)
+					break;
+				nDone += result;
+				++nRounds;
+
+				int nChanged = 0;
+				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+				{
+					EdgeProjectXYZ2MCS* e = vpEdges[i];
+					e->computeError();
+					const bool bInlier = e->chi2() <= thHuber2;
+					if (bInlier == (e->level() == 0))
+						continue;
+					if (bInlier)
+						++nReincluded;
+					e->setLevel(bInlier ? 0 : 1);
+					++nChanged;
+				}
+				// a round that ran out of iterations has not converged yet
+				if (nChanged == 0 && result < nMax)
+					break;
+				optimizer.initializeOptimization(0);
+			}
+			poseOptimizationStats.Add(nDone, nBudget, nRounds, nReincluded);
+
+			for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+			{
+				const bool bOutlier = vpEdges[i]->level() != 0;
+				pFrame->mvbOutlier[vnIndexEdge[i]] = bOutlier;
+				if (bOutlier)
+					++nBad;
+			}
+			VertexMt_cayley* vMt = static_cast<VertexMt_cayley*>(optimizer.vertex(0));
+			pFrame->camSystem.Set_M_t_from_min(vMt->estimate());
+			inliers = nInitialCorrespondences > 0 ?
+				static_cast<double>(nBad) / static_cast<double>(nInitialCorrespondences) : 0.0;
+			return nInitialCorrespondences - nBad;
+		}
+
 		// Optimize!
 		optimizer.initializeOptimization();
-		optimizer.optimize(10);
+		optimizer.optimize(nIterations);
 
-		double thHuber2 = thHuber*thHuber;
-		int nBad = 0;
 		// set outlier measurements
 		for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
 		{
@@ -454,7 +534,7 @@ namespace MultiColSLAM
 		}
 		// Optimize!
 		optimizer.initializeOptimization(0);
-		int result = optimizer.optimize(10);
+		int result = optimizer.optimize(nIterations);
 
 		// set outlier measurements
 		for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
@@ -485,23 +565,12 @@ namespace MultiColSLAM
 		return nInitialCorrespondences - nBad;
 	}
 
-	// the overall pipeline is also similar, except more complicated part for finding local keyframes and landmarks
-	std::list<cMultiKeyFrame*> cOptimizer::LocalBundleAdjustment(
-		cMultiKeyFrame *pKF,
-		cMap* pMap,
-		int nrIters,
-		bool getCovMats,
-		bool* pbStopFlag)
+	bool cOptimizer::CollectLocalWindow(cMultiKeyFrame* pKF,
+		std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+		std::list<cMapPoint*>& lLocalMapPoints,
+		std::list<cMultiKeyFrame*>& lFixedCameras)
 	{
-#ifdef VERBOSE
-		cout << " ---OPTIMIZING LOCAL MAP--- " << endl;
-#endif
-		// the finding of local keyframes and landmarks are almost the same as the one in orbslam
-		int numUnknowns = 0;
-		int numObservationsTotal = 0;
 		// Local KeyFrames: First Breath Search from Current Keyframe
-		std::list<cMultiKeyFrame*> lLocalKeyFrames;
-
 		lLocalKeyFrames.push_back(pKF);
 		pKF->mnBALocalForKF = pKF->mnId;
 
@@ -516,9 +585,8 @@ namespace MultiColSLAM
 		}
 
 		if (lLocalKeyFrames.size() <= 1)
-			return std::list<cMultiKeyFrame*>();
+			return false;
 		// Local MapPoints seen in Local KeyFrames
-		std::list<cMapPoint*> lLocalMapPoints;
 		for (std::list<cMultiKeyFrame*>::iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
 			lit != lend; lit++)
 		{
@@ -536,9 +604,10 @@ namespace MultiColSLAM
 						}
 			}
 		}
+		// walk through the point slabs in memory order
+		lLocalMapPoints.sort(cMapPoint::AllocationOrder);
 
 		// Fixed Keyframes. Keyframes that see Local MapPoints but that are not Local Keyframes
-		std::list<cMultiKeyFrame*> lFixedCameras;
 		for (std::list<cMapPoint*>::iterator lit = lLocalMapPoints.begin(),
 			lend = lLocalMapPoints.end(); lit != lend; lit++)
 		{
@@ -556,31 +625,97 @@ namespace MultiColSLAM
 				}
 			}
 		}
+		lFixedCameras.sort(cMultiKeyFrame::AllocationOrder);
+		return true;
+	}
 
-		// Setup optimizer
-		g2o::SparseOptimizer optimizer;
-		g2o::BlockSolver_6_3::LinearSolverType * linearSolver;
-
-		linearSolver = new g2o::LinearSolverEigen<g2o::BlockSolver_6_3::PoseMatrixType>();
-
-		g2o::BlockSolver_6_3 * solver_ptr = new g2o::BlockSolver_6_3(linearSolver);
-		g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
-		optimizer.setAlgorithm(solver);
-		optimizer.setVerbose(false);
+	// the overall pipeline is also similar, except more complicated part for finding local keyframes and landmarks
+	std::list<cMultiKeyFrame*> cOptimizer::LocalBundleAdjustment(
+		cMultiKeyFrame *pKF,
+		cMap* pMap,
+		int nrIters,
+		bool getCovMats,
+		bool* pbStopFlag,
+		cCacheMissCounter* pSetupCounter,
+		cLocalBAGraph* pGraph,
+		int* pnAllocations)
+	{
+#ifdef VERBOSE
+		cout << " ---OPTIMIZING LOCAL MAP--- " << endl;
+#endif
+		if (pSetupCounter)
+			pSetupCounter->Start();
+		// the finding of local keyframes and landmarks are almost the same as the one in orbslam
+		int numUnknowns = 0;
+		int numObservationsTotal = 0;
+		std::list<cMultiKeyFrame*> lLocalKeyFrames;
+		std::list<cMapPoint*> lLocalMapPoints;
+		std::list<cMultiKeyFrame*> lFixedCameras;
+		if (!CollectLocalWindow(pKF, lLocalKeyFrames, lLocalMapPoints, lFixedCameras))
+		{
+			if (pSetupCounter)
+				pSetupCounter->Stop();
+			return std::list<cMultiKeyFrame*>();
+		}
 
-		//solver_ptr->setSchur(false);
-		//optimizer.setComputeBatchStatistics(true);
-		if (pbStopFlag)
-			optimizer.setForceStopFlag(pbStopFlag);
+		// Mc and the interior orientation are fixed below, so the graph is not needed
+		if (nativeLocalBA && !checkNativeLocalBA)
+		{
+			if (pSetupCounter)
+				pSetupCounter->Stop();
+			if (!checkMixedPrecisionBA)
+			{
+				LocalBundleAdjustmentNative(pKF, lLocalKeyFrames, lFixedCameras, lLocalMapPoints,
+					pbStopFlag, true, mixedPrecisionBA);
+			}
+			else
+			{
+				// the other precision first, the applied run erases the outliers
+				std::vector<cv::Matx61d> vCheckPoses, vPoses;
+				int nCheckInliers = 0, nInliers = 0;
+				const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+				const double checkChi2 = LocalBundleAdjustmentNative(pKF, lLocalKeyFrames, lFixedCameras,
+					lLocalMapPoints, pbStopFlag, false, !mixedPrecisionBA, &nCheckInliers, &vCheckPoses);
+				const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+				const double chi2 = LocalBundleAdjustmentNative(pKF, lLocalKeyFrames, lFixedCameras,
+					lLocalMapPoints, pbStopFlag, true, mixedPrecisionBA, &nInliers, &vPoses);
+				const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+				double maxDiff = 0.0;
+				for (size_t i = 0; i < vPoses.size() && i < vCheckPoses.size(); ++i)
+					maxDiff = std::max(maxDiff, cv::norm(cv::Vec3d(vPoses[i](3) - vCheckPoses[i](3),
+					vPoses[i](4) - vCheckPoses[i](4), vPoses[i](5) - vCheckPoses[i](5))));
+				std::cout << "local BA precision check: " << (mixedPrecisionBA ? "mixed " : "double ") <<
+					std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1000.0 <<
+					" ms, " << (mixedPrecisionBA ? "double " : "mixed ") <<
+					std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000.0 <<
+					" ms, cost " << chi2 << "/" << checkChi2 <<
+					", inliers " << nInliers << "/" << nCheckInliers <<
+					", max position difference " << maxDiff << std::endl;
+			}
+			if (pnAllocations)
+				*pnAllocations = 0;
+			return lLocalKeyFrames;
+		}
 
-		// set terminate criteria for bundle adjustment and pose estimation for performance
-		g2o::SparseOptimizerTerminateAction* terminateAction = 0;
-		terminateAction = new g2o::SparseOptimizerTerminateAction;
-		terminateAction->setGainThreshold(1e-6);
-		terminateAction->setMaxIterations(15);
-		optimizer.addPostIterationAction(terminateAction);
+		// run the native version on the same problem without touching the map,
+		// the result of the g2o graph is kept
+		std::chrono::steady_clock::time_point tCheck0, tCheck1;
+		double nativeChi2 = 0.0;
+		int nativeInliers = 0;
+		if (checkNativeLocalBA)
+		{
+			tCheck0 = std::chrono::steady_clock::now();
+			nativeChi2 = LocalBundleAdjustmentNative(pKF, lLocalKeyFrames, lFixedCameras,
+				lLocalMapPoints, pbStopFlag, false, mixedPrecisionBA, &nativeInliers);
+			tCheck1 = std::chrono::steady_clock::now();
+		}
 
-		long unsigned int maxKFid = 0;
+		// Setup optimizer, the graph of the last local BA is updated if there is one
+		cLocalBAGraph tmpGraph;
+		if (!pGraph)
+			pGraph = &tmpGraph;
+		pGraph->BeginUpdate(pKF->camSystem, pbStopFlag);
+		g2o::SparseOptimizer& optimizer = pGraph->Optimizer();
 
 		// SET LOCAL KEYFRAME VERTICES
 		bool oneFixed = false;
@@ -588,14 +723,8 @@ namespace MultiColSLAM
 			lit != lend; lit++)
 		{
 			cMultiKeyFrame* pKFi = *lit;
-			VertexMt_cayley* vSE3 = new VertexMt_cayley();
-			vSE3->setEstimate(pKFi->camSystem.Get_M_t_min());
-			vSE3->setId(pKFi->mnId);
 			oneFixed = pKFi->mnId == 0;
-			vSE3->setFixed(oneFixed);
-			optimizer.addVertex(vSE3);
-			if (pKFi->mnId > maxKFid)
-				maxKFid = pKFi->mnId;
+			VertexMt_cayley* vSE3 = pGraph->AddPose(pKFi, oneFixed);
 			if (!vSE3->fixed())
 				numUnknowns += 6;
 		}
@@ -607,61 +736,16 @@ namespace MultiColSLAM
 		{
 			std::list<cMultiKeyFrame*>::iterator lit = lLocalKeyFrames.begin();
 			cMultiKeyFrame* pKFi = *lit;
-			optimizer.vertex(pKFi->mnId)->setFixed(true);
+			pGraph->PoseVertex(pKFi)->setFixed(true);
 			numUnknowns -= 6;
 		}
 
 		// SET FIXED KEYFRAME VERTICES
 		for (std::list<cMultiKeyFrame*>::iterator lit = lFixedCameras.begin(), lend = lFixedCameras.end();
 			lit != lend; lit++)
-		{
-			cMultiKeyFrame* pKFi = *lit;
-			VertexMt_cayley* vSE3 = new VertexMt_cayley();
-			vSE3->setEstimate(pKFi->camSystem.Get_M_t_min());
-			vSE3->setId(pKFi->mnId);
-			vSE3->setFixed(true);
-			optimizer.addVertex(vSE3);
-			if (pKFi->mnId > maxKFid)
-				maxKFid = pKFi->mnId;
-		}
-		unsigned long currVertexIdx = maxKFid + 1;
-
-		unsigned long maxMcid = 0;
-		unsigned long maxIOid = 0;
-
-		// because the keyframe ids are not continous
-		const int nrCams = pKF->camSystem.GetNrCams();
-		// SET Mc VERTICES
-		// there are always fixed number of Mt vertexs in opitmization
-		for (int c = 0; c < nrCams; ++c)
-		{
-			VertexMc_cayley* vMc = new VertexMc_cayley();
-			vMc->setEstimate(pKF->camSystem.Get_M_c_min(c));
-			vMc->setId(currVertexIdx);
-			vMc->setFixed(true);
-			optimizer.addVertex(vMc);
+			pGraph->AddPose(*lit, true);
 
-			if (!vMc->fixed())
-				numUnknowns += 6;
-			currVertexIdx++;
-		}
-		maxMcid = currVertexIdx;
-
-		// SET IO VERTICES
-		// same for IO as well
-		for (int c = 0; c < nrCams; ++c)
-		{
-			VertexOmniCameraParameters* vIO =
-				new VertexOmniCameraParameters(pKF->camSystem.GetCamModelObj(c));
-			vIO->setEstimate(pKF->camSystem.GetCamModelObj(c).toVector());
-			vIO->setId(currVertexIdx);
-			vIO->setFixed(true);
-			optimizer.addVertex(vIO);
-			if (!vIO->fixed())
-				numUnknowns += 6;
-			currVertexIdx++;
-		}
-		maxIOid = currVertexIdx; // to be able to recover the corresponding vertex
+		// Mc and IO vertices are fixed, they are part of the graph
 
 		// SET MAP POINT VERTICES
 		const int nExpectedSize = (lLocalKeyFrames.size() + lFixedCameras.size())*lLocalMapPoints.size();
@@ -672,19 +756,13 @@ namespace MultiColSLAM
 		std::vector<cMultiKeyFrame*> vpEdgeKF;
 		vpEdgeKF.reserve(nExpectedSize);
 
-		std::vector<double> vSigmas2;
-		vSigmas2.reserve(nExpectedSize);
-
 		std::vector<cMapPoint*> vpMapPointEdge;
 		vpMapPointEdge.reserve(nExpectedSize);
 
-		std::vector<size_t> obsIndices;
 		std::vector<size_t> cont_obsIndices;
 		const double thHuber = 1.345 * stdRecon;
 
-		std::unordered_map<int, int> mapPointId_to_cont_g2oId;
-		std::unordered_map<EdgeProjectXYZ2MCS*, int> mapMapPt_to_edge;
-		//cout << "Size local map points: " << lLocalMapPoints.size() << endl;
+		std::unordered_map<long unsigned int, VertexPointXYZ*> mapPointId_to_vertex;
 		for (std::list<cMapPoint*>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end();
 			lit != lend; lit++)
 		{
@@ -692,37 +770,23 @@ namespace MultiColSLAM
 			if (pMP->isBad())
 				continue;
 
-			int nrObs = pMP->TotalNrObservations();
-			//cout << pMP->GetMeanPtError() << endl;;
-
-			VertexPointXYZ* vPoint = new VertexPointXYZ();
-			vPoint->setEstimate(pMP->GetWorldPos());
-			// for later save the map from the continous to map point idxs
-			mapPointId_to_cont_g2oId[pMP->mnId] = currVertexIdx;
-			vPoint->setId(currVertexIdx);
-
-			vPoint->setFixed(false); // for local ba, landmarks are not fixed 
-			vPoint->setMarginalized(true);
-
-			if (!vPoint->fixed())
-				numUnknowns += 3;
-
-			optimizer.addVertex(vPoint);
+			VertexPointXYZ* vPoint = pGraph->AddPoint(pMP);
+			// for later save the map from the map point to the vertex
+			mapPointId_to_vertex[pMP->mnId] = vPoint;
+			numUnknowns += 3;
 
 			std::map<cMultiKeyFrame*, std::vector<size_t> > observations = pMP->GetObservations();
 
 			// SET EDGES
-			// TODO understand about this process?
 			// in contrast to ORB_SLAM an additional layer of measurements has to be introduced
 			// we also need to search for the camera in which the observation was made
-			int obsCnt = 0;
 			for (std::map<cMultiKeyFrame*, std::vector<size_t> >::iterator mit =
 				observations.begin(), mend = observations.end();
 				mit != mend; ++mit)
 			{
-				cMultiKeyFrame* pKF = mit->first;
+				cMultiKeyFrame* pKFi = mit->first;
 
-				if (pKF->isBad())
+				if (pKFi->isBad() || !pGraph->PoseVertex(pKFi))
 					continue;
 				// get all image points for this keyframe corresponding to one map point
 				std::vector<size_t>& imagePoints = mit->second;
@@ -730,45 +794,25 @@ namespace MultiColSLAM
 				// add all observations
 				for (auto obsIdx : imagePoints)
 				{
-					int cam = pKF->keypoint_to_cam.find(obsIdx)->second;
-
-					cv::KeyPoint kpUn = pKF->GetKeyPoint(obsIdx);
-					cv::Vec2d obs(kpUn.pt.x, kpUn.pt.y);
+					int cam = pKFi->keypoint_to_cam.find(obsIdx)->second;
+					cv::KeyPoint kpUn = pKFi->GetKeyPoint(obsIdx);
 
-					EdgeProjectXYZ2MCS* e = new EdgeProjectXYZ2MCS();
-					e->setMeasurement(Eigen::Vector2d(kpUn.pt.x, kpUn.pt.y));
-					const double invSigma2 = pKF->GetInvSigma2(kpUn.octave);
-					e->setInformation(Eigen::Matrix2d::Identity() * invSigma2);
-					// Mt
-					e->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(
-						optimizer.vertex(pKF->mnId)));
-					// 3D point
-					e->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(
-						optimizer.vertex(currVertexIdx)));
-					// Mc
-					e->setVertex(2, dynamic_cast<g2o::OptimizableGraph::Vertex*>(
-						optimizer.vertex(maxMcid - nrCams + cam)));
-					// IO
-					e->setVertex(3, dynamic_cast<g2o::OptimizableGraph::Vertex*>(
-						optimizer.vertex(maxIOid - nrCams + cam)));
-					g2o::RobustKernelHuber* rk = new g2o::RobustKernelHuber;
-					rk->setDelta(thHuber);
-					e->setRobustKernel(rk);
+					EdgeProjectXYZ2MCS* e = pGraph->AddObservation(pKFi, pMP, obsIdx, cam, kpUn, thHuber);
 
 					++numObservationsTotal;
 
-					optimizer.addEdge(e);
 					vpEdges.push_back(e);
-					vpEdgeKF.push_back(pKF);
+					vpEdgeKF.push_back(pKFi);
 					vpMapPointEdge.push_back(pMP);
-					obsIndices.push_back(obsCnt);
 					cont_obsIndices.push_back(obsIdx);
-					mapMapPt_to_edge[e]++;
-					++obsCnt;
 				}
 			}
-			++currVertexIdx;
 		}
+		pGraph->EndUpdate();
+		if (pnAllocations)
+			*pnAllocations = pGraph->NrAllocations();
+		if (pSetupCounter)
+			pSetupCounter->Stop();
 
 		if (pbStopFlag)
 			if (*pbStopFlag)
@@ -776,56 +820,125 @@ namespace MultiColSLAM
 
 		size_t redundancy = 2 * numObservationsTotal - numUnknowns;
 
-		///////////////////////////
-		// optimize the first time
-		///////////////////////////
 		optimizer.initializeOptimization(0);
-		int result = optimizer.optimize(10);
-		if (result == g2o::OptimizationAlgorithm::Fail)
-		{
-			cout << "Optimization failed" << endl;
-			return lLocalKeyFrames;
-		}
-
+		const double huberK2 = thHuber*thHuber;
 		// not stopped yet? go on
 		bool bDoMore = true;
-		if (pbStopFlag)
-			if (*pbStopFlag)
-				bDoMore = false;
-
-		if (bDoMore)
+		if (adaptiveOutliers)
 		{
-			double huberK2 = thHuber*thHuber;
-			// Check inlier observations
-			for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+			// rounds until the inlier set is stable, the edges of the outliers stay
+			// in the graph on level 1 and come back if they fit again after a round,
+			// the map is only changed at the end
+			const int nBudget = 25;
+			int nDone = 0, nRounds = 0, nReincluded = 0;
+			while (nDone < nBudget)
 			{
-				EdgeProjectXYZ2MCS* e = vpEdges[i];
-				cMapPoint* pMP = vpMapPointEdge[i];
+				const int nMax = std::min(nRounds == 0 ? 10 : 15, nBudget - nDone);
+				const int result = pGraph->Optimize(nMax, outlierGainThreshold);
+				if (result < 0)
+				{
+					cout << "Optimization failed" << endl;
+					return lLocalKeyFrames;
+				}
+				nDone += result;
+				++nRounds;
+				if (pbStopFlag && *pbStopFlag)
+				{
+					bDoMore = false;
+					break;
+				}
 
-				if (pMP->isBad())
-					continue;
+				int nChanged = 0;
+				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+				{
+					EdgeProjectXYZ2MCS* e = vpEdges[i];
+					if (vpMapPointEdge[i]->isBad())
+						continue;
+					// the errors of the active edges might be the ones of a rejected step
+					e->computeError();
+					const bool bInlier = e->chi2() <= huberK2;
+					if (bInlier == (e->level() == 0))
+						continue;
+					if (bInlier)
+						++nReincluded;
+					e->setLevel(bInlier ? 0 : 1);
+					++nChanged;
+				}
+				// a round that ran out of iterations has not converged yet
+				if (nChanged == 0 && result < nMax)
+					break;
+				optimizer.initializeOptimization(0);
+			}
+			// an aborted run would count the iterations it did not do as saved
+			if (!pbStopFlag || !*pbStopFlag)
+				localBAStats.Add(nDone, nBudget, nRounds, nReincluded);
 
-				if (e->chi2() > huberK2)
+			if (bDoMore)
+			{
+				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
 				{
+					EdgeProjectXYZ2MCS* e = vpEdges[i];
+					cMapPoint* pMP = vpMapPointEdge[i];
+					if (e->level() == 0 || pMP->isBad())
+						continue;
+					--numObservationsTotal;
 					cMultiKeyFrame* pKFi = vpEdgeKF[i];
 					pKFi->EraseMapPointMatch(cont_obsIndices[i]);
 					pMP->EraseObservation(pKFi, cont_obsIndices[i]);
-					e->setLevel(1);
 					vpEdges[i] = NULL;
 					vpMapPointEdge[i] = NULL;
 				}
 			}
-
-			optimizer.initializeOptimization(0);
-			result = optimizer.optimize(15);
-
-			if (result == g2o::OptimizationAlgorithm::Fail)
+		}
+		else
+		{
+			///////////////////////////
+			// optimize the first time
+			///////////////////////////
+			int result = pGraph->Optimize(10, 1e-6);
+			if (result < 0)
 			{
 				cout << "Optimization failed" << endl;
 				return lLocalKeyFrames;
 			}
-			else
+			int nDone = result;
+
+			if (pbStopFlag)
+				if (*pbStopFlag)
+					bDoMore = false;
+
+			if (bDoMore)
 			{
+				// Check inlier observations
+				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+				{
+					EdgeProjectXYZ2MCS* e = vpEdges[i];
+					cMapPoint* pMP = vpMapPointEdge[i];
+
+					if (pMP->isBad())
+						continue;
+
+					if (e->chi2() > huberK2)
+					{
+						cMultiKeyFrame* pKFi = vpEdgeKF[i];
+						pKFi->EraseMapPointMatch(cont_obsIndices[i]);
+						pMP->EraseObservation(pKFi, cont_obsIndices[i]);
+						e->setLevel(1);
+						vpEdges[i] = NULL;
+						vpMapPointEdge[i] = NULL;
+					}
+				}
+
+				optimizer.initializeOptimization(0);
+				result = pGraph->Optimize(15, 1e-6);
+
+				if (result < 0)
+				{
+					cout << "Optimization failed" << endl;
+					return lLocalKeyFrames;
+				}
+				nDone += result;
+
 				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
 				{
 
@@ -848,63 +961,301 @@ namespace MultiColSLAM
 						e->setLevel(1);
 					}
 				}
+			}
+			if (!pbStopFlag || !*pbStopFlag)
+				localBAStats.Add(nDone, 25, 2, 0);
+		}
 
-				optimizer.initializeOptimization(0);
+		if (bDoMore)
+		{
+			optimizer.initializeOptimization(0);
 
-				// don't allow map change
-				//std::unique_lock<std::mutex> lock(pMap->mMutexMapUpdate);
+			// don't allow map change
+			//std::unique_lock<std::mutex> lock(pMap->mMutexMapUpdate);
+
+			std::vector<std::pair<int, int> > blockIndices;
+			bool havingMasks = false;
+			for (std::list<cMultiKeyFrame*>::iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+				lit != lend; ++lit)
+			{
+				cMultiKeyFrame* pKFl = *lit;
+				if (pKFl->isBad())
+					continue;
+
+				VertexMt_cayley* vSE3 = pGraph->PoseVertex(pKFl);
+				pKFl->camSystem.Set_M_t_from_min(vSE3->estimate());
+				if (vSE3->hessianIndex() >= 0)
+					blockIndices.push_back(make_pair(vSE3->hessianIndex(), vSE3->hessianIndex()));
+			}
 
-				std::vector<std::pair<int, int> > blockIndices;
-				bool havingMasks = false;
-				for (std::list<cMultiKeyFrame*>::iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
-					lit != lend; ++lit)
+			double s0 = 1.0;
+			//if (getCovMats)
+			//	if (redundancy > 0 && !isnan(optimizer.chi2()) && !isinf(optimizer.chi2()))
+			//		s0 = sqrt(optimizer.chi2() / (double)redundancy);
+
+			std::vector<cMapPoint*> ptsForCov;
+			std::vector<VertexPointXYZ*> vPoints;
+
+			for (std::list<cMapPoint*>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end();
+				lit != lend; ++lit)
+			{
+				cMapPoint* pMP = *lit;
+				if (pMP->isBad())
+					continue;
+
+				std::unordered_map<long unsigned int, VertexPointXYZ*>::iterator vit =
+					mapPointId_to_vertex.find(pMP->mnId);
+				if (vit == mapPointId_to_vertex.end())
+					continue;
+				if (pMP->TotalNrObservations() <= 1)
+					continue;
+
+				VertexPointXYZ* vPoint = vit->second;
+				// count number of edges
+
+				if (vPoint->edges().size() >= 2 && !vPoint->fixed())
 				{
-					cMultiKeyFrame* pKFl = *lit;
-					if (pKFl->isBad())
-						continue;
+					pMP->SetWorldPos(vPoint->estimate());
+					pMP->UpdateNormalAndDepth();
+					pMP->ComputeDistinctiveDescriptors();
+				}
 
-					VertexMt_cayley* vSE3 = static_cast<VertexMt_cayley*>(optimizer.vertex(pKFl->mnId));
-					pKFl->camSystem.Set_M_t_from_min(vSE3->estimate());
-					if (vSE3->hessianIndex() >= 0)
-						blockIndices.push_back(make_pair(vSE3->hessianIndex(), vSE3->hessianIndex()));
+			}
+
+			if (checkNativeLocalBA)
+			{
+				optimizer.computeActiveErrors();
+				int nInliers = 0;
+				for (size_t i = 0, iend = vpEdges.size(); i < iend; ++i)
+					if (vpEdges[i])
+						++nInliers;
+				std::cout << "local BA check: g2o " <<
+					std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - tCheck1).count() / 1000.0 <<
+					" ms, native " <<
+					std::chrono::duration_cast<std::chrono::microseconds>(tCheck1 - tCheck0).count() / 1000.0 <<
+					" ms, cost " << optimizer.activeRobustChi2() << "/" << nativeChi2 <<
+					", inliers " << nInliers << "/" << nativeInliers << std::endl;
+			}
+		}
+		return lLocalKeyFrames;
+	}
+
+	double cOptimizer::LocalBundleAdjustmentNative(cMultiKeyFrame* pKF,
+		const std::list<cMultiKeyFrame*>& lLocalKeyFrames,
+		const std::list<cMultiKeyFrame*>& lFixedCameras,
+		const std::list<cMapPoint*>& lLocalMapPoints,
+		bool* pbStopFlag,
+		const bool& bApply,
+		const bool& bMixedPrecision,
+		int* pnInliers,
+		std::vector<cv::Matx61d>* pvPoses)
+	{
+		const double thHuber = 1.345 * stdRecon;
+		const double thHuber2 = thHuber * thHuber;
+
+		cBundleAdjusterMC ba;
+		ba.SetCameraSystem(pKF->camSystem);
+		ba.SetHuberDelta(thHuber);
+		ba.SetNrThreads(nBAThreads);
+		ba.SetMixedPrecision(bMixedPrecision);
+
+		// same gauge as the graph version: keyframe 0 is fixed, and if there
+		// are no fixed keyframes the first local one (unless the last one is keyframe 0)
+		const bool bFixFirst = lFixedCameras.empty() && lLocalKeyFrames.back()->mnId != 0;
+		std::unordered_map<cMultiKeyFrame*, int> mapKF_to_pose;
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+			lit != lend; ++lit)
+		{
+			cMultiKeyFrame* pKFi = *lit;
+			const bool fixed = pKFi->mnId == 0 || (bFixFirst && lit == lLocalKeyFrames.begin());
+			mapKF_to_pose[pKFi] = ba.AddPose(pKFi->camSystem.Get_M_t_min(), fixed);
+		}
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lFixedCameras.begin(), lend = lFixedCameras.end();
+			lit != lend; ++lit)
+			mapKF_to_pose[*lit] = ba.AddPose((*lit)->camSystem.Get_M_t_min(), true);
+
+		std::vector<cMultiKeyFrame*> vpEdgeKF;
+		std::vector<cMapPoint*> vpMapPointEdge;
+		std::vector<size_t> cont_obsIndices;
+		std::vector<cMapPoint*> vpPoints;
+		std::vector<int> vPointObs;
+		for (std::list<cMapPoint*>::const_iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end();
+			lit != lend; ++lit)
+		{
+			cMapPoint* pMP = *lit;
+			if (pMP->isBad())
+				continue;
+			const int pointIdx = ba.AddPoint(pMP->GetWorldPos());
+			vpPoints.push_back(pMP);
+			vPointObs.push_back(0);
+
+			std::map<cMultiKeyFrame*, std::vector<size_t> > observations = pMP->GetObservations();
+			for (std::map<cMultiKeyFrame*, std::vector<size_t> >::iterator mit =
+				observations.begin(), mend = observations.end(); mit != mend; ++mit)
+			{
+				cMultiKeyFrame* pKFi = mit->first;
+				if (pKFi->isBad())
+					continue;
+				std::unordered_map<cMultiKeyFrame*, int>::const_iterator pit = mapKF_to_pose.find(pKFi);
+				if (pit == mapKF_to_pose.end())
+					continue;
+				for (auto obsIdx : mit->second)
+				{
+					const int cam = pKFi->keypoint_to_cam.find(obsIdx)->second;
+					const cv::KeyPoint kpUn = pKFi->GetKeyPoint(obsIdx);
+					ba.AddObservation(pit->second, pointIdx, cam, kpUn.pt.x, kpUn.pt.y,
+						pKFi->GetInvSigma2(kpUn.octave));
+					vpEdgeKF.push_back(pKFi);
+					vpMapPointEdge.push_back(pMP);
+					cont_obsIndices.push_back(obsIdx);
+					++vPointObs.back();
 				}
+			}
+		}
 
-				double s0 = 1.0;
-				//if (getCovMats)
-				//	if (redundancy > 0 && !isnan(optimizer.chi2()) && !isinf(optimizer.chi2()))
-				//		s0 = sqrt(optimizer.chi2() / (double)redundancy);
+		if (pbStopFlag && *pbStopFlag)
+			return 0.0;
 
-				std::vector<cMapPoint*> ptsForCov;
-				std::vector<VertexPointXYZ*> vPoints;
+		if (adaptiveOutliers)
+		{
+			// rounds until the inlier set is stable, the outliers are only
+			// erased at the end, so they can come back in the meantime
+			ba.SetGainThreshold(outlierGainThreshold);
+			const int nBudget = 25;
+			int nDone = 0, nRounds = 0, nReincluded = 0;
+			while (nDone < nBudget)
+			{
+				const int nMax = std::min(nRounds == 0 ? 10 : 15, nBudget - nDone);
+				const int nIt = ba.Optimize(nMax, pbStopFlag);
+				if (nIt < 0)
+				{
+					cout << "Optimization failed" << endl;
+					return 0.0;
+				}
+				if (pbStopFlag && *pbStopFlag)
+					return 0.0;
+				nDone += nIt;
+				++nRounds;
 
-				for (std::list<cMapPoint*>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end();
-					lit != lend; ++lit)
+				int nChanged = 0;
+				for (int i = 0, iend = ba.NrObservations(); i < iend; ++i)
 				{
-					cMapPoint* pMP = *lit;
-					if (pMP->isBad())
+					if (vpMapPointEdge[i]->isBad())
 						continue;
-
-					int cnt = mapPointId_to_cont_g2oId.count(pMP->mnId);
-					if (cnt == 0)
+					const bool bInlier = ba.Chi2(i) <= thHuber2;
+					if (bInlier == ba.IsActive(i))
 						continue;
-					if (pMP->TotalNrObservations() <= 1)
+					if (bInlier)
+						++nReincluded;
+					ba.SetActive(i, bInlier);
+					++nChanged;
+				}
+				// a round that ran out of iterations has not converged yet
+				if (nChanged == 0 && nIt < nMax)
+					break;
+			}
+			if (bApply)
+			{
+				localBAStats.Add(nDone, nBudget, nRounds, nReincluded);
+				for (int i = 0, iend = ba.NrObservations(); i < iend; ++i)
+				{
+					cMapPoint* pMP = vpMapPointEdge[i];
+					if (ba.IsActive(i) || pMP->isBad())
 						continue;
-					int contId = mapPointId_to_cont_g2oId.find(pMP->mnId)->second;
-
-					VertexPointXYZ* vPoint = static_cast<VertexPointXYZ*>(optimizer.vertex(contId));
-					// count number of edges
+					vpEdgeKF[i]->EraseMapPointMatch(cont_obsIndices[i]);
+					pMP->EraseObservation(vpEdgeKF[i], cont_obsIndices[i]);
+				}
+			}
+		}
+		else
+		{
+			// optimize, remove the outliers, optimize again and remove the outliers
+			int nDone = 0;
+			for (int round = 0; round < 2; ++round)
+			{
+				const int nIt = ba.Optimize(round == 0 ? 10 : 15, pbStopFlag);
+				if (nIt < 0)
+				{
+					cout << "Optimization failed" << endl;
+					return 0.0;
+				}
+				if (pbStopFlag && *pbStopFlag)
+					return 0.0;
+				nDone += nIt;
 
-					if (vPoint->edges().size() >= 2 && !vPoint->fixed())
+				for (int i = 0, iend = ba.NrObservations(); i < iend; ++i)
+				{
+					cMapPoint* pMP = vpMapPointEdge[i];
+					if (!ba.IsActive(i) || pMP->isBad())
+						continue;
+					if (ba.Chi2(i) > thHuber2)
 					{
-						pMP->SetWorldPos(vPoint->estimate());
-						pMP->UpdateNormalAndDepth();
-						pMP->ComputeDistinctiveDescriptors();
+						if (bApply)
+						{
+							vpEdgeKF[i]->EraseMapPointMatch(cont_obsIndices[i]);
+							pMP->EraseObservation(vpEdgeKF[i], cont_obsIndices[i]);
+						}
+						ba.SetActive(i, false);
 					}
-
 				}
 			}
+			if (bApply)
+				localBAStats.Add(nDone, 25, 2, 0);
 		}
-		return lLocalKeyFrames;
+
+		if (pnInliers)
+		{
+			*pnInliers = 0;
+			for (int i = 0, iend = ba.NrObservations(); i < iend; ++i)
+				if (ba.IsActive(i))
+					++(*pnInliers);
+		}
+		if (pvPoses)
+		{
+			pvPoses->clear();
+			for (std::list<cMultiKeyFrame*>::const_iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+				lit != lend; ++lit)
+				pvPoses->push_back(ba.GetPose(mapKF_to_pose.find(*lit)->second));
+		}
+		if (!bApply)
+			return ba.RobustChi2();
+
+		for (std::list<cMultiKeyFrame*>::const_iterator lit = lLocalKeyFrames.begin(), lend = lLocalKeyFrames.end();
+			lit != lend; ++lit)
+		{
+			cMultiKeyFrame* pKFl = *lit;
+			if (pKFl->isBad())
+				continue;
+			pKFl->camSystem.Set_M_t_from_min(ba.GetPose(mapKF_to_pose[pKFl]));
+		}
+		for (size_t j = 0; j < vpPoints.size(); ++j)
+		{
+			cMapPoint* pMP = vpPoints[j];
+			if (pMP->isBad() || pMP->TotalNrObservations() <= 1 || vPointObs[j] < 2)
+				continue;
+			pMP->SetWorldPos(ba.GetPoint(static_cast<int>(j)));
+			pMP->UpdateNormalAndDepth();
+			pMP->ComputeDistinctiveDescriptors();
+		}
+		return ba.RobustChi2();
+	}
+
+	int cOptimizer::IncrementalBundleAdjustment(cMultiKeyFrame* pKF,
+		cIncrementalBA* pBackend,
+		bool* pbStopFlag)
+	{
+		std::list<cMultiKeyFrame*> lLocalKeyFrames;
+		std::list<cMapPoint*> lLocalMapPoints;
+		std::list<cMultiKeyFrame*> lFixedCameras;
+		if (!CollectLocalWindow(pKF, lLocalKeyFrames, lLocalMapPoints, lFixedCameras))
+			return 0;
+
+		pBackend->SetHuberDelta(1.345 * stdRecon);
+		pBackend->SetRelinearizeThreshold(relinearizeThreshold);
+		pBackend->SetMaxIterations(incrementalIterations);
+		pBackend->SetNrThreads(nBAThreads);
+		return pBackend->Update(pKF, lLocalKeyFrames, lFixedCameras, lLocalMapPoints, pbStopFlag);
 	}
 
 }
\ No newline at end of file
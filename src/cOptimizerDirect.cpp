@@ -0,0 +1,303 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cOptimizer.h"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+
+#include "g2o_MultiCol_vertices_edges.h"
+
+// Sparse direct alignment of a multi camera frame to the previous frame.
+// The map points tracked in the previous frame are projected into both frames,
+// a small pattern of pixels around each projection is compared photometrically
+// on the coarse levels of the extractor pyramids. The pose is refined with
+// Gauss-Newton from the top to the bottom level, Jacobians of the projection
+// from mcsJacsChain as in the pose only solver.
+namespace MultiColSLAM
+{
+	namespace
+	{
+		// pattern around each point, in pixels of the current level
+		const int kPatternSize = 8;
+		const int kPatternU[kPatternSize] = { 0, 0, -1, 1, -2, 2, -1, 0 };
+		const int kPatternV[kPatternSize] = { 0, -2, -1, -1, 0, 0, 1, 2 };
+
+		struct DirectPoint
+		{
+			Eigen::Vector3d pt3;
+			int cam;
+			double uLast;	// projection into the previous frame at level 0
+			double vLast;
+			double ref[kPatternSize];
+			bool valid;
+		};
+
+		struct DirectBuffers
+		{
+			std::vector<DirectPoint> vPoints;
+			std::vector<cCamModelGeneral_> vCamModels;
+			std::vector<Eigen::Matrix<double, 12 + 5, 1>,
+				Eigen::aligned_allocator<Eigen::Matrix<double, 12 + 5, 1> > > vCamModelData;
+			std::vector<sCayleyTransform> vMcTransforms;
+			sCayleyTransform MtTransform;
+		};
+
+		inline bool InImage(const cv::Mat& img, const double& u, const double& v)
+		{
+			// one pixel more for the gradients
+			return u >= 1.0 && v >= 1.0 && u < img.cols - 2.0 && v < img.rows - 2.0;
+		}
+
+		inline double Bilinear(const cv::Mat& img, const double& u, const double& v)
+		{
+			const int x = static_cast<int>(u);
+			const int y = static_cast<int>(v);
+			const double ax = u - x;
+			const double ay = v - y;
+			const uchar* r0 = img.ptr<uchar>(y) + x;
+			const uchar* r1 = img.ptr<uchar>(y + 1) + x;
+			return (1.0 - ay) * ((1.0 - ax) * r0[0] + ax * r0[1]) +
+				ay * ((1.0 - ax) * r1[0] + ax * r1[1]);
+		}
+
+		inline double HuberWeight(const double& r, const double& delta)
+		{
+			const double a = std::fabs(r);
+			return a <= delta ? 1.0 : delta / a;
+		}
+
+		inline double HuberRho(const double& r, const double& delta)
+		{
+			const double a = std::fabs(r);
+			return a <= delta ? r * r : 2.0 * delta * a - delta * delta;
+		}
+
+		void UpdateCameraPoses(DirectBuffers& buf, const cv::Matx61d& Mt)
+		{
+			buf.MtTransform.Set(Mt);
+		}
+
+		inline bool Project(const DirectBuffers& buf, const DirectPoint& pt,
+			double& u, double& v)
+		{
+			const Eigen::Vector3d Xc = mcsToCamera(pt.pt3, buf.MtTransform, buf.vMcTransforms[pt.cam]);
+			buf.vCamModels[pt.cam].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+			return std::isfinite(u) && std::isfinite(v);
+		}
+
+		// photometric cost at the current camera poses, returns the number of residuals
+		int DirectCost(const DirectBuffers& buf,
+			const std::vector<std::vector<cv::Mat> >& pyramids,
+			const int& level, const double& scale, const double& delta,
+			double& cost)
+		{
+			cost = 0.0;
+			int nRes = 0;
+			for (size_t i = 0; i < buf.vPoints.size(); ++i)
+			{
+				const DirectPoint& pt = buf.vPoints[i];
+				if (!pt.valid)
+					continue;
+				double u, v;
+				if (!Project(buf, pt, u, v))
+					continue;
+				const cv::Mat& img = pyramids[pt.cam][level];
+				u /= scale;
+				v /= scale;
+				if (!InImage(img, u - 2.0, v - 2.0) || !InImage(img, u + 2.0, v + 2.0))
+					continue;
+				for (int k = 0; k < kPatternSize; ++k)
+				{
+					const double r = Bilinear(img, u + kPatternU[k], v + kPatternV[k]) - pt.ref[k];
+					cost += HuberRho(r, delta);
+					++nRes;
+				}
+			}
+			return nRes;
+		}
+	}
+
+	int cOptimizer::PoseAlignmentDirect(cMultiFrame* pFrame,
+		const cMultiFrame& lastFrame,
+		const int& topLevel,
+		const int& bottomLevel,
+		const int& nIterations)
+	{
+		static thread_local DirectBuffers buf;
+
+		const int nrCams = pFrame->camSystem.GetNrCams();
+		if (static_cast<int>(pFrame->mvImagePyramids.size()) < nrCams ||
+			static_cast<int>(lastFrame.mvImagePyramids.size()) < nrCams)
+			return 0;
+		int nLevels = pFrame->mnScaleLevels;
+		for (int c = 0; c < nrCams; ++c)
+			nLevels = std::min(nLevels, static_cast<int>(std::min(
+				pFrame->mvImagePyramids[c].size(), lastFrame.mvImagePyramids[c].size())));
+		const int top = std::min(topLevel, nLevels - 1);
+		const int bottom = std::max(0, std::min(bottomLevel, top));
+		if (top < 0)
+			return 0;
+
+		buf.vCamModels.resize(nrCams);
+		buf.vCamModelData.resize(nrCams);
+		buf.vMcTransforms.resize(nrCams);
+		for (int c = 0; c < nrCams; ++c)
+		{
+			buf.vCamModels[c] = pFrame->camSystem.GetCamModelObj(c);
+			buf.vCamModelData[c] = buf.vCamModels[c].toVector();
+			buf.vMcTransforms[c].Set(pFrame->camSystem.Get_M_c_min(c));
+		}
+
+		// projections into the previous frame, the reference of the patches
+		cMultiCamSys_ lastCamSystem = lastFrame.camSystem;
+		buf.vPoints.clear();
+		buf.vPoints.reserve(lastFrame.mvpMapPoints.size());
+		for (size_t i = 0; i < lastFrame.mvpMapPoints.size(); ++i)
+		{
+			cMapPoint* pMP = lastFrame.mvpMapPoints[i];
+			if (!pMP || lastFrame.mvbOutlier[i] || pMP->isBad())
+				continue;
+			DirectPoint pt;
+			const cv::Vec3d X = pMP->GetWorldPos();
+			pt.pt3 = Eigen::Vector3d(X(0), X(1), X(2));
+			pt.cam = lastFrame.keypoint_to_cam.find(i)->second;
+			cv::Vec4d pt4(X(0), X(1), X(2), 1.0);
+			cv::Vec2d uv(0.0, 0.0);
+			lastCamSystem.WorldToCamHom_fast(pt.cam, pt4, uv);
+			if (!buf.vCamModels[pt.cam].isPointInMirrorMask(uv(0), uv(1), 0))
+				continue;
+			pt.uLast = uv(0);
+			pt.vLast = uv(1);
+			pt.valid = false;
+			buf.vPoints.push_back(pt);
+		}
+		if (buf.vPoints.size() < 10)
+			return 0;
+
+		const double delta = 10.0; // intensity levels
+		cv::Matx61d Mt = pFrame->GetPoseMin();
+		const cv::Matx61d MtStart = Mt;
+		int nPoints = 0;
+		double lastMeanCost = 0.0;
+
+		Eigen::Matrix<double, 6, 6> H;
+		Eigen::Matrix<double, 6, 1> g;
+		Eigen::Matrix<double, 2, 6> Jproj;
+		for (int level = top; level >= bottom; --level)
+		{
+			const double scale = pFrame->mvScaleFactors[level];
+
+			// reference patches on this level
+			nPoints = 0;
+			for (size_t i = 0; i < buf.vPoints.size(); ++i)
+			{
+				DirectPoint& pt = buf.vPoints[i];
+				const cv::Mat& img = lastFrame.mvImagePyramids[pt.cam][level];
+				const double u = pt.uLast / scale;
+				const double v = pt.vLast / scale;
+				pt.valid = InImage(img, u - 2.0, v - 2.0) && InImage(img, u + 2.0, v + 2.0);
+				if (!pt.valid)
+					continue;
+				for (int k = 0; k < kPatternSize; ++k)
+					pt.ref[k] = Bilinear(img, u + kPatternU[k], v + kPatternV[k]);
+				++nPoints;
+			}
+			if (nPoints < 10)
+				return 0;
+
+			UpdateCameraPoses(buf, Mt);
+			double cost = 0.0;
+			int nRes = DirectCost(buf, pFrame->mvImagePyramids, level, scale, delta, cost);
+			for (int it = 0; it < nIterations && nRes > 0; ++it)
+			{
+				H.setZero();
+				g.setZero();
+				for (size_t i = 0; i < buf.vPoints.size(); ++i)
+				{
+					const DirectPoint& pt = buf.vPoints[i];
+					if (!pt.valid)
+						continue;
+					double u, v;
+					if (!Project(buf, pt, u, v))
+						continue;
+					const cv::Mat& img = pFrame->mvImagePyramids[pt.cam][level];
+					u /= scale;
+					v /= scale;
+					if (!InImage(img, u - 2.0, v - 2.0) || !InImage(img, u + 2.0, v + 2.0))
+						continue;
+
+					// projection Jacobian on this level
+					mcsJacsChain(pt.pt3, buf.MtTransform, buf.vMcTransforms[pt.cam],
+						buf.vCamModelData[pt.cam], NULL, &Jproj, NULL, NULL);
+					Jproj /= scale;
+					for (int k = 0; k < kPatternSize; ++k)
+					{
+						const double pu = u + kPatternU[k];
+						const double pv = v + kPatternV[k];
+						const double r = Bilinear(img, pu, pv) - pt.ref[k];
+						const double gu = 0.5 * (Bilinear(img, pu + 1.0, pv) - Bilinear(img, pu - 1.0, pv));
+						const double gv = 0.5 * (Bilinear(img, pu, pv + 1.0) - Bilinear(img, pu, pv - 1.0));
+						const Eigen::Matrix<double, 1, 6> J = gu * Jproj.row(0) + gv * Jproj.row(1);
+						const double w = HuberWeight(r, delta);
+						H.noalias() += w * J.transpose() * J;
+						g.noalias() += w * r * J.transpose();
+					}
+				}
+
+				// a little damping, the coarse levels can be badly conditioned
+				Eigen::Matrix<double, 6, 6> Hl = H;
+				Hl.diagonal() *= 1.0 + 1e-4;
+				const Eigen::Matrix<double, 6, 1> dx = Hl.ldlt().solve(-g);
+				if (!dx.allFinite())
+					break;
+
+				cv::Matx61d MtNew = Mt;
+				for (int k = 0; k < 6; ++k)
+					MtNew(k, 0) += dx(k);
+				UpdateCameraPoses(buf, MtNew);
+				double newCost = 0.0;
+				const int nNewRes = DirectCost(buf, pFrame->mvImagePyramids, level, scale, delta, newCost);
+				// compare the mean, points can leave the image
+				if (nNewRes == 0 || newCost / nNewRes >= cost / nRes)
+				{
+					UpdateCameraPoses(buf, Mt);
+					break;
+				}
+				Mt = MtNew;
+				cost = newCost;
+				nRes = nNewRes;
+				if (dx.norm() < 1e-6)
+					break;
+			}
+			lastMeanCost = nRes > 0 ? cost / nRes : 0.0;
+		}
+
+		// keep the prediction if the patches do not agree at all
+		if (lastMeanCost > 4.0 * delta * delta)
+		{
+			pFrame->camSystem.Set_M_t_from_min(MtStart);
+			return 0;
+		}
+		pFrame->camSystem.Set_M_t_from_min(Mt);
+		return nPoints;
+	}
+}
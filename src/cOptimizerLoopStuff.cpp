@@ -44,7 +44,13 @@
 
 #include <Eigen/StdVector>
 
+#include <chrono>
+#include <iostream>
+
 #include "cConverter.h"
+#include "cParallelBlockSolver.h"
+#include "cLinearSolverBlockCholesky.h"
+#include "cLinearSolverPCG.h"
 
 #include "g2o_MultiCol_vertices_edges.h"
 #include "g2o_MultiCol_sim3_expmap.h"
@@ -54,13 +60,69 @@ namespace MultiColSLAM
 {
 	double cOptimizer::stdSim = 4.0;
 
+	namespace
+	{
+		// LM for the essential graph with the linear solver
+		// selected by cOptimizer::poseGraphSolver
+		g2o::OptimizationAlgorithm* CreatePoseGraphAlgorithm(const int& solverType)
+		{
+			typedef g2o::BlockSolver_7_3::PoseMatrixType PoseMatrixType;
+			g2o::BlockSolver_7_3::LinearSolverType* linearSolver;
+			if (solverType == cOptimizer::POSE_GRAPH_BLOCK_CHOLESKY)
+				linearSolver = new cLinearSolverBlockCholesky<PoseMatrixType>();
+			else if (solverType == cOptimizer::POSE_GRAPH_PCG)
+				linearSolver = new cLinearSolverPCG<PoseMatrixType>(cOptimizer::nBAThreads);
+			else
+				linearSolver = new g2o::LinearSolverEigen<PoseMatrixType>();
+			// the sim3 edges are linearized on nBAThreads threads
+			g2o::BlockSolver_7_3* solver_ptr =
+				new cParallelBlockSolver<g2o::BlockSolverTraits<7, 3> >(linearSolver, cOptimizer::nBAThreads);
+			g2o::OptimizationAlgorithmLevenberg* solver =
+				new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
+			solver->setUserLambdaInit(1e-6);
+			return solver;
+		}
+
+		// optimizes the graph with every linear solver from the same start
+		// and prints the timings and final costs, the estimates are restored
+		void ComparePoseGraphSolvers(g2o::SparseOptimizer& optimizer, const int& nIterations)
+		{
+			static const char* names[] = { "eigen", "block cholesky", "pcg" };
+			g2o::OptimizationAlgorithm* pSelected = optimizer.solver();
+			std::cout << "essential graph check, " << optimizer.vertices().size() << " vertices, " <<
+				optimizer.edges().size() << " edges:";
+			for (int s = cOptimizer::POSE_GRAPH_EIGEN; s <= cOptimizer::POSE_GRAPH_PCG; ++s)
+			{
+				g2o::OptimizationAlgorithm* pAlgorithm = CreatePoseGraphAlgorithm(s);
+				optimizer.setAlgorithm(pAlgorithm);
+				optimizer.push();
+				// the terminate action leaves the stop flag set when it stopped a run
+				if (optimizer.forceStopFlag())
+					*optimizer.forceStopFlag() = false;
+				const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+				optimizer.optimize(nIterations);
+				const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+				optimizer.computeActiveErrors();
+				std::cout << " " << names[s] << " " <<
+					std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000.0 <<
+					" ms, cost " << optimizer.activeChi2() << ";";
+				optimizer.pop();
+				optimizer.setAlgorithm(pSelected);
+				delete pAlgorithm;
+			}
+			if (optimizer.forceStopFlag())
+				*optimizer.forceStopFlag() = false;
+			std::cout << std::endl;
+		}
+	}
+
 	// TODO will the following two funcs use multi-camera formulation?
 	//      I think so, but I think from here it is not shown
 	//      it's shown inside the edge definition
 	// TODO more in-depth understanding about this part is needed
 	//      it is crucial for us to decide whether it is possible to directly use the g2o formulation
 	//      my personal opionion would be: it should be possible!
-	int cOptimizer::OptimizeSim3(cMultiKeyFrame *pKF1,
+	int cOptimizer::OptimizeSim3G2O(cMultiKeyFrame *pKF1,
 		cMultiKeyFrame *pKF2,
 		vector<cMapPoint *> &vpMatches1,
 		g2o::Sim3 &g2oS12)
@@ -142,7 +204,8 @@ namespace MultiColSLAM
 					vPoint1->setEstimate(cv::Vec3d(rot1CamSys(0), rot1CamSys(1), rot1CamSys(2)));
 					vPoint1->setId(id1);
 					vPoint1->setFixed(true);
-					vPoint1->SetID(i);
+					// projected into keyframe 2, the camera is the one of keypoint i2
+					vPoint1->SetID(i2);
 					optimizer.addVertex(vPoint1);
 
 					VertexPointXYZ* vPoint2 = new VertexPointXYZ();
@@ -151,7 +214,7 @@ namespace MultiColSLAM
 					vPoint2->setEstimate(cv::Vec3d(rot2CamSys(0), rot2CamSys(1), rot2CamSys(2)));
 					vPoint2->setId(id2);
 					vPoint2->setFixed(true);
-					vPoint2->SetID(i2);
+					vPoint2->SetID(i);
 					optimizer.addVertex(vPoint2);
 				}
 				else
@@ -191,7 +254,7 @@ namespace MultiColSLAM
 			e21->setVertex(0, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(id1))); // point
 			e21->setVertex(1, dynamic_cast<g2o::OptimizableGraph::Vertex*>(optimizer.vertex(0))); // Sim3
 			e21->setMeasurement(obs2);
-			double invSigmaSquare2 = pKF2->GetSigma2(kpUn2.octave);
+			double invSigmaSquare2 = pKF2->GetInvSigma2(kpUn2.octave);
 			e21->setInformation(I2x2*invSigmaSquare2);
 
 			g2o::RobustKernelHuber* rk2 = new g2o::RobustKernelHuber;
@@ -263,7 +326,7 @@ namespace MultiColSLAM
 		}
 
 		// Recover optimized Sim3
-		g2o::VertexSim3Expmap* vSim3_recov = static_cast<g2o::VertexSim3Expmap*>(optimizer.vertex(0));
+		VertexSim3Expmap_Multi* vSim3_recov = static_cast<VertexSim3Expmap_Multi*>(optimizer.vertex(0));
 		g2oS12 = vSim3_recov->estimate();
 
 		return nIn;
@@ -280,13 +343,7 @@ namespace MultiColSLAM
 	{
 		g2o::SparseOptimizer optimizer;
 		optimizer.setVerbose(true);
-		g2o::BlockSolver_7_3::LinearSolverType* linearSolver =
-			new g2o::LinearSolverEigen<g2o::BlockSolver_7_3::PoseMatrixType>();
-		g2o::BlockSolver_7_3* solver_ptr = new g2o::BlockSolver_7_3(linearSolver);
-		g2o::OptimizationAlgorithmLevenberg* solver =
-			new g2o::OptimizationAlgorithmLevenberg(solver_ptr);
-		solver->setUserLambdaInit(1e-6);
-		optimizer.setAlgorithm(solver);
+		optimizer.setAlgorithm(CreatePoseGraphAlgorithm(poseGraphSolver));
 
 		g2o::SparseOptimizerTerminateAction* terminateAction = 0;
 		terminateAction = new g2o::SparseOptimizerTerminateAction;
@@ -296,8 +353,8 @@ namespace MultiColSLAM
 
 		// get all keyframes and map points
 		unsigned int nMaxMKFid = pMap->GetMaxKFid();
-		vector<cMultiKeyFrame*> vpMKFs = pMap->GetAllKeyFrames();
-		vector<cMapPoint*> vpMPs = pMap->GetAllMapPoints();
+		const cSnapshot<cMultiKeyFrame> vpMKFs = pMap->GetKeyFrameSnapshot();
+		const cSnapshot<cMapPoint> vpMPs = pMap->GetMapPointSnapshot();
 
 		// create vectors for uncorrected and corrected similarity transformatons
 		// between MKFs
@@ -471,12 +528,14 @@ namespace MultiColSLAM
 
 		// optimize essential graph
 		optimizer.initializeOptimization(0);
+		if (checkPoseGraphSolvers)
+			ComparePoseGraphSolvers(optimizer, 20);
 		optimizer.optimize(20);
 
 		/////////////////////
 		// recover rigid SE3 poses. Sim3: [sR t] -> SE3 [R t/s]
 		/////////////////////
-		for (auto& itMKF : vpMKFs)
+		for (auto itMKF : vpMKFs)
 		{
 			const int MKFid_i = itMKF->mnId;
 			simpleVertexSim3Expmap* VSim3 = static_cast<simpleVertexSim3Expmap*>(optimizer.vertex(MKFid_i));
@@ -493,7 +552,7 @@ namespace MultiColSLAM
 		/////////////////////
 		// correct map points
 		/////////////////////
-		for (auto& itMPs : vpMPs)
+		for (auto itMPs : vpMPs)
 		{
 			if (itMPs->isBad())
 				continue;
@@ -0,0 +1,412 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cOptimizer.h"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "g2o_MultiCol_vertices_edges.h"
+
+// Pose only optimization of a multi camera frame without building a g2o graph.
+// The same model as EdgeProjectXYZ2MCS with fixed points, Mc and interior
+// orientation, solved with the Levenberg-Marquardt scheme of
+// g2o::OptimizationAlgorithmLevenberg on the 6x6 normal equations.
+namespace MultiColSLAM
+{
+	bool cOptimizer::poseOnlyGN = false;
+	bool cOptimizer::checkPoseOnlyGN = false;
+
+	namespace
+	{
+		struct PoseObservation
+		{
+			Eigen::Vector3d pt3;
+			double u;
+			double v;
+			double invSigma2;
+			int cam;
+			size_t idx;
+			bool inlier;
+		};
+
+		// reused between calls, tracking optimizes several times per frame
+		struct PoseOnlyBuffers
+		{
+			std::vector<PoseObservation> vObs;
+			std::vector<cCamModelGeneral_> vCamModels;
+			std::vector<Eigen::Matrix<double, 12 + 5, 1>,
+				Eigen::aligned_allocator<Eigen::Matrix<double, 12 + 5, 1> > > vCamModelData;
+			std::vector<sCayleyTransform> vMcTransforms;
+			sCayleyTransform MtTransform;
+		};
+
+		inline double HuberRho(const double& chi2, const double& delta)
+		{
+			const double delta2 = delta * delta;
+			if (chi2 <= delta2)
+				return chi2;
+			return 2.0 * delta * std::sqrt(chi2) - delta2;
+		}
+
+		inline double HuberWeight(const double& chi2, const double& delta)
+		{
+			if (chi2 <= delta * delta)
+				return 1.0;
+			return delta / std::sqrt(chi2);
+		}
+
+		void UpdateCameraPoses(PoseOnlyBuffers& buf, const cv::Matx61d& Mt)
+		{
+			buf.MtTransform.Set(Mt);
+		}
+
+		// reprojection error like EdgeProjectXYZ2MCS::computeError
+		inline void ComputeError(const PoseOnlyBuffers& buf, const PoseObservation& obs,
+			double& eu, double& ev)
+		{
+			const Eigen::Vector3d Xc = mcsToCamera(obs.pt3, buf.MtTransform, buf.vMcTransforms[obs.cam]);
+			double u = 0.0, v = 0.0;
+			buf.vCamModels[obs.cam].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+			eu = obs.u - u;
+			ev = obs.v - v;
+		}
+
+		// robust cost of all inliers, needs UpdateCameraPoses
+		double RobustChi2(const PoseOnlyBuffers& buf, const double& thHuber)
+		{
+			double chi2Sum = 0.0;
+			for (size_t i = 0; i < buf.vObs.size(); ++i)
+			{
+				const PoseObservation& obs = buf.vObs[i];
+				if (!obs.inlier)
+					continue;
+				double eu, ev;
+				ComputeError(buf, obs, eu, ev);
+				chi2Sum += HuberRho(obs.invSigma2 * (eu * eu + ev * ev), thHuber);
+			}
+			return chi2Sum;
+		}
+
+		// normal equations H dx = -g from the mcsJacsChain Jacobians, Huber weighted,
+		// needs UpdateCameraPoses
+		void BuildNormalEquations(const PoseOnlyBuffers& buf,
+			const double& thHuber,
+			Eigen::Matrix<double, 6, 6>& H,
+			Eigen::Matrix<double, 6, 1>& g)
+		{
+			H.setZero();
+			g.setZero();
+			Eigen::Matrix<double, 2, 6> J;
+			for (size_t i = 0; i < buf.vObs.size(); ++i)
+			{
+				const PoseObservation& obs = buf.vObs[i];
+				if (!obs.inlier)
+					continue;
+				double eu, ev;
+				ComputeError(buf, obs, eu, ev);
+				const double w = obs.invSigma2 *
+					HuberWeight(obs.invSigma2 * (eu * eu + ev * ev), thHuber);
+
+				mcsJacsChain(obs.pt3, buf.MtTransform, buf.vMcTransforms[obs.cam],
+					buf.vCamModelData[obs.cam], NULL, &J, NULL, NULL);
+				// the error is measurement - projection, see EdgeProjectXYZ2MCS::linearizeOplus
+				J = -J;
+				H.noalias() += w * J.transpose() * J;
+				g.noalias() += w * J.transpose() * Eigen::Vector2d(eu, ev);
+			}
+		}
+
+		// Levenberg-Marquardt like g2o::OptimizationAlgorithmLevenberg,
+		// including the gain threshold of the terminate action used in the graph version.
+		// Returns the number of iterations done
+		int OptimizePose(PoseOnlyBuffers& buf, cv::Matx61d& Mt,
+			const double& thHuber, const int& nIterations, const double& gainThreshold)
+		{
+			const double tau = 1e-5;
+			const int maxTrials = 10;
+
+			Eigen::Matrix<double, 6, 6> H;
+			Eigen::Matrix<double, 6, 1> g;
+
+			UpdateCameraPoses(buf, Mt);
+			double currentChi = RobustChi2(buf, thHuber);
+			double lambda = 0.0;
+			double ni = 2.0;
+			int it = 0;
+			for (; it < nIterations; ++it)
+			{
+				BuildNormalEquations(buf, thHuber, H, g);
+				if (it == 0)
+				{
+					double maxDiagonal = 0.0;
+					for (int k = 0; k < 6; ++k)
+						maxDiagonal = std::max(maxDiagonal, std::fabs(H(k, k)));
+					lambda = tau * maxDiagonal;
+				}
+
+				const double lastChi = currentChi;
+				bool bAccepted = false;
+				for (int trial = 0; trial < maxTrials && !bAccepted; ++trial)
+				{
+					Eigen::Matrix<double, 6, 6> Hl = H;
+					Hl.diagonal().array() += lambda;
+					const Eigen::Matrix<double, 6, 1> dx = Hl.ldlt().solve(-g);
+					if (!dx.allFinite())
+						break;
+
+					cv::Matx61d MtNew = Mt;
+					for (int k = 0; k < 6; ++k)
+						MtNew(k, 0) += dx(k);
+					UpdateCameraPoses(buf, MtNew);
+					const double newChi = RobustChi2(buf, thHuber);
+
+					const double scale = dx.dot(lambda * dx - g) + 1e-3;
+					const double rho = (currentChi - newChi) / scale;
+					if (rho > 0 && std::isfinite(newChi))
+					{
+						const double alpha = 1.0 - std::pow(2.0 * rho - 1.0, 3);
+						lambda *= std::max(1.0 / 3.0, std::min(alpha, 2.0 / 3.0));
+						ni = 2.0;
+						Mt = MtNew;
+						currentChi = newChi;
+						bAccepted = true;
+					}
+					else
+					{
+						lambda *= ni;
+						ni *= 2.0;
+					}
+				}
+				if (!bAccepted)
+				{
+					UpdateCameraPoses(buf, Mt);
+					++it;
+					break;
+				}
+				const double gain = (lastChi - currentChi) / currentChi;
+				if (gain >= 0.0 && gain < gainThreshold)
+				{
+					++it;
+					break;
+				}
+			}
+			UpdateCameraPoses(buf, Mt);
+			return it;
+		}
+
+		// marks the observations over the threshold as outliers and the others as inliers,
+		// returns the number of observations that changed
+		int ClassifyObservations(PoseOnlyBuffers& buf, const double& thHuber2, int& nReincluded)
+		{
+			int nChanged = 0;
+			for (size_t i = 0; i < buf.vObs.size(); ++i)
+			{
+				PoseObservation& obs = buf.vObs[i];
+				double eu, ev;
+				ComputeError(buf, obs, eu, ev);
+				const bool bInlier = obs.invSigma2 * (eu * eu + ev * ev) <= thHuber2;
+				if (bInlier == obs.inlier)
+					continue;
+				if (bInlier)
+					++nReincluded;
+				obs.inlier = bInlier;
+				++nChanged;
+			}
+			return nChanged;
+		}
+	}
+
+	int cOptimizer::PoseOptimization(cMultiFrame *pFrame,
+		double& inliers,
+		const double& huberMultiplier,
+		const int& nIterations)
+	{
+		if (!checkPoseOnlyGN)
+		{
+			if (poseOnlyGN)
+				return PoseOptimizationGN(pFrame, inliers, huberMultiplier, nIterations);
+			return PoseOptimizationG2O(pFrame, inliers, huberMultiplier, nIterations);
+		}
+
+		// run both from the same start and report the differences,
+		// the result of the selected solver is used
+		const cv::Matx61d startPose = pFrame->GetPoseMin();
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		double inliersG2O = 0.0;
+		const int nGoodG2O = PoseOptimizationG2O(pFrame, inliersG2O, huberMultiplier, nIterations);
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		const cv::Matx61d poseG2O = pFrame->GetPoseMin();
+		const std::vector<bool> vbOutlierG2O = pFrame->mvbOutlier;
+
+		cv::Matx61d pose = startPose;
+		pFrame->SetPoseMin(pose);
+		const int nGood = PoseOptimizationGN(pFrame, inliers, huberMultiplier, nIterations);
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+		int nFlipped = 0;
+		for (size_t i = 0; i < vbOutlierG2O.size(); ++i)
+			if (pFrame->mvpMapPoints[i] && vbOutlierG2O[i] != pFrame->mvbOutlier[i])
+				++nFlipped;
+		const cv::Matx61d poseDiff = pFrame->GetPoseMin() - poseG2O;
+		std::cout << "pose solver check: g2o " <<
+			std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000.0 <<
+			" ms, GN " <<
+			std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1000.0 <<
+			" ms, good " << nGoodG2O << "/" << nGood <<
+			", outlier flips " << nFlipped <<
+			", |dr| " << cv::norm(poseDiff.get_minor<3, 1>(0, 0)) <<
+			", |dt| " << cv::norm(poseDiff.get_minor<3, 1>(3, 0)) << std::endl;
+		if (!poseOnlyGN)
+		{
+			pose = poseG2O;
+			pFrame->SetPoseMin(pose);
+			pFrame->mvbOutlier = vbOutlierG2O;
+			inliers = inliersG2O;
+			return nGoodG2O;
+		}
+		return nGood;
+	}
+
+	int cOptimizer::PoseOptimizationGN(cMultiFrame *pFrame,
+		double& inliers,
+		const double& huberMultiplier,
+		const int& nIterations)
+	{
+		static thread_local PoseOnlyBuffers buf;
+
+		const int nrCams = pFrame->camSystem.GetNrCams();
+		buf.vCamModels.resize(nrCams);
+		buf.vCamModelData.resize(nrCams);
+		buf.vMcTransforms.resize(nrCams);
+		for (int c = 0; c < nrCams; ++c)
+		{
+			buf.vCamModels[c] = pFrame->camSystem.GetCamModelObj(c);
+			buf.vCamModelData[c] = buf.vCamModels[c].toVector();
+			buf.vMcTransforms[c].Set(pFrame->camSystem.Get_M_c_min(c));
+		}
+
+		const double thHuber = 1.345 * huberMultiplier;
+		const double thHuber2 = thHuber * thHuber;
+
+		const int N = pFrame->mvpMapPoints.size();
+		buf.vObs.clear();
+		buf.vObs.reserve(N);
+		for (int i = 0; i < N; ++i)
+		{
+			cMapPoint* pMP = pFrame->mvpMapPoints[i];
+			pFrame->mvbOutlier[i] = false;
+			if (!pMP)
+				continue;
+
+			const cv::KeyPoint& kpUn = pFrame->mvKeys[i];
+			PoseObservation obs;
+			const cv::Vec3d X = pMP->GetWorldPos();
+			obs.pt3 = Eigen::Vector3d(X(0), X(1), X(2));
+			obs.u = kpUn.pt.x;
+			obs.v = kpUn.pt.y;
+			obs.invSigma2 = pFrame->mvInvLevelSigma2[kpUn.octave];
+			obs.cam = pFrame->keypoint_to_cam.find(i)->second;
+			obs.idx = i;
+			obs.inlier = true;
+			buf.vObs.push_back(obs);
+		}
+		const int nInitialCorrespondences = static_cast<int>(buf.vObs.size());
+
+		cv::Matx61d Mt = pFrame->GetPoseMin();
+
+		if (adaptiveOutliers)
+		{
+			// rounds until the inlier set is stable, at most the iterations of the two rounds
+			const int nBudget = 2 * nIterations;
+			int nDone = 0, nRounds = 0, nReincluded = 0;
+			while (nDone < nBudget)
+			{
+				const int nMax = std::min(nIterations, nBudget - nDone);
+				const int nIt = OptimizePose(buf, Mt, thHuber, nMax, outlierGainThreshold);
+				nDone += nIt;
+				++nRounds;
+				// a round that ran out of iterations has not converged yet
+				if (ClassifyObservations(buf, thHuber2, nReincluded) == 0 && nIt < nMax)
+					break;
+			}
+			poseOptimizationStats.Add(nDone, nBudget, nRounds, nReincluded);
+
+			int nBad = 0;
+			for (size_t i = 0; i < buf.vObs.size(); ++i)
+			{
+				const PoseObservation& obs = buf.vObs[i];
+				pFrame->mvbOutlier[obs.idx] = !obs.inlier;
+				if (!obs.inlier)
+					++nBad;
+			}
+			pFrame->camSystem.Set_M_t_from_min(Mt);
+			inliers = nInitialCorrespondences > 0 ?
+				static_cast<double>(nBad) / static_cast<double>(nInitialCorrespondences) : 0.0;
+			return nInitialCorrespondences - nBad;
+		}
+
+		// same two rounds as the graph version: optimize, drop the outliers, optimize again
+		int nDone = OptimizePose(buf, Mt, thHuber, nIterations, 1e-6);
+
+		int nBad = 0;
+		for (size_t i = 0; i < buf.vObs.size(); ++i)
+		{
+			PoseObservation& obs = buf.vObs[i];
+			double eu, ev;
+			ComputeError(buf, obs, eu, ev);
+			if (obs.invSigma2 * (eu * eu + ev * ev) > thHuber2)
+			{
+				obs.inlier = false;
+				pFrame->mvbOutlier[obs.idx] = true;
+				++nBad;
+			}
+		}
+
+		nDone += OptimizePose(buf, Mt, thHuber, nIterations, 1e-6);
+		poseOptimizationStats.Add(nDone, 2 * nIterations, 2, 0);
+
+		for (size_t i = 0; i < buf.vObs.size(); ++i)
+		{
+			const PoseObservation& obs = buf.vObs[i];
+			if (!obs.inlier)
+				continue;
+			double eu, ev;
+			ComputeError(buf, obs, eu, ev);
+			if (obs.invSigma2 * (eu * eu + ev * ev) > thHuber2)
+			{
+				pFrame->mvbOutlier[obs.idx] = true;
+				++nBad;
+			}
+			else
+				pFrame->mvbOutlier[obs.idx] = false;
+		}
+
+		pFrame->camSystem.Set_M_t_from_min(Mt);
+
+		if (nInitialCorrespondences > 0)
+			inliers = static_cast<double>(nBad) / static_cast<double>(nInitialCorrespondences);
+		else inliers = 0;
+
+		return nInitialCorrespondences - nBad;
+	}
+}
@@ -0,0 +1,408 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cOptimizer.h"
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "cConverter.h"
+#include "g2o_MultiCol_vertices_edges.h"
+
+// Sim3 between the body frames of two multi camera keyframes without a g2o graph.
+// The same model as OptimizeSim3G2O with its fixed points: the points of one
+// keyframe (in its body frame) are mapped with S12 or S21 = S12^-1 and projected
+// into the camera of the matched keypoint of the other keyframe. Solved with
+// Levenberg-Marquardt on the 7x7 normal equations, the projection Jacobians
+// come from mcsJacsChain as in the pose only solver.
+namespace MultiColSLAM
+{
+	bool cOptimizer::sim3GN = false;
+	bool cOptimizer::checkSim3GN = false;
+
+	namespace
+	{
+		typedef Eigen::Matrix<double, 7, 1> Vector7d;
+		typedef Eigen::Matrix<double, 7, 7> Matrix7d;
+
+		struct Sim3Match
+		{
+			Eigen::Vector3d X1;	// point of keyframe 1 in its body frame
+			Eigen::Vector3d X2;
+			double u1;			// keypoint in keyframe 1
+			double v1;
+			double u2;
+			double v2;
+			double invSigma21;
+			double invSigma22;
+			int cam1;
+			int cam2;
+			size_t idx;
+			bool inlier;
+		};
+
+		// reused between calls, loop closing checks several candidates per keyframe
+		struct Sim3Buffers
+		{
+			std::vector<Sim3Match> vMatches;
+			std::vector<cCamModelGeneral_> vCamModels[2];
+			std::vector<Eigen::Matrix<double, 12 + 5, 1>,
+				Eigen::aligned_allocator<Eigen::Matrix<double, 12 + 5, 1> > > vCamModelData[2];
+			std::vector<sCayleyTransform> vMcTransforms[2];
+		};
+
+		void SetCameras(Sim3Buffers& buf, const int& k, cMultiCamSys_& camSystem)
+		{
+			const int nrCams = camSystem.GetNrCams();
+			buf.vCamModels[k].resize(nrCams);
+			buf.vCamModelData[k].resize(nrCams);
+			buf.vMcTransforms[k].resize(nrCams);
+			for (int c = 0; c < nrCams; ++c)
+			{
+				buf.vCamModels[k][c] = camSystem.GetCamModelObj(c);
+				buf.vCamModelData[k][c] = buf.vCamModels[k][c].toVector();
+				buf.vMcTransforms[k][c].Set(camSystem.Get_M_c_min(c));
+			}
+		}
+
+		inline double HuberRho(const double& chi2, const double& delta)
+		{
+			const double delta2 = delta * delta;
+			if (chi2 <= delta2)
+				return chi2;
+			return 2.0 * delta * std::sqrt(chi2) - delta2;
+		}
+
+		inline double HuberWeight(const double& chi2, const double& delta)
+		{
+			if (chi2 <= delta * delta)
+				return 1.0;
+			return delta / std::sqrt(chi2);
+		}
+
+		// reprojection error of the point X (body frame) into camera c of keyframe k,
+		// like EdgeSim3ProjectXYZ_Multi::computeError
+		inline void ComputeError(const Sim3Buffers& buf, const int& k, const int& c,
+			const Eigen::Vector3d& X, const double& uObs, const double& vObs,
+			double& eu, double& ev)
+		{
+			const sCayleyTransform& Mc = buf.vMcTransforms[k][c];
+			const Eigen::Vector3d Xc = Mc.R.transpose() * (X - Mc.t);
+			double u = 0.0, v = 0.0;
+			buf.vCamModels[k][c].WorldToImg(Xc(0), Xc(1), Xc(2), u, v);
+			eu = uObs - u;
+			ev = vObs - v;
+		}
+
+		// squared errors of both directions of match m
+		inline void ComputeChi2(const Sim3Buffers& buf, const Sim3Match& m,
+			const g2o::Sim3& S12, const g2o::Sim3& S21, double& chi21, double& chi22)
+		{
+			double eu, ev;
+			ComputeError(buf, 0, m.cam1, S12.map(m.X2), m.u1, m.v1, eu, ev);
+			chi21 = m.invSigma21 * (eu * eu + ev * ev);
+			ComputeError(buf, 1, m.cam2, S21.map(m.X1), m.u2, m.v2, eu, ev);
+			chi22 = m.invSigma22 * (eu * eu + ev * ev);
+		}
+
+		double RobustChi2(const Sim3Buffers& buf, const g2o::Sim3& S12, const double& thHuber)
+		{
+			const g2o::Sim3 S21 = S12.inverse();
+			double chi2Sum = 0.0;
+			for (size_t i = 0; i < buf.vMatches.size(); ++i)
+			{
+				const Sim3Match& m = buf.vMatches[i];
+				if (!m.inlier)
+					continue;
+				double chi21, chi22;
+				ComputeChi2(buf, m, S12, S21, chi21, chi22);
+				chi2Sum += HuberRho(chi21, thHuber) + HuberRho(chi22, thHuber);
+			}
+			return chi2Sum;
+		}
+
+		// adds one Huber weighted residual, J is d error / d (S12 update)
+		inline void AddResidual(const Eigen::Matrix<double, 2, 7>& J,
+			const double& eu, const double& ev, const double& invSigma2, const double& thHuber,
+			Matrix7d& H, Vector7d& g)
+		{
+			const double w = invSigma2 * HuberWeight(invSigma2 * (eu * eu + ev * ev), thHuber);
+			H.noalias() += w * J.transpose() * J;
+			g.noalias() += w * J.transpose() * Eigen::Vector2d(eu, ev);
+		}
+
+		// d projection / d point (2x3) of X (body frame) in camera c of keyframe k,
+		// mcsJacsChain with M_t = identity
+		inline void ProjectionJacobian(const Sim3Buffers& buf, const int& k, const int& c,
+			const Eigen::Vector3d& X, Eigen::Matrix<double, 2, 3>& Jp)
+		{
+			static const sCayleyTransform identity;
+			mcsJacsChain(X, identity, buf.vMcTransforms[k][c], buf.vCamModelData[k][c],
+				&Jp, NULL, NULL, NULL);
+		}
+
+		// normal equations H dx = -g for the update S12 <- exp(dx) * S12,
+		// dx = (omega, upsilon, sigma) like g2o::Sim3
+		void BuildNormalEquations(const Sim3Buffers& buf, const g2o::Sim3& S12,
+			const double& thHuber, Matrix7d& H, Vector7d& g)
+		{
+			H.setZero();
+			g.setZero();
+			const g2o::Sim3 S21 = S12.inverse();
+			// d S21 X / d dx = -1/s R^T d (exp(dx) X) / d dx
+			const Eigen::Matrix3d R21s = S21.scale() * S21.rotation().toRotationMatrix();
+			Eigen::Matrix<double, 3, 7> dY;
+			Eigen::Matrix<double, 2, 3> Jp;
+			Eigen::Matrix<double, 2, 7> J;
+			for (size_t i = 0; i < buf.vMatches.size(); ++i)
+			{
+				const Sim3Match& m = buf.vMatches[i];
+				if (!m.inlier)
+					continue;
+				double eu, ev;
+
+				// x1 = S12 X2: d (exp(dx) Y) / d dx = [-[Y]x I Y]
+				const Eigen::Vector3d Y = S12.map(m.X2);
+				ComputeError(buf, 0, m.cam1, Y, m.u1, m.v1, eu, ev);
+				dY.block<3, 3>(0, 0) = -g2o::skew(Y);
+				dY.block<3, 3>(0, 3).setIdentity();
+				dY.col(6) = Y;
+				ProjectionJacobian(buf, 0, m.cam1, Y, Jp);
+				// the error is measurement - projection
+				J.noalias() = -Jp * dY;
+				AddResidual(J, eu, ev, m.invSigma21, thHuber, H, g);
+
+				// x2 = S12^-1 X1 = S21 exp(-dx) X1
+				const Eigen::Vector3d Z = S21.map(m.X1);
+				ComputeError(buf, 1, m.cam2, Z, m.u2, m.v2, eu, ev);
+				dY.block<3, 3>(0, 0) = g2o::skew(m.X1);
+				dY.block<3, 3>(0, 3) = -Eigen::Matrix3d::Identity();
+				dY.col(6) = -m.X1;
+				ProjectionJacobian(buf, 1, m.cam2, Z, Jp);
+				J.noalias() = -Jp * R21s * dY;
+				AddResidual(J, eu, ev, m.invSigma22, thHuber, H, g);
+			}
+		}
+
+		// Levenberg-Marquardt like g2o::OptimizationAlgorithmLevenberg,
+		// including the gain threshold of the terminate action used in the graph version
+		void OptimizeSim3LM(const Sim3Buffers& buf, g2o::Sim3& S12,
+			const double& thHuber, const int& nIterations)
+		{
+			const double tau = 1e-5;
+			const double gainThreshold = 1e-6;
+			const int maxTrials = 10;
+
+			Matrix7d H;
+			Vector7d g;
+
+			double currentChi = RobustChi2(buf, S12, thHuber);
+			double lambda = 0.0;
+			double ni = 2.0;
+			for (int it = 0; it < nIterations; ++it)
+			{
+				BuildNormalEquations(buf, S12, thHuber, H, g);
+				if (it == 0)
+				{
+					double maxDiagonal = 0.0;
+					for (int k = 0; k < 7; ++k)
+						maxDiagonal = std::max(maxDiagonal, std::fabs(H(k, k)));
+					lambda = tau * maxDiagonal;
+				}
+
+				const double lastChi = currentChi;
+				bool bAccepted = false;
+				for (int trial = 0; trial < maxTrials && !bAccepted; ++trial)
+				{
+					Matrix7d Hl = H;
+					Hl.diagonal().array() += lambda;
+					const Vector7d dx = Hl.ldlt().solve(-g);
+					if (!dx.allFinite())
+						break;
+
+					const g2o::Sim3 S12New = g2o::Sim3(dx) * S12;
+					const double newChi = RobustChi2(buf, S12New, thHuber);
+
+					const double scale = dx.dot(lambda * dx - g) + 1e-3;
+					const double rho = (currentChi - newChi) / scale;
+					if (rho > 0 && std::isfinite(newChi))
+					{
+						const double alpha = 1.0 - std::pow(2.0 * rho - 1.0, 3);
+						lambda *= std::max(1.0 / 3.0, std::min(alpha, 2.0 / 3.0));
+						ni = 2.0;
+						S12 = S12New;
+						currentChi = newChi;
+						bAccepted = true;
+					}
+					else
+					{
+						lambda *= ni;
+						ni *= 2.0;
+					}
+				}
+				if (!bAccepted)
+					break;
+				const double gain = (lastChi - currentChi) / currentChi;
+				if (gain >= 0.0 && gain < gainThreshold)
+					break;
+			}
+		}
+	}
+
+	int cOptimizer::OptimizeSim3(cMultiKeyFrame *pKF1,
+		cMultiKeyFrame *pKF2,
+		std::vector<cMapPoint *> &vpMatches1,
+		g2o::Sim3 &g2oS12)
+	{
+		if (!checkSim3GN)
+		{
+			if (sim3GN)
+				return OptimizeSim3GN(pKF1, pKF2, vpMatches1, g2oS12);
+			return OptimizeSim3G2O(pKF1, pKF2, vpMatches1, g2oS12);
+		}
+
+		// run both from the same start and report the differences,
+		// the result of the selected solver is used
+		std::vector<cMapPoint*> vpMatchesG2O = vpMatches1;
+		g2o::Sim3 S12G2O = g2oS12;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		const int nInG2O = OptimizeSim3G2O(pKF1, pKF2, vpMatchesG2O, S12G2O);
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		const int nIn = OptimizeSim3GN(pKF1, pKF2, vpMatches1, g2oS12);
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+		int nFlipped = 0;
+		for (size_t i = 0; i < vpMatches1.size(); ++i)
+			if ((vpMatchesG2O[i] != NULL) != (vpMatches1[i] != NULL))
+				++nFlipped;
+		const Vector7d diff = (g2oS12 * S12G2O.inverse()).log();
+		std::cout << "sim3 solver check: g2o " <<
+			std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / 1000.0 <<
+			" ms, GN " <<
+			std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1000.0 <<
+			" ms, inliers " << nInG2O << "/" << nIn <<
+			", outlier flips " << nFlipped <<
+			", |dr| " << diff.head<3>().norm() <<
+			", |dt| " << diff.segment<3>(3).norm() <<
+			", |ds| " << std::fabs(diff(6)) << std::endl;
+		if (!sim3GN)
+		{
+			vpMatches1 = vpMatchesG2O;
+			g2oS12 = S12G2O;
+			return nInG2O;
+		}
+		return nIn;
+	}
+
+	int cOptimizer::OptimizeSim3GN(cMultiKeyFrame *pKF1,
+		cMultiKeyFrame *pKF2,
+		std::vector<cMapPoint *> &vpMatches1,
+		g2o::Sim3 &g2oS12)
+	{
+		static thread_local Sim3Buffers buf;
+
+		SetCameras(buf, 0, pKF1->camSystem);
+		SetCameras(buf, 1, pKF2->camSystem);
+
+		const double thHuber = 1.345 * stdSim;
+		const double thHuber2 = thHuber * thHuber;
+
+		// points of both keyframes in their body frames
+		const cv::Matx44d invM_t1 = cConverter::invMat(pKF1->camSystem.Get_M_t());
+		const cv::Matx44d invM_t2 = cConverter::invMat(pKF2->camSystem.Get_M_t());
+
+		const int N = vpMatches1.size();
+		const std::vector<cMapPoint*> vpMapPoints1 = pKF1->GetMapPointMatches();
+		buf.vMatches.clear();
+		buf.vMatches.reserve(N);
+		for (int i = 0; i < N; ++i)
+		{
+			cMapPoint* pMP1 = vpMapPoints1[i];
+			cMapPoint* pMP2 = vpMatches1[i];
+			if (!pMP1 || !pMP2)
+				continue;
+			const int i2 = pMP2->GetIndexInKeyFrame(pKF2)[0];
+			if (pMP1->isBad() || pMP2->isBad() || i2 < 0)
+				continue;
+
+			const cv::Vec4d X1 = invM_t1 * cConverter::toVec4d(pMP1->GetWorldPos());
+			const cv::Vec4d X2 = invM_t2 * cConverter::toVec4d(pMP2->GetWorldPos());
+			const cv::KeyPoint kpUn1 = pKF1->GetKeyPoint(i);
+			const cv::KeyPoint kpUn2 = pKF2->GetKeyPoint(i2);
+
+			Sim3Match m;
+			m.X1 = Eigen::Vector3d(X1(0), X1(1), X1(2));
+			m.X2 = Eigen::Vector3d(X2(0), X2(1), X2(2));
+			m.u1 = kpUn1.pt.x;
+			m.v1 = kpUn1.pt.y;
+			m.u2 = kpUn2.pt.x;
+			m.v2 = kpUn2.pt.y;
+			m.invSigma21 = pKF1->GetInvSigma2(kpUn1.octave);
+			m.invSigma22 = pKF2->GetInvSigma2(kpUn2.octave);
+			m.cam1 = pKF1->keypoint_to_cam.find(i)->second;
+			m.cam2 = pKF2->keypoint_to_cam.find(i2)->second;
+			m.idx = i;
+			m.inlier = true;
+			buf.vMatches.push_back(m);
+		}
+		const int nCorrespondences = static_cast<int>(buf.vMatches.size());
+
+		// same two rounds as the graph version: optimize, drop the outliers, optimize again
+		OptimizeSim3LM(buf, g2oS12, thHuber, 5);
+
+		g2o::Sim3 S21 = g2oS12.inverse();
+		int nBad = 0;
+		for (size_t i = 0; i < buf.vMatches.size(); ++i)
+		{
+			Sim3Match& m = buf.vMatches[i];
+			double chi21, chi22;
+			ComputeChi2(buf, m, g2oS12, S21, chi21, chi22);
+			if (chi21 > thHuber2 || chi22 > thHuber2)
+			{
+				m.inlier = false;
+				vpMatches1[m.idx] = NULL;
+				++nBad;
+			}
+		}
+
+		if (nCorrespondences - nBad < 3)
+			return 0;
+
+		OptimizeSim3LM(buf, g2oS12, thHuber, nBad > 0 ? 10 : 5);
+
+		S21 = g2oS12.inverse();
+		int nIn = 0;
+		for (size_t i = 0; i < buf.vMatches.size(); ++i)
+		{
+			const Sim3Match& m = buf.vMatches[i];
+			if (!m.inlier)
+				continue;
+			double chi21, chi22;
+			ComputeChi2(buf, m, g2oS12, S21, chi21, chi22);
+			if (chi21 > thHuber2 || chi22 > thHuber2)
+				vpMatches1[m.idx] = NULL;
+			else
+				++nIn;
+		}
+		return nIn;
+	}
+}
@@ -26,6 +26,8 @@
 
 #include "cSystem.h"
 #include "cConverter.h"
+#include "cOptimizer.h"
+#include "cGlobalBA.h"
 #include <thread>
 #include <pangolin/pangolin.h>
 #include <iomanip>
@@ -35,10 +37,31 @@ namespace MultiColSLAM
 {
 	using namespace std;
 
+	namespace
+	{
+		// iterations of the outlier schedule against the budget of the fixed rounds,
+		// saved iterations are also given per tracked frame or keyframe
+		void PrintScheduleStats(const string& name, const cOptimizer::sScheduleStats& stats,
+			const string& unit, const long long& nrUnits)
+		{
+			if (stats.nRuns == 0)
+				return;
+			const double nrRuns = static_cast<double>(stats.nRuns);
+			const long long nrSaved = stats.nBudget - stats.nIterations;
+			cout << name << ": " << stats.nRuns << " runs, mean " << stats.nIterations / nrRuns <<
+				" of " << stats.nBudget / nrRuns << " iterations, " << stats.nRounds / nrRuns <<
+				" rounds, " << stats.nReincluded << " outliers taken in again, saved " <<
+				nrSaved / nrRuns << " iterations per run";
+			if (nrUnits > 0)
+				cout << ", " << static_cast<double>(nrSaved) / nrUnits << " per " << unit;
+			cout << endl;
+		}
+	}
+
 	cSystem::cSystem(const string &strVocFile, const string &strSettingsFile,
 		const string& path2MCScalibrationFiles,
-		const bool bUseViewer) : mbReset(false), mbActivateLocalizationMode(false),
-		mbDeactivateLocalizationMode(false)
+		const bool bUseViewer) : mpTrackingPipeline(NULL), mbReset(false),
+		mbActivateLocalizationMode(false), mbDeactivateLocalizationMode(false)
 	{
 		// Output welcome message
 		cout << endl <<
@@ -54,6 +77,56 @@ namespace MultiColSLAM
 			cerr << "Failed to open settings file at: " << strSettingsFile << endl;
 			exit(-1);
 		}
+		// image ingestion for the asynchronous interface
+		mnIngestionQueueSize = fsSettings["Ingestion.QueueSize"].empty() ?
+			1 : (int)fsSettings["Ingestion.QueueSize"];
+		meIngestionDropPolicy = static_cast<cTrackingPipeline::eDropPolicy>(
+			(int)fsSettings["Ingestion.DropPolicy"]);
+		mnIngestionKeepEveryK = fsSettings["Ingestion.KeepEveryK"].empty() ?
+			2 : (int)fsSettings["Ingestion.KeepEveryK"];
+		// threads for the linearization in the local BA
+		if (!fsSettings["Optimizer.Threads"].empty())
+			cOptimizer::nBAThreads = std::max(1, (int)fsSettings["Optimizer.Threads"]);
+		// local BA without g2o graph, Mc and the interior orientation stay fixed
+		if (!fsSettings["Optimizer.NativeLocalBA"].empty())
+			cOptimizer::nativeLocalBA = (int)fsSettings["Optimizer.NativeLocalBA"] != 0;
+		if (!fsSettings["Optimizer.CheckNativeLocalBA"].empty())
+			cOptimizer::checkNativeLocalBA = (int)fsSettings["Optimizer.CheckNativeLocalBA"] != 0;
+		// float Jacobians in the native local BA
+		if (!fsSettings["Optimizer.MixedPrecisionBA"].empty())
+			cOptimizer::mixedPrecisionBA = (int)fsSettings["Optimizer.MixedPrecisionBA"] != 0;
+		if (!fsSettings["Optimizer.CheckMixedPrecisionBA"].empty())
+			cOptimizer::checkMixedPrecisionBA = (int)fsSettings["Optimizer.CheckMixedPrecisionBA"] != 0;
+		if (!fsSettings["Optimizer.ReuseLocalBAGraph"].empty())
+			cOptimizer::reuseLocalBAGraph = (int)fsSettings["Optimizer.ReuseLocalBAGraph"] != 0;
+		// incremental smoothing instead of solving the local BA after every keyframe
+		if (!fsSettings["Optimizer.IncrementalBackend"].empty())
+			cOptimizer::incrementalBackend = (int)fsSettings["Optimizer.IncrementalBackend"] != 0;
+		if (!fsSettings["Optimizer.RelinearizeThreshold"].empty())
+			cOptimizer::relinearizeThreshold = (double)fsSettings["Optimizer.RelinearizeThreshold"];
+		if (!fsSettings["Optimizer.IncrementalIterations"].empty())
+			cOptimizer::incrementalIterations = std::max(1, (int)fsSettings["Optimizer.IncrementalIterations"]);
+		// global BA in a background thread after a loop closure
+		if (!fsSettings["Optimizer.GlobalBAAfterLoop"].empty())
+			cOptimizer::globalBAAfterLoop = (int)fsSettings["Optimizer.GlobalBAAfterLoop"] != 0;
+		if (!fsSettings["Optimizer.GlobalBAIterations"].empty())
+			cOptimizer::globalBAIterations = std::max(1, (int)fsSettings["Optimizer.GlobalBAIterations"]);
+		if (!fsSettings["Optimizer.PoseGraphSolver"].empty())
+			cOptimizer::poseGraphSolver = std::min(std::max(0, (int)fsSettings["Optimizer.PoseGraphSolver"]),
+				(int)cOptimizer::POSE_GRAPH_PCG);
+		if (!fsSettings["Optimizer.CheckPoseGraphSolvers"].empty())
+			cOptimizer::checkPoseGraphSolvers = (int)fsSettings["Optimizer.CheckPoseGraphSolvers"] != 0;
+		// sim3 of the loop candidates without g2o graph
+		if (!fsSettings["Optimizer.Sim3GN"].empty())
+			cOptimizer::sim3GN = (int)fsSettings["Optimizer.Sim3GN"] != 0;
+		if (!fsSettings["Optimizer.CheckSim3GN"].empty())
+			cOptimizer::checkSim3GN = (int)fsSettings["Optimizer.CheckSim3GN"] != 0;
+		// outlier aware schedule of the pose optimization and the local BA
+		if (!fsSettings["Optimizer.AdaptiveOutliers"].empty())
+			cOptimizer::adaptiveOutliers = (int)fsSettings["Optimizer.AdaptiveOutliers"] != 0;
+		if (!fsSettings["Optimizer.OutlierGainThreshold"].empty())
+			cOptimizer::outlierGainThreshold = (double)fsSettings["Optimizer.OutlierGainThreshold"];
+
 		//Load ORB Vocabulary
 		cout << endl << "Loading ORB Vocabulary. This could take a while..." << endl;
 
@@ -83,6 +156,9 @@ namespace MultiColSLAM
 		//Create the Map
 		mpMap = new cMap();
 
+		//Create the background global BA, started by loop closing or GetGlobalBA()
+		mpGlobalBA = new cGlobalBA(mpMap);
+
 		//Create Drawers. These are used by the Viewer
 		mpMultiFramePublisher = new cMultiFramePublisher(mpMap);
 		mpMapPublisher = new cMapPublisher(mpMap, strSettingsFile);
@@ -120,6 +196,8 @@ namespace MultiColSLAM
 
 		mpLoopCloser->SetTracker(mpTracker);
 		mpLoopCloser->SetLocalMapper(mpLocalMapper);
+		mpLoopCloser->SetGlobalBA(mpGlobalBA);
+		mpLocalMapper->SetGlobalBA(mpGlobalBA);
 	}
 
 	void cSystem::LoadMCS(const string path2calibrations,
@@ -208,19 +286,74 @@ namespace MultiColSLAM
 		//	}
 		//}
 
-		// Check reset
 		{
-			unique_lock<mutex> lock(mMutexReset);
-			if (mbReset)
+			unique_lock<mutex> lock(mMutexPipeline);
+			if (mpTrackingPipeline)
 			{
-				mpTracker->Reset();
-				mbReset = false;
+				lock.unlock();
+				return TrackMultiColSLAMAsync(imgSet, timestamp).get();
 			}
 		}
 
+		CheckReset();
+
 		return mpTracker->GrabImageSet(imgSet, timestamp);
 	}
 
+	std::future<cv::Matx44d> cSystem::TrackMultiColSLAMAsync(
+		const std::vector<cv::Mat>& imgSet,
+		const double &timestamp)
+	{
+		return GetTrackingPipeline()->Submit(imgSet, timestamp);
+	}
+
+	bool cSystem::SubmitImageSet(
+		const std::vector<cv::Mat>& imgSet,
+		const double &timestamp)
+	{
+		return GetTrackingPipeline()->TrySubmit(imgSet, timestamp);
+	}
+
+	void cSystem::SetPoseCallback(const cTrackingPipeline::PoseCallback& callback)
+	{
+		GetTrackingPipeline()->SetPoseCallback(callback);
+	}
+
+	bool cSystem::PollPose(cTrackingPipeline::sPoseResult& result)
+	{
+		return GetTrackingPipeline()->PollPose(result);
+	}
+
+	cTrackingPipeline::sIngestionStats cSystem::GetIngestionStats()
+	{
+		return GetTrackingPipeline()->GetStats();
+	}
+
+	cTrackingPipeline* cSystem::GetTrackingPipeline()
+	{
+		unique_lock<mutex> lock(mMutexPipeline);
+		if (!mpTrackingPipeline)
+			mpTrackingPipeline = new cTrackingPipeline(this, mpTracker,
+				mnIngestionQueueSize, meIngestionDropPolicy, mnIngestionKeepEveryK);
+		return mpTrackingPipeline;
+	}
+
+	void cSystem::CheckReset()
+	{
+		unique_lock<mutex> lock(mMutexReset);
+		if (mbReset)
+		{
+			mpTracker->Reset();
+			mbReset = false;
+		}
+	}
+
+	bool cSystem::ResetRequested()
+	{
+		unique_lock<mutex> lock(mMutexReset);
+		return mbReset;
+	}
+
 	void cSystem::ActivateLocalizationMode()
 	{
 		unique_lock<mutex> lock(mMutexMode);
@@ -242,6 +375,14 @@ namespace MultiColSLAM
 	void cSystem::Shutdown()
 	{
 		cout << "System shutdown" << endl;
+		{
+			// track everything that is still queued before the other threads stop
+			unique_lock<mutex> lock(mMutexPipeline);
+			if (mpTrackingPipeline)
+				mpTrackingPipeline->Finish();
+		}
+		// an unfinished global BA is dropped, local mapping would not merge it anymore
+		mpGlobalBA->Cancel();
 		mpLocalMapper->RequestFinish();
 		mpLoopCloser->RequestFinish();
 		mpViewer->RequestFinish();
@@ -254,6 +395,78 @@ namespace MultiColSLAM
 			std::this_thread::sleep_for(std::chrono::milliseconds(500));
 		}
 		cout << "All threads stopped..." << endl;
+		// the loop closer might have started one while finishing
+		mpGlobalBA->Cancel();
+
+		if (mpGlobalBA->NrMerged() > 0)
+		{
+			const cGlobalBA::sStats stats = mpGlobalBA->GetLastStats();
+			cout << "Global BA: " << mpGlobalBA->NrMerged() << " merged, last one " <<
+				stats.nKeyFrames << " keyframes and " << stats.nMapPoints << " points, " <<
+				stats.nIterations << " iterations, setup " << stats.setupMs << "ms, optimization " <<
+				stats.optimizationMs << "ms, merge " << stats.mergeMs << "ms, propagated " <<
+				stats.nPropagatedKeyFrames << " keyframes and " << stats.nPropagatedMapPoints << " points" << endl;
+		}
+
+		long long nrTested = 0, nrCulled = 0;
+		for (size_t i = 0; i < mpTracker->nrProjectionsTested.size(); ++i)
+		{
+			nrTested += mpTracker->nrProjectionsTested[i];
+			nrCulled += mpTracker->nrProjectionsCulled[i];
+		}
+		if (nrTested + nrCulled > 0)
+			cout << "Local map projections: " << nrTested << " done, " << nrCulled <<
+				" culled by keyframe bounds (" << 100.0 * nrCulled / (nrTested + nrCulled) << "%)" << endl;
+
+		// fallback rates, to compare runs with and without the direct alignment
+		if (mpTracker->nrFramesTracking > 0)
+		{
+			const double nrFrames = mpTracker->nrFramesTracking;
+			cout << "Tracked frames: " << mpTracker->nrFramesTracking <<
+				", motion model: " << mpTracker->nrMotionModelFrames <<
+				", fallback to previous frame: " << mpTracker->nrPreviousFrameFallbacks <<
+				" (" << 100.0 * mpTracker->nrPreviousFrameFallbacks / nrFrames << "%)" <<
+				", relocalisation: " << mpTracker->nrRelocalisationFrames <<
+				" (" << 100.0 * mpTracker->nrRelocalisationFrames / nrFrames << "%)" << endl;
+			if (mpTracker->nrDirectAlignments > 0)
+				cout << "Direct alignments accepted: " << mpTracker->nrDirectAlignmentsAccepted <<
+					" of " << mpTracker->nrDirectAlignments << endl;
+		}
+		// hit rate of the incrementally maintained local map
+		const int nrLocalMapUpdates = mpTracker->nrLocalMapReused + mpTracker->nrLocalMapRebuilt;
+		if (nrLocalMapUpdates > 0)
+			cout << "Local map kept from the last frame: " << mpTracker->nrLocalMapReused <<
+				" of " << nrLocalMapUpdates << " (" << 100.0 * mpTracker->nrLocalMapReused / nrLocalMapUpdates <<
+				"%), rebuilt " << mpTracker->nrLocalMapRebuilt << endl;
+
+		PrintScheduleStats("Pose optimization", cOptimizer::poseOptimizationStats,
+			"tracked frame", mpTracker->nrFramesTracking);
+		PrintScheduleStats("Local BA", cOptimizer::localBAStats,
+			"keyframe", mpMap->KeyFramesInMap());
+
+		// features against tracked inliers, to compare fixed and adaptive feature budgets
+		const std::vector<std::vector<int> >& features = mpTracker->featuresPerCam;
+		const std::vector<std::vector<int> >& inliers = mpTracker->inliersPerCam;
+		if (!features.empty())
+		{
+			double extractionTime = 0.0;
+			for (size_t i = 0; i < mpTracker->timingFeatureExtraction.size(); ++i)
+				extractionTime += mpTracker->timingFeatureExtraction[i];
+			if (!mpTracker->timingFeatureExtraction.empty())
+				extractionTime /= mpTracker->timingFeatureExtraction.size();
+			cout << "Mean feature extraction: " << extractionTime << "ms" << endl;
+			for (size_t c = 0; c < features[0].size(); ++c)
+			{
+				double nrFeatures = 0.0, nrInliers = 0.0;
+				for (size_t i = 0; i < features.size(); ++i)
+				{
+					nrFeatures += features[i][c];
+					nrInliers += inliers[i][c];
+				}
+				cout << "Camera " << c << ": mean features " << nrFeatures / features.size() <<
+					", mean tracked inliers " << nrInliers / features.size() << endl;
+			}
+		}
 		pangolin::BindToContext("MultiCol-SLAM: Map Viewer");
 	}
 
@@ -42,7 +42,10 @@
 #ifdef _WIN32
 #include <conio.h>
 #endif
+#include <cassert>
 #include <memory>
+#include <limits>
+#include <omp.h>
 
 
 namespace MultiColSLAM
@@ -77,6 +80,11 @@ cTracking::cTracking(
 	grab(true),
 	loopAndMapperSet(false)
 {
+	mbUseInitExtractor = true;
+	mbLocalMapDirty = true;
+	mnLocalMapEraseVersion = 0;
+	mnLocalMapMaxKFid = 0;
+	mnLocalBoundsVersion = 0;
 
 	pFramePublisher->SetMCS(&camSystem);
 	mpMapPublisher->SetMCS(camSystem.Get_All_M_c());
@@ -108,6 +116,8 @@ cTracking::cTracking(
     // Load ORB parameters
 	int featDim = (int)slamSettings["extractor.descSize"];
 	int nFeatures = (int)slamSettings["extractor.nFeatures"];
+	mnFeatures = nFeatures;
+	mnFeatureBudget = nFeatures;
 	float fScaleFactor = slamSettings["extractor.scaleFactor"];
 	int nLevels = (int)slamSettings["extractor.nLevels"];
 	int fastTh = (int)slamSettings["extractor.fastTh"];
@@ -172,6 +182,70 @@ cTracking::cTracking(
     else
 		std::cout << endl << "Motion Model: Disabled (not recommended, change settings UseMotionModel: 1)" << endl << endl;
 
+	// search windows from the uncertainty of the motion model
+	mbAdaptiveSearchWindow = (int)slamSettings["Tracking.AdaptiveSearchWindow"] == 1;
+	mdMinSearchRadius = slamSettings["Tracking.MinSearchRadius"].empty() ?
+		5.0 : (double)slamSettings["Tracking.MinSearchRadius"];
+	mbPosePredicted = false;
+	mPredictionCov = cv::Matx66d::zeros();
+	mnPredictionSamples = 0;
+
+	// direct alignment of the prediction on the coarse pyramid levels
+	mbDirectAlignment = (int)slamSettings["Tracking.DirectAlignment"] == 1;
+	mnDirectAlignmentTopLevel = slamSettings["Tracking.DirectAlignmentTopLevel"].empty() ?
+		2 : (int)slamSettings["Tracking.DirectAlignmentTopLevel"];
+	mnDirectAlignmentBottomLevel = slamSettings["Tracking.DirectAlignmentBottomLevel"].empty() ?
+		1 : (int)slamSettings["Tracking.DirectAlignmentBottomLevel"];
+	nrFramesTracking = 0;
+	nrMotionModelFrames = 0;
+	nrPreviousFrameFallbacks = 0;
+	nrRelocalisationFrames = 0;
+	nrDirectAlignments = 0;
+	nrDirectAlignmentsAccepted = 0;
+	nrLocalMapReused = 0;
+	nrLocalMapRebuilt = 0;
+
+	// pose only optimization, a missing entry keeps the defaults
+	if (!slamSettings["Tracking.PoseSolver"].empty())
+		cOptimizer::poseOnlyGN = (int)slamSettings["Tracking.PoseSolver"] == 1;
+	cOptimizer::checkPoseOnlyGN = (int)slamSettings["Tracking.PoseSolverCheck"] == 1;
+
+	// time budget for relocalisation in ms, candidates still running after it are dropped
+	mdRelocBudgetMs = (double)slamSettings["Tracking.RelocalisationBudget"];
+
+	// latency budget per frame and how to degrade if it is missed
+	mdFrameBudgetMs = (double)slamSettings["Tracking.FrameBudget"];
+	mnBudgetMaxLocalPoints = slamSettings["Tracking.BudgetMaxLocalPoints"].empty() ?
+		1500 : (int)slamSettings["Tracking.BudgetMaxLocalPoints"];
+	mnBudgetPoseIterations = slamSettings["Tracking.BudgetPoseIterations"].empty() ?
+		5 : (int)slamSettings["Tracking.BudgetPoseIterations"];
+	mdBudgetFeatureScale = slamSettings["Tracking.BudgetFeatureScale"].empty() ?
+		0.7 : (double)slamSettings["Tracking.BudgetFeatureScale"];
+	mnDegradationLevel = 0;
+	mnFramesUnderBudget = 0;
+	mnFrameDegradation = DEGRADE_NONE;
+	mnLocalPointsOffset = 0;
+	mdLastTrackLocalMapTime = 0.0;
+	mdCurrentExtractionTime = 0.0;
+	if (mdFrameBudgetMs > 0.0)
+		std::cout << "- Frame budget: " << mdFrameBudgetMs << " ms" << endl;
+
+	// distribution of the features among the cameras
+	mbAdaptiveFeatures = (int)slamSettings["Tracking.AdaptiveFeatures"] == 1;
+	mdFeatureScaleMin = slamSettings["Tracking.FeatureScaleMin"].empty() ?
+		0.5 : (double)slamSettings["Tracking.FeatureScaleMin"];
+	mdFeatureScaleMax = slamSettings["Tracking.FeatureScaleMax"].empty() ?
+		1.5 : (double)slamSettings["Tracking.FeatureScaleMax"];
+	mdFeatureScaleMin = std::min(mdFeatureScaleMin, 1.0);
+	mdFeatureScaleMax = std::max(mdFeatureScaleMax, 1.0);
+	mvdInlierYield = std::vector<double>(numberCameras, 0.0);
+	mvdFeatureScales = std::vector<double>(numberCameras, 1.0);
+	if (mbAdaptiveFeatures)
+		std::cout << "- Adaptive features per camera: " << mdFeatureScaleMin << " - " <<
+			mdFeatureScaleMax << " x " << nFeatures << endl;
+
+	mnReclaimerId = mpMap->GetReclaimer()->RegisterThread();
+
 	//allPoses = std::vector<cv::Matx61d>(nrImages2Track);
 	//allPosesBool = std::vector<bool>(nrImages2Track);
 	//nrTrackedPts = std::vector<int>(nrImages2Track);
@@ -206,19 +280,42 @@ int cTracking::GetNrCams()
 cv::Matx44d cTracking::GrabImageSet(const std::vector<cv::Mat>& imgSet,
 	const double& timestamp)
 {
-	std::chrono::system_clock Time;
+	ExtractFrame(imgSet, timestamp, mCurrentFrame);
+	return TrackFrame(mCurrentFrame);
+}
 
+void cTracking::ExtractFrame(const std::vector<cv::Mat>& imgSet,
+	const double& timestamp, cMultiFrame& frame)
+{
 	std::vector<cv::Mat> convertedImages(imgSet.size());
 	convertedImages = imgSet;
 
-	if (mState == WORKING || mState == LOST)
-		mCurrentFrame = cMultiFrame(convertedImages,
-		timestamp, mp_mdBRIEF_extractorOct, mpORBVocabulary, 
+	// the extractors are only used here, so they can be changed without locking
+	const int nFeatures = mnFeatureBudget;
+	{
+		std::unique_lock<std::mutex> lock(mMutexFeatureScales);
+		for (size_t c = 0; c < mp_mdBRIEF_extractorOct.size(); ++c)
+			mp_mdBRIEF_extractorOct[c]->SetNumFeatures(cvRound(nFeatures * mvdFeatureScales[c]));
+	}
+
+	if (mbUseInitExtractor)
+		frame = cMultiFrame(convertedImages,
+		timestamp, mp_mdBRIEF_init_extractorOct, mpORBVocabulary, 
 		camSystem, imgCounter - 1);
 	else
-		mCurrentFrame = cMultiFrame(convertedImages,
-		timestamp, mp_mdBRIEF_init_extractorOct, mpORBVocabulary, 
+		frame = cMultiFrame(convertedImages,
+		timestamp, mp_mdBRIEF_extractorOct, mpORBVocabulary, 
 		camSystem, imgCounter - 1);
+}
+
+cv::Matx44d cTracking::TrackFrame(const cMultiFrame& frame)
+{
+	// no references to bad map points or keyframes survive this point
+	ReleaseBadReferences();
+	mpMap->GetReclaimer()->QuiescentState(mnReclaimerId);
+
+	if (&frame != &mCurrentFrame)
+		mCurrentFrame = frame;
 
 	if (!loopAndMapperSet)
 	{
@@ -229,11 +326,139 @@ cv::Matx44d cTracking::GrabImageSet(const std::vector<cv::Mat>& imgSet,
 		loopAndMapperSet = true;
 	}
 
+	mtFrameStart = HResClk::now();
+	mdCurrentExtractionTime = mCurrentFrame.mdExtractionTime;
+	mnFrameDegradation = DEGRADE_NONE;
+	if (mdFrameBudgetMs > 0.0)
+	{
+		if (mnDegradationLevel >= 1)
+			mnFrameDegradation |= DEGRADE_LOCAL_POINTS;
+		if (mnDegradationLevel >= 2)
+			mnFrameDegradation |= DEGRADE_POSE_ITERATIONS;
+	}
+
 	Track();
+	mbUseInitExtractor = !(mState == WORKING || mState == LOST);
+
+	UpdateFrameBudget(mdCurrentExtractionTime);
 
 	return mCurrentFrame.GetPose();
 }
 
+double cTracking::RemainingFrameBudget()
+{
+	return mdFrameBudgetMs - mdCurrentExtractionTime - T_in_ms(mtFrameStart, HResClk::now());
+}
+
+void cTracking::UpdateFrameBudget(const double& extractionTime)
+{
+	const double frameTime = extractionTime + T_in_ms(mtFrameStart, HResClk::now());
+	timingFeatureExtraction.push_back(extractionTime);
+	timingFrame.push_back(frameTime);
+	if (mdFrameBudgetMs <= 0.0)
+		return;
+
+	const bool bMissed = frameTime > mdFrameBudgetMs;
+	if (bMissed)
+	{
+		mnDegradationLevel = std::min(mnDegradationLevel + 1, 3);
+		mnFramesUnderBudget = 0;
+	}
+	else if (frameTime < 0.7 * mdFrameBudgetMs)
+	{
+		// relax slowly, otherwise the level oscillates
+		if (++mnFramesUnderBudget >= 30 && mnDegradationLevel > 0)
+		{
+			--mnDegradationLevel;
+			mnFramesUnderBudget = 0;
+		}
+	}
+	else
+		mnFramesUnderBudget = 0;
+
+	// the feature budget can only change the next frames
+	if (mnDegradationLevel >= 3)
+	{
+		mnFrameDegradation |= DEGRADE_FEATURES;
+		mnFeatureBudget = cvRound(mnFeatures * mdBudgetFeatureScale);
+	}
+	else
+		mnFeatureBudget = mnFeatures;
+
+	frameBudgetMissed.push_back(bMissed);
+	frameDegradation.push_back(mnFrameDegradation);
+
+	if (bMissed || mnFrameDegradation != DEGRADE_NONE)
+	{
+		cout << "---Frame budget " << (bMissed ? "missed" : "kept") << " (" << frameTime <<
+			"ms of " << mdFrameBudgetMs << "ms, extraction " << extractionTime << "ms) - ImageId: " <<
+			mCurrentFrame.mnId << " - degraded:";
+		if (mnFrameDegradation & DEGRADE_LOCAL_POINTS)
+			cout << " local points";
+		if (mnFrameDegradation & DEGRADE_POSE_ITERATIONS)
+			cout << " pose iterations";
+		if (mnFrameDegradation & DEGRADE_FEATURES)
+			cout << " features";
+		if (mnFrameDegradation == DEGRADE_NONE)
+			cout << " nothing";
+		cout << " - level " << mnDegradationLevel << "---" << endl;
+	}
+}
+
+void cTracking::ReleaseBadReferences()
+{
+	if (mState != WORKING && mState != LOST)
+		return;
+
+	// map points culled by local mapping or fused by loop closing
+	for (size_t i = 0; i < mLastFrame.mvpMapPoints.size(); ++i)
+		if (mLastFrame.mvpMapPoints[i] && mLastFrame.mvpMapPoints[i]->isBad())
+			mLastFrame.mvpMapPoints[i] = static_cast<cMapPoint*>(NULL);
+
+	// erased objects are announced before they are retired, so an unchanged
+	// erase version means the local map is still clean
+	const unsigned long eraseVersion = mpMap->GetEraseVersion();
+	if (eraseVersion != mnLocalMapEraseVersion)
+	{
+		mnLocalMapEraseVersion = eraseVersion;
+		// the caches are thrown away anyway if the local map is dirty
+		if (mbLocalMapDirty)
+			mvpLocalMapPoints.erase(std::remove_if(mvpLocalMapPoints.begin(), mvpLocalMapPoints.end(),
+				[](cMapPoint* pMP) { return pMP->isBad(); }), mvpLocalMapPoints.end());
+		else
+			PruneLocalMapCaches();
+		// the map keeps a copy for visualization
+		mpMap->SetReferenceMapPoints(mvpLocalMapPoints);
+	}
+
+	// culled keyframes, the closest good ancestor in the spanning tree takes over
+	while (mpReferenceKF && mpReferenceKF->isBad())
+		mpReferenceKF = mpReferenceKF->GetParent();
+	while (mpLastKeyFrame && mpLastKeyFrame->isBad())
+		mpLastKeyFrame = mpLastKeyFrame->GetParent();
+
+	const bool bWeights = mvpLocalKeyFramesCovWeights.size() == mvpLocalKeyFrames.size();
+	size_t nGood = 0;
+	for (size_t i = 0; i < mvpLocalKeyFrames.size(); ++i)
+	{
+		if (mvpLocalKeyFrames[i]->isBad())
+			continue;
+		mvpLocalKeyFrames[nGood] = mvpLocalKeyFrames[i];
+		if (bWeights)
+		{
+			mvpLocalKeyFramesCovWeights[nGood] = mvpLocalKeyFramesCovWeights[i];
+			mvpLocalKeyFramesDistance2Frame[nGood] = mvpLocalKeyFramesDistance2Frame[i];
+		}
+		++nGood;
+	}
+	mvpLocalKeyFrames.resize(nGood);
+	if (bWeights)
+	{
+		mvpLocalKeyFramesCovWeights.resize(nGood);
+		mvpLocalKeyFramesDistance2Frame.resize(nGood);
+	}
+}
+
 bool cTracking::Track()
 {
     // Depending on the state of the Tracker we perform different tasks
@@ -259,6 +484,7 @@ bool cTracking::Track()
     {
         // System is initialized. Track Frame.
 		bool bOK = false;
+		mbPosePredicted = false;
 		//if (_kbhit())
 		//{
 		//	int ch;
@@ -269,6 +495,7 @@ bool cTracking::Track()
 		//	}
 		//}
         // Initial Camera Pose Estimation from Previous Frame (Motion Model or Coarse) or Relocalisation
+		++nrFramesTracking;
         if (mState == WORKING && !RelocalisationRequested())
         {
 			if (!mbMotionModel || 
@@ -279,13 +506,18 @@ bool cTracking::Track()
 			}
             else
             {
+				++nrMotionModelFrames;
 				bOK = TrackWithMotionModel();
 				if (!bOK)
-					bOK = TrackPreviousFrame();			
+				{
+					++nrPreviousFrameFallbacks;
+					bOK = TrackPreviousFrame();
+				}
             }
         }
         else
         {
+			++nrRelocalisationFrames;
             bOK = Relocalisation();
         }
 		// If we have an initial estimation of the camera pose and matching. Track the local map.
@@ -299,7 +531,8 @@ bool cTracking::Track()
         {
             mpMapPublisher->SetCurrentCameraPose(mCurrentFrame.GetPose());
 			// count tracked points in each cam
-			//CountNumberTrackedPointsPerCam();
+			CountNumberTrackedPointsPerCam();
+			UpdateFeatureDistribution();
 			if (NeedNewKeyFrame())
 				CreateNewKeyFrame();
             // We allow points with high innovation (considererd outliers by the Huber Function)
@@ -337,9 +570,14 @@ bool cTracking::Track()
 				//cv::Matx44d current = mCurrentFrame.GetPose().inv();
 				//mVelocity = current * LastTwc;
 				mVelocity = LastTwc*mCurrentFrame.GetPose();
+				if (mbPosePredicted)
+					UpdatePredictionCovariance();
             }
             else
+            {
                 mVelocity = cv::Matx44d::eye();
+				mnPredictionSamples = 0;
+            }
         }
 
         mLastFrame = cMultiFrame(mCurrentFrame);
@@ -359,7 +597,7 @@ void cTracking::CountNumberTrackedPointsPerCam()
 		nbTrackedPtsInCam[c] = 0;
 
 	for (size_t i = 0; i < mCurrentFrame.mvpMapPoints.size(); ++i)
-		if (mCurrentFrame.mvpMapPoints[i])
+		if (mCurrentFrame.mvpMapPoints[i] && !mCurrentFrame.mvbOutlier[i])
 			++nbTrackedPtsInCam[mCurrentFrame.keypoint_to_cam.find(i)->second];
 
 	// calc ratios
@@ -377,6 +615,96 @@ void cTracking::CountNumberTrackedPointsPerCam()
 	}
 }
 
+void cTracking::UpdateFeatureDistribution()
+{
+	const int nrCams = camSystem.GetNrCams();
+	std::vector<int> nFeaturesInCam(nrCams);
+	for (int c = 0; c < nrCams; ++c)
+		nFeaturesInCam[c] = mCurrentFrame.mDescriptors[c].rows;
+	featuresPerCam.push_back(nFeaturesInCam);
+	inliersPerCam.push_back(nbTrackedPtsInCam);
+
+	if (!mbAdaptiveFeatures || nrCams < 2)
+		return;
+
+	// smoothed inlier yield per camera
+	double sumYield = 0.0;
+	for (int c = 0; c < nrCams; ++c)
+	{
+		const double yield = nFeaturesInCam[c] > 0 ?
+			(double)nbTrackedPtsInCam[c] / (double)nFeaturesInCam[c] : 0.0;
+		mvdInlierYield[c] = 0.7 * mvdInlierYield[c] + 0.3 * yield;
+		sumYield += mvdInlierYield[c];
+	}
+	if (sumYield <= 0.0)
+		return;
+
+	// distribute nrCams shares by the yield (water-filling). Each pass fixes the
+	// cameras beyond one bound only, the side whose clamping moves more budget,
+	// and distributes the rest again among the others. Since
+	// mdFeatureScaleMin <= 1 <= mdFeatureScaleMax the sum stays nrCams
+	std::vector<double> scales(nrCams, 0.0);
+	std::vector<bool> fixed(nrCams, false);
+	for (int it = 0; it < nrCams; ++it)
+	{
+		double free = static_cast<double>(nrCams);
+		double freeYield = 0.0;
+		int nFree = 0;
+		for (int c = 0; c < nrCams; ++c)
+		{
+			if (fixed[c])
+				free -= scales[c];
+			else
+			{
+				freeYield += mvdInlierYield[c];
+				++nFree;
+			}
+		}
+		if (nFree == 0)
+			break;
+
+		// budget added by raising to the lower bound minus the one
+		// removed by cutting at the upper bound
+		double clampBalance = 0.0;
+		for (int c = 0; c < nrCams; ++c)
+		{
+			if (fixed[c])
+				continue;
+			scales[c] = freeYield > 0.0 ? free * mvdInlierYield[c] / freeYield : free / nFree;
+			if (scales[c] < mdFeatureScaleMin)
+				clampBalance += mdFeatureScaleMin - scales[c];
+			else if (scales[c] > mdFeatureScaleMax)
+				clampBalance -= scales[c] - mdFeatureScaleMax;
+		}
+
+		bool bClamped = false;
+		for (int c = 0; c < nrCams; ++c)
+		{
+			if (fixed[c])
+				continue;
+			if (clampBalance >= 0.0 && scales[c] < mdFeatureScaleMin)
+				scales[c] = mdFeatureScaleMin;
+			else if (clampBalance <= 0.0 && scales[c] > mdFeatureScaleMax)
+				scales[c] = mdFeatureScaleMax;
+			else
+				continue;
+			fixed[c] = true;
+			bClamped = true;
+		}
+		if (!bClamped)
+			break;
+	}
+#ifndef NDEBUG
+	double sumScales = 0.0;
+	for (int c = 0; c < nrCams; ++c)
+		sumScales += scales[c];
+	assert(std::fabs(sumScales - nrCams) < 1e-6);
+#endif
+
+	std::unique_lock<std::mutex> lock(mMutexFeatureScales);
+	mvdFeatureScales = scales;
+}
+
 void cTracking::FirstInitialization()
 {
     //We ensure a minimum ORB features to continue, otherwise discard frame
@@ -718,6 +1046,7 @@ void cTracking::CreateInitialMap(cv::Matx33d &Rcw, cv::Vec3d &tcw, int leadingCa
     mvpLocalKeyFrames.push_back(pKFini);
     mvpLocalMapPoints = mpMap->GetAllMapPoints();
     mpReferenceKF = pKFcur;
+    mbLocalMapDirty = true;
 
     mpMap->SetReferenceMapPoints(mvpLocalMapPoints);
 
@@ -807,13 +1136,36 @@ bool cTracking::TrackWithMotionModel()
 	cv::Matx44d pose = mLastFrame.GetPose()*mVelocity;
 	mCurrentFrame.SetPose(pose);
 	//mCurrentFrame.SetPose(mLastFrame.GetPose()*mVelocity);
+	if (mbDirectAlignment)
+	{
+		++nrDirectAlignments;
+		if (cOptimizer::PoseAlignmentDirect(&mCurrentFrame, mLastFrame,
+			mnDirectAlignmentTopLevel, mnDirectAlignmentBottomLevel) > 0)
+		{
+			++nrDirectAlignmentsAccepted;
+			pose = mCurrentFrame.GetPose();
+		}
+	}
+	mPredictedPose = pose;
+	mbPosePredicted = true;
 
     fill(mCurrentFrame.mvpMapPoints.begin(),
 		mCurrentFrame.mvpMapPoints.end(),static_cast<cMapPoint*>(NULL));
 
 	begin = std::chrono::steady_clock::now();
     // Project points seen in previous frame
-	int nmatches = matcher.SearchByProjection(mCurrentFrame, mLastFrame, 50);
+	// the windows follow the prediction uncertainty once there are enough samples of it
+	const bool bAdaptiveWindow = mbAdaptiveSearchWindow && mnPredictionSamples >= 5;
+	int nmatches = bAdaptiveWindow ?
+		matcher.SearchByProjection(mCurrentFrame, mLastFrame, 50, &mPredictionCov, mdMinSearchRadius) :
+		matcher.SearchByProjection(mCurrentFrame, mLastFrame, 50);
+	// the motion was stronger than expected, search again in the full windows
+	if (bAdaptiveWindow && nmatches < 20)
+	{
+		fill(mCurrentFrame.mvpMapPoints.begin(),
+			mCurrentFrame.mvpMapPoints.end(), static_cast<cMapPoint*>(NULL));
+		nmatches = matcher.SearchByProjection(mCurrentFrame, mLastFrame, 50);
+	}
 	end = std::chrono::steady_clock::now();
 
     if (nmatches < 10)
@@ -838,12 +1190,35 @@ bool cTracking::TrackWithMotionModel()
     return nmatches >= 6;
 }
 
+void cTracking::UpdatePredictionCovariance()
+{
+	// pose = predicted pose * E
+	const cv::Matx44d E = cConverter::invMat(mPredictedPose) * mCurrentFrame.GetPose();
+	const cv::Matx33d R(E(0, 0), E(0, 1), E(0, 2),
+		E(1, 0), E(1, 1), E(1, 2),
+		E(2, 0), E(2, 1), E(2, 2));
+	cv::Vec3d w;
+	cv::Rodrigues(R, w);
+	const cv::Matx61d e(w(0), w(1), w(2), E(0, 3), E(1, 3), E(2, 3));
+
+	// plain mean for the first samples, then an exponential average
+	const double alpha = mnPredictionSamples < 5 ? 1.0 / (mnPredictionSamples + 1) : 0.2;
+	mPredictionCov = (1.0 - alpha) * mPredictionCov + alpha * (e * e.t());
+	++mnPredictionSamples;
+}
+
 bool cTracking::TrackLocalMap()
 {
     // Tracking from previous frame or relocalisation was succesfull and we have an estimation
     // of the camera pose and some map points tracked in the frame.
     // Update Local Map and Track
 
+	HResClk::time_point begin = HResClk::now();
+
+	// cut this frame short if there is not enough time left
+	if (mdFrameBudgetMs > 0.0 && RemainingFrameBudget() < mdLastTrackLocalMapTime)
+		mnFrameDegradation |= DEGRADE_LOCAL_POINTS | DEGRADE_POSE_ITERATIONS;
+
     // Update Local Map
     UpdateReference();
 
@@ -852,7 +1227,9 @@ bool cTracking::TrackLocalMap()
 
     // Optimize Pose
 	double inliers = 0.0;
-	mnMatchesInliers = cOptimizer::PoseOptimization(&mCurrentFrame, inliers);
+	const int nPoseIterations = (mnFrameDegradation & DEGRADE_POSE_ITERATIONS) ?
+		mnBudgetPoseIterations : 10;
+	mnMatchesInliers = cOptimizer::PoseOptimization(&mCurrentFrame, inliers, 2, nPoseIterations);
 
     // Update MapPoints Statistics
 	for (size_t i = 0; i < mCurrentFrame.mvpMapPoints.size(); ++i)
@@ -876,6 +1253,9 @@ bool cTracking::TrackLocalMap()
 	curBaseline2MKF = cv::norm(cConverter::Hom2T(mCurrentFrame.GetPose()) -
 		cConverter::Hom2T(mpReferenceKF->GetPose()));
 
+	mdLastTrackLocalMapTime = T_in_ms(begin, HResClk::now());
+	timingTrackLocalMap.push_back(mdLastTrackLocalMapTime);
+
     // Decide if the tracking was succesful
     // More restrictive if there was a relocalization recently
 	if (mCurrentFrame.mnId < mnLastRelocFrameId + mMaxFrames && mnMatchesInliers < 15)
@@ -955,6 +1335,7 @@ void cTracking::CreateNewKeyFrame()
 
     mnLastKeyFrameId = mCurrentFrame.mnId;
     mpLastKeyFrame = pKF;
+    mbLocalMapDirty = true;
 }
 
 // in essence, it is also similar to search local mappoints
@@ -985,19 +1366,54 @@ int cTracking::SearchReferencePointsInFrustum()
 
     int nToMatch=0;
 
+	// under a tight budget only a window of the local map is projected,
+	// it moves on every frame so that all points get their turn
+	const size_t nLocalMapPoints = mvpLocalMapPoints.size();
+	size_t nProjected = nLocalMapPoints;
+	if ((mnFrameDegradation & DEGRADE_LOCAL_POINTS) &&
+		nLocalMapPoints > static_cast<size_t>(mnBudgetMaxLocalPoints))
+	{
+		nProjected = static_cast<size_t>(mnBudgetMaxLocalPoints);
+		mnLocalPointsOffset = (mnLocalPointsOffset + nProjected) % nLocalMapPoints;
+	}
+
+	const int nCams = mCurrentFrame.camSystem.GetNrCams();
+	const int nCulledKeyFrames = CullLocalMapPoints();
+	int nTested = 0;
+	int nCulled = 0;
+
     // Project points in frame and check its visibility
-    for(vector<cMapPoint*>::iterator vit=mvpLocalMapPoints.begin(), vend=mvpLocalMapPoints.end();
-		vit != vend; ++vit)
+    for (size_t k = 0; k < nLocalMapPoints; ++k)
     {
-        cMapPoint* pMP = *vit;
+        cMapPoint* pMP = mvpLocalMapPoints[k];
         if(pMP->mnLastFrameSeen == mCurrentFrame.mnId)
             continue;
+		// outside of the window, the matcher must not use an old projection
+		if ((k + nLocalMapPoints - mnLocalPointsOffset) % nLocalMapPoints >= nProjected)
+		{
+			for (int c = 0; c < nCams; ++c)
+				pMP->mbTrackInView[c] = false;
+			continue;
+		}
         if(pMP->isBad())
             continue;        
+		int nRefs = 0;
         // Project (this fills MapPoint variables for matching)
 		// project it in each camera
-		for (int c = 0; c < mCurrentFrame.camSystem.GetNrCams(); ++c)
+		for (int c = 0; c < nCams; ++c)
 		{
+			if (nCulledKeyFrames > 0 && mvnCulledKeyFrames[k * nCams + c] > 0)
+			{
+				if (nRefs == 0)
+					nRefs = mLocalMapPointRefs.find(pMP)->second.first;
+				if (mvnCulledKeyFrames[k * nCams + c] == nRefs)
+				{
+					pMP->mbTrackInView[c] = false;
+					++nCulled;
+					continue;
+				}
+			}
+			++nTested;
 			if (mCurrentFrame.isInFrustum(c, pMP, 0.3))
 			{
 				pMP->IncreaseVisible();
@@ -1005,6 +1421,8 @@ int cTracking::SearchReferencePointsInFrustum()
 			}
 		}
 	}    
+	nrProjectionsTested.push_back(nTested);
+	nrProjectionsCulled.push_back(nCulled);
 
     if (nToMatch > 0)
     {
@@ -1019,39 +1437,243 @@ int cTracking::SearchReferencePointsInFrustum()
 	return nrMatches;
 }
 
+int cTracking::CullLocalMapPoints()
+{
+	const int nCams = mCurrentFrame.camSystem.GetNrCams();
+	mvnCulledKeyFrames.assign(mvpLocalMapPoints.size() * nCams, 0);
+
+	// bounds of the last frames are valid as long as no point moved
+	const unsigned long version = mpMap->GetGeometryVersion();
+	if (version != mnLocalBoundsVersion)
+	{
+		mLocalKeyFrameBounds.clear();
+		mnLocalBoundsVersion = version;
+	}
+
+	// same camera centers as in cMultiFrame::isInFrustum
+	std::vector<cv::Vec3d> vCenters(nCams);
+	for (int c = 0; c < nCams; ++c)
+	{
+		const cv::Matx44d Tcw = mCurrentFrame.camSystem.Get_MtMc(c);
+		vCenters[c] = cv::Vec3d(Tcw(0, 3), Tcw(1, 3), Tcw(2, 3));
+	}
+
+	int nCulledKeyFrames = 0;
+	for (unordered_map<cMultiKeyFrame*, vector<cMapPoint*> >::iterator itKF = mLocalKeyFramePoints.begin();
+		itKF != mLocalKeyFramePoints.end(); ++itKF)
+	{
+		const vector<cMapPoint*>& vpMPs = itKF->second;
+		if (vpMPs.empty())
+			continue;
+		unordered_map<cMultiKeyFrame*, sLocalKeyFrameBounds>::iterator itBounds =
+			mLocalKeyFrameBounds.find(itKF->first);
+		if (itBounds == mLocalKeyFrameBounds.end())
+		{
+			itBounds = mLocalKeyFrameBounds.insert(
+				std::make_pair(itKF->first, sLocalKeyFrameBounds())).first;
+			ComputeLocalKeyFrameBounds(vpMPs, itBounds->second);
+		}
+		const sLocalKeyFrameBounds& bounds = itBounds->second;
+
+		for (int c = 0; c < nCams; ++c)
+		{
+			// every point is between d - radius and d + radius away from the camera,
+			// the tolerance covers rounding, culling has to be conservative
+			const double d = cv::norm(vCenters[c] - bounds.center);
+			const double tol = 1e-9 * (d + bounds.radius) + 1e-12;
+			if (d - bounds.radius - tol <= bounds.maxDistance &&
+				d + bounds.radius + tol >= bounds.minDistance)
+				continue;
+			++nCulledKeyFrames;
+			for (size_t i = 0; i < vpMPs.size(); ++i)
+			{
+				unordered_map<cMapPoint*, std::pair<int, size_t> >::iterator itRef =
+					mLocalMapPointRefs.find(vpMPs[i]);
+				if (itRef != mLocalMapPointRefs.end())
+					++mvnCulledKeyFrames[itRef->second.second * nCams + c];
+			}
+		}
+	}
+	return nCulledKeyFrames;
+}
+
+void cTracking::ComputeLocalKeyFrameBounds(const std::vector<cMapPoint*>& vpMPs,
+	sLocalKeyFrameBounds& bounds)
+{
+	std::vector<cv::Vec3d> vPos(vpMPs.size());
+	cv::Vec3d center(0.0, 0.0, 0.0);
+	bounds.minDistance = std::numeric_limits<double>::max();
+	bounds.maxDistance = 0.0;
+	for (size_t i = 0; i < vpMPs.size(); ++i)
+	{
+		vPos[i] = vpMPs[i]->GetWorldPos();
+		center += vPos[i];
+		bounds.minDistance = std::min(bounds.minDistance, vpMPs[i]->GetMinDistanceInvariance());
+		bounds.maxDistance = std::max(bounds.maxDistance, vpMPs[i]->GetMaxDistanceInvariance());
+	}
+	center *= 1.0 / static_cast<double>(vPos.size());
+
+	double radius = 0.0;
+	for (size_t i = 0; i < vPos.size(); ++i)
+		radius = std::max(radius, cv::norm(vPos[i] - center));
+	bounds.center = center;
+	bounds.radius = radius;
+}
+
 void cTracking::UpdateReference()
 {    
     // This is for visualization
     mpMap->SetReferenceMapPoints(mvpLocalMapPoints);
 
+	// keep the local map from the last frame unless a keyframe was added to the map
+	// or one of the local keyframes changed its matches or observations meanwhile
+	const unsigned int maxKFid = mpMap->GetMaxKFid();
+	bool bRebuild = mbLocalMapDirty || maxKFid != mnLocalMapMaxKFid;
+	for (unordered_map<cMultiKeyFrame*, vector<cMapPoint*> >::const_iterator itKF = mLocalKeyFramePoints.begin();
+		!bRebuild && itKF != mLocalKeyFramePoints.end(); ++itKF)
+		bRebuild = itKF->first->GetObservationVersion() != itKF->first->mnTrackObservationVersion;
+	if (bRebuild)
+	{
+		ClearLocalMapCaches();
+		mvpLocalMapPoints.clear();
+		mnLocalMapMaxKFid = maxKFid;
+		mbLocalMapDirty = false;
+		++nrLocalMapRebuilt;
+	}
+	else
+		++nrLocalMapReused;
+
     // Update
     UpdateReferenceKeyFrames();
     UpdateReferencePoints();
 }
 
+void cTracking::ClearLocalMapCaches()
+{
+	mLocalKeyFrameVotes.clear();
+	mLocalMapVoters.clear();
+	mLocalKeyFramePoints.clear();
+	mLocalMapPointRefs.clear();
+	mLocalKeyFrameBounds.clear();
+}
+
+// drops the map points and keyframes that turned bad from the caches,
+// so they can be kept until the next rebuild
+void cTracking::PruneLocalMapCaches()
+{
+	// bad points give back their votes, bad keyframes lose theirs
+	for (unordered_map<cMapPoint*, sLocalMapVoter>::iterator itVoter = mLocalMapVoters.begin();
+		itVoter != mLocalMapVoters.end();)
+	{
+		sLocalMapVoter& voter = itVoter->second;
+		if (itVoter->first->isBad())
+		{
+			for (size_t k = 0; k < voter.vpKFs.size(); ++k)
+				mLocalKeyFrameVotes[voter.vpKFs[k]] -= voter.nVotes;
+			itVoter = mLocalMapVoters.erase(itVoter);
+			continue;
+		}
+		voter.vpKFs.erase(std::remove_if(voter.vpKFs.begin(), voter.vpKFs.end(),
+			[](cMultiKeyFrame* pKF) { return pKF->isBad(); }), voter.vpKFs.end());
+		++itVoter;
+	}
+	for (map<cMultiKeyFrame*, int>::iterator it = mLocalKeyFrameVotes.begin(); it != mLocalKeyFrameVotes.end();)
+	{
+		if (it->first->isBad())
+			it = mLocalKeyFrameVotes.erase(it);
+		else
+			++it;
+	}
+
+	// bad keyframes leave the local map with their points, the others drop their bad points
+	for (unordered_map<cMultiKeyFrame*, vector<cMapPoint*> >::iterator itKF = mLocalKeyFramePoints.begin();
+		itKF != mLocalKeyFramePoints.end();)
+	{
+		vector<cMapPoint*>& vpMPs = itKF->second;
+		const bool bBadKF = itKF->first->isBad();
+		size_t nGood = 0;
+		for (size_t i = 0; i < vpMPs.size(); ++i)
+		{
+			if (bBadKF || vpMPs[i]->isBad())
+				RemoveLocalMapPoint(vpMPs[i]);
+			else
+				vpMPs[nGood++] = vpMPs[i];
+		}
+		vpMPs.resize(nGood);
+		if (bBadKF)
+		{
+			mLocalKeyFrameBounds.erase(itKF->first);
+			itKF = mLocalKeyFramePoints.erase(itKF);
+		}
+		else
+			++itKF;
+	}
+}
+
+void cTracking::AddLocalMapPoint(cMapPoint* pMP)
+{
+	std::pair<int, size_t>& ref = mLocalMapPointRefs[pMP];
+	if (ref.first++ == 0)
+	{
+		ref.second = mvpLocalMapPoints.size();
+		mvpLocalMapPoints.push_back(pMP);
+	}
+}
+
+void cTracking::RemoveLocalMapPoint(cMapPoint* pMP)
+{
+	unordered_map<cMapPoint*, std::pair<int, size_t> >::iterator it = mLocalMapPointRefs.find(pMP);
+	if (it == mLocalMapPointRefs.end() || --it->second.first > 0)
+		return;
+	// move the last point into the hole
+	const size_t pos = it->second.second;
+	cMapPoint* pLast = mvpLocalMapPoints.back();
+	mvpLocalMapPoints[pos] = pLast;
+	mLocalMapPointRefs[pLast].second = pos;
+	mvpLocalMapPoints.pop_back();
+	mLocalMapPointRefs.erase(it);
+}
+
 // although the func name is changed, in essence, there are all used for local map
 void cTracking::UpdateReferencePoints()
 {
-    mvpLocalMapPoints.clear();
+	// keyframes that left the local map take their points with them
+	for (unordered_map<cMultiKeyFrame*, vector<cMapPoint*> >::iterator itKF = mLocalKeyFramePoints.begin();
+		itKF != mLocalKeyFramePoints.end();)
+	{
+		if (itKF->first->mnTrackReferenceForFrame == mCurrentFrame.mnId)
+		{
+			++itKF;
+			continue;
+		}
+		for (size_t i = 0; i < itKF->second.size(); ++i)
+			RemoveLocalMapPoint(itKF->second[i]);
+		mLocalKeyFrameBounds.erase(itKF->first);
+		itKF = mLocalKeyFramePoints.erase(itKF);
+	}
 
+	// new local keyframes add theirs
 	for (vector<cMultiKeyFrame*>::iterator itKF = mvpLocalKeyFrames.begin(),
 		itEndKF = mvpLocalKeyFrames.end(); itKF != itEndKF; ++itKF)
     {
 		cMultiKeyFrame* pKF = *itKF;
+		if (mLocalKeyFramePoints.count(pKF))
+			continue;
+		// before the matches, a change in between triggers the next rebuild
+		pKF->mnTrackObservationVersion = pKF->GetObservationVersion();
         vector<cMapPoint*> vpMPs = pKF->GetMapPointMatches();
 
+		vector<cMapPoint*>& vpLocalMPs = mLocalKeyFramePoints[pKF];
         for(vector<cMapPoint*>::iterator itMP = vpMPs.begin(), itEndMP = vpMPs.end(); 
 			itMP != itEndMP; ++itMP)
         {
             cMapPoint* pMP = *itMP;
             if(!pMP)
                 continue;
-            if(pMP->mnTrackReferenceForFrame == mCurrentFrame.mnId)
-                continue;
             if(!pMP->isBad())
             {
-                mvpLocalMapPoints.push_back(pMP);
-                pMP->mnTrackReferenceForFrame = mCurrentFrame.mnId;
+				vpLocalMPs.push_back(pMP);
+				AddLocalMapPoint(pMP);
             }
         }
     }
@@ -1062,8 +1684,8 @@ void cTracking::UpdateReferencePoints()
 void cTracking::UpdateReferenceKeyFrames()
 {
     // Each map point vote for the keyframes in which it has been observed
-	// each map point that was found in the the current frame
-	map<cMultiKeyFrame*, int> keyframeCounter;
+	// each map point that was found in the the current frame.
+	// Only points that were not tracked in the last frame need their observations.
 	for (size_t i = 0, iend = mCurrentFrame.mvpMapPoints.size(); i<iend; ++i)
     {
         if (mCurrentFrame.mvpMapPoints[i])
@@ -1071,14 +1693,27 @@ void cTracking::UpdateReferenceKeyFrames()
             cMapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
             if (!pMP->isBad())
             {
-				map<cMultiKeyFrame*, std::vector<size_t>> observations = pMP->GetObservations();
-				for (map<cMultiKeyFrame*, std::vector<size_t>>::iterator it = observations.begin(),
-					itend = observations.end(); it != itend; it++)
+				unordered_map<cMapPoint*, sLocalMapVoter>::iterator itVoter = mLocalMapVoters.find(pMP);
+				if (itVoter == mLocalMapVoters.end())
 				{
-					//keyframeCounter[it->first] += static_cast<int>(it->second.size());
-					keyframeCounter[it->first]++;
+					sLocalMapVoter voter;
+					map<cMultiKeyFrame*, std::vector<size_t>> observations = pMP->GetObservations();
+					voter.vpKFs.reserve(observations.size());
+					for (map<cMultiKeyFrame*, std::vector<size_t>>::iterator it = observations.begin(),
+						itend = observations.end(); it != itend; it++)
+						voter.vpKFs.push_back(it->first);
+					voter.nVotes = 0;
+					voter.nSeen = 0;
+					voter.nLastFrame = mCurrentFrame.mnId;
+					itVoter = mLocalMapVoters.insert(std::make_pair(pMP, voter)).first;
 				}
-
+				sLocalMapVoter& voter = itVoter->second;
+				if (voter.nLastFrame != mCurrentFrame.mnId)
+				{
+					voter.nLastFrame = mCurrentFrame.mnId;
+					voter.nSeen = 0;
+				}
+				++voter.nSeen;
             }
             else
             {
@@ -1087,30 +1722,52 @@ void cTracking::UpdateReferenceKeyFrames()
         }
     }
 
+	// apply the difference to the last frame
+	for (unordered_map<cMapPoint*, sLocalMapVoter>::iterator itVoter = mLocalMapVoters.begin();
+		itVoter != mLocalMapVoters.end();)
+	{
+		sLocalMapVoter& voter = itVoter->second;
+		if (voter.nLastFrame != mCurrentFrame.mnId)
+			voter.nSeen = 0;
+		const int diff = voter.nSeen - voter.nVotes;
+		if (diff != 0)
+		{
+			for (size_t k = 0; k < voter.vpKFs.size(); ++k)
+				mLocalKeyFrameVotes[voter.vpKFs[k]] += diff;
+			voter.nVotes = voter.nSeen;
+		}
+		if (voter.nVotes == 0)
+			itVoter = mLocalMapVoters.erase(itVoter);
+		else
+			++itVoter;
+	}
+
     int max = 0;
 	cMultiKeyFrame* pKFmax = NULL;
 
     mvpLocalKeyFrames.clear();
 	mvpLocalKeyFramesCovWeights.clear();
 	mvpLocalKeyFramesDistance2Frame.clear();
-    mvpLocalKeyFrames.reserve(3*keyframeCounter.size());
+    mvpLocalKeyFrames.reserve(mLocalKeyFrameVotes.size());
 
     // All keyframes that observe a map point are included in the local map. 
 	// Also check which keyframe shares most points
-	for (map<cMultiKeyFrame*, int>::iterator it = keyframeCounter.begin(), 
-		itEnd = keyframeCounter.end();it != itEnd; ++it)
+	for (map<cMultiKeyFrame*, int>::iterator it = mLocalKeyFrameVotes.begin(), 
+		itEnd = mLocalKeyFrameVotes.end();it != itEnd;)
     {
 		cMultiKeyFrame* pKF = it->first;
+		if (it->second == 0)
+		{
+			it = mLocalKeyFrameVotes.erase(it);
+			continue;
+		}
 		pKF->SetReference(false); // set reference to false, only to display reference
 		// if the keyframe counter is above 2
 		// this effectively controls how fast the tracker "forgets" 
 		// map points that are probably not visible any more
 		// the higher the threshold the smaller the local map
-		if (it->second > 4)
+		if (it->second > 4 && !pKF->isBad())
 		{
-			if (pKF->isBad())
-				continue;
-
 			if (it->second > max)
 			{
 				max = it->second;
@@ -1127,6 +1784,7 @@ void cTracking::UpdateReferenceKeyFrames()
 		
 			pKF->mnTrackReferenceForFrame = mCurrentFrame.mnId;
 		}
+		++it;
     }
 
 	mpReferenceKF->SetReference(true);
@@ -1163,101 +1821,75 @@ bool cTracking::Relocalisation()
         return false;
 
     const int nKFs = vpCandidateKFs.size();
-	// same as single-camera slam
-    // We perform first an ORB matching with each candidate
-    // If enough matches are found we setup a PnP solver
-	cORBmatcher matcher(0.9, checkOrientation, mCurrentFrame.DescDims(), mCurrentFrame.HavingMasks());
 
-	// start the use of opengv
-	// it seems reasonable to me to have a extra algorithm specific for multi-camera use cases
-	// TODO it's worthwhile to investigate this algorithm, or we can just use it (check license)
-	vector<opengv::bearingVectors_t> matchedBearingVecs(nKFs);
-	vector<opengv::points_t> points3D(nKFs);
+	// The candidates are evaluated in parallel, each on its own copy of the frame.
+	// Candidate i wins if it is the first in the candidate order that succeeds,
+	// just like in the sequential loop, so the result does not depend on timing.
+	// Once a candidate succeeded, all later ones give up at their next stage.
 	opengv::translations_t camOffsets = camSystem.Get_All_t_c_ogv();
 	opengv::rotations_t camRotations = camSystem.Get_All_R_c_ogv();
-	std::vector<std::vector<int> > camCorrespondences(nKFs);
 
-	vector<int> indices_ransac_to_mp(nKFs);
-	vector<vector<int>> mvKeyPointIndices(nKFs, vector<int>());
+	std::atomic<int> nBestCandidate(nKFs);
+	vector<cMultiFrame*> vpCandidateFrames(nKFs, static_cast<cMultiFrame*>(NULL));
+	const HResClk::time_point tStart = HResClk::now();
 
-    vector<vector<cMapPoint*> > vvpMapPointMatches;
-    vvpMapPointMatches.resize(nKFs);
-
-    vector<bool> vbDiscarded;
-    vbDiscarded.resize(nKFs);
-
-    int nCandidates = 0;
-
-	for (size_t i = 0; i < vpCandidateKFs.size(); ++i)
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(nKFs, omp_get_max_threads()))
+	for (int i = 0; i < nKFs; ++i)
     {
-        cMultiKeyFrame* pKF = vpCandidateKFs[i];
-        if (pKF->isBad())
-            vbDiscarded[i] = true;
-        else
-        {
-            int nmatches = matcher.SearchByBoW(pKF,mCurrentFrame,vvpMapPointMatches[i]);
-            if (nmatches < 15)
-            {
-                vbDiscarded[i] = true;
-                continue;
-            }
-			// in orbslam2, here it will construct pnp_solver
-			// TODO will have specify data from difference cameras?
-            else
-            {
-				// bearing vectors
-				opengv::bearingVectors_t mvP2D; 
-				// 3D Points
-				opengv::points_t mvP3Dw;
-				// get points
-				int idx = 0;
-				for (size_t j = 0, iend = vvpMapPointMatches[i].size(); j < iend; ++j)
-				{
-					cMapPoint* pMP = vvpMapPointMatches[i][j];
-
-					if (pMP)
-					{
-						if (!pMP->isBad())
-						{
-							const cv::Vec3d &kpRay = mCurrentFrame.mvKeysRays[j];
-							mvP2D.push_back(opengv::bearingVector_t(kpRay(0), kpRay(1), kpRay(2)));
-
-							cv::Vec3d Pos = pMP->GetWorldPos();
-							mvP3Dw.push_back(opengv::point_t(Pos(0), Pos(1), Pos(2)));
-							mvKeyPointIndices[i].push_back(j);
-							int cam = mCurrentFrame.keypoint_to_cam.find(j)->second;
-							camCorrespondences[i].push_back(cam);
-							++idx;
-						}
-					}
-				}
-				matchedBearingVecs[i] = mvP2D;
-				points3D[i] = mvP3Dw;
-				// setup an adapter for each keyframe we are trying
-
-				++nCandidates;
-            }
-        }        
-    }
+		// gives up if an earlier candidate already won or the budget is used up
+		auto bCancelled = [&]()
+		{
+			return nBestCandidate < i || (mdRelocBudgetMs > 0.0 &&
+				T_in_ms(tStart, HResClk::now()) > mdRelocBudgetMs);
+		};
 
-    bool bMatch = false;
-	cORBmatcher matcher2(0.9, checkOrientation, mCurrentFrame.DescDims(), mCurrentFrame.HavingMasks());
+        cMultiKeyFrame* pKF = vpCandidateKFs[i];
+        if (pKF->isBad() || bCancelled())
+			continue;
 
-	for (size_t i = 0; i < vpCandidateKFs.size(); i++)
-	{
-		if (vbDiscarded[i])
+		// same as single-camera slam
+		// We perform first an ORB matching with each candidate
+		// If enough matches are found we setup a PnP solver
+		cORBmatcher matcher(0.9, checkOrientation, mCurrentFrame.DescDims(), mCurrentFrame.HavingMasks());
+		vector<cMapPoint*> vpMapPointMatches;
+        int nmatches = matcher.SearchByBoW(pKF, mCurrentFrame, vpMapPointMatches);
+        if (nmatches < 15 || bCancelled())
 			continue;
 
-		vector<bool> vbInliers;
-		vector<int> inliers;
+		// start the use of opengv
+		// it seems reasonable to me to have a extra algorithm specific for multi-camera use cases
+		// TODO it's worthwhile to investigate this algorithm, or we can just use it (check license)
+		// bearing vectors
+		opengv::bearingVectors_t mvP2D; 
+		// 3D Points
+		opengv::points_t mvP3Dw;
+		std::vector<int> camCorrespondences;
+		vector<int> mvKeyPointIndices;
+		for (size_t j = 0, iend = vpMapPointMatches.size(); j < iend; ++j)
+		{
+			cMapPoint* pMP = vpMapPointMatches[j];
 
-		int nInliers;
-		bool bNoMore;
+			if (pMP)
+			{
+				if (!pMP->isBad())
+				{
+					const cv::Vec3d &kpRay = mCurrentFrame.mvKeysRays[j];
+					mvP2D.push_back(opengv::bearingVector_t(kpRay(0), kpRay(1), kpRay(2)));
+
+					cv::Vec3d Pos = pMP->GetWorldPos();
+					mvP3Dw.push_back(opengv::point_t(Pos(0), Pos(1), Pos(2)));
+					mvKeyPointIndices.push_back(j);
+					int cam = mCurrentFrame.keypoint_to_cam.find(j)->second;
+					camCorrespondences.push_back(cam);
+				}
+			}
+		}
 
+		// setup an adapter for each keyframe we are trying
 		opengv::absolute_pose::NoncentralAbsoluteAdapter adapter(
-			matchedBearingVecs[i],
-			camCorrespondences[i],
-			points3D[i],
+			mvP2D,
+			camCorrespondences,
+			mvP3Dw,
 			camOffsets,
 			camRotations);
 #undef max
@@ -1275,56 +1907,50 @@ bool cTracking::Relocalisation()
 		ransac.max_iterations_ = 150;
 
 		ransac.computeModel();
-		inliers = ransac.inliers_;
-		opengv::transformation_t trafo = ransac.model_coefficients_;
-		
+		const vector<int>& inliers = ransac.inliers_;
 
 		// If Ransac reaches max. iterations discard keyframe
-		if (ransac.iterations_ >= ransac.max_iterations_)
-		{
-			vbDiscarded[i] = true;
-			--nCandidates;
-		}
-		else
-		{
-			// this is the core algorithm used! TODO investigate GPNP
-			// GPNP focuses on multi-camera non-central absolute pose problem
-			trafo = opengv::absolute_pose::gpnp(adapter, ransac.inliers_);
+		if (ransac.iterations_ >= ransac.max_iterations_ || bCancelled())
+			continue;
 
-			cv::Matx44d trafoOut = cConverter::ogv2ocv(trafo);
+		// this is the core algorithm used! TODO investigate GPNP
+		// GPNP focuses on multi-camera non-central absolute pose problem
+		opengv::transformation_t trafo = opengv::absolute_pose::gpnp(adapter, inliers);
 
-			mCurrentFrame.SetPose(trafoOut);
-			set<cMapPoint*> sFound;
+		cv::Matx44d trafoOut = cConverter::ogv2ocv(trafo);
 
-			for (int ii = 0; ii < mCurrentFrame.mvpMapPoints.size(); ++ii)
-				mCurrentFrame.mvpMapPoints[ii] = NULL;
+		cMultiFrame* pFrame = new cMultiFrame(mCurrentFrame);
+		vpCandidateFrames[i] = pFrame;
+		pFrame->SetPose(trafoOut);
 
-			for (size_t j = 0; j < inliers.size(); ++j)
-			{
-				mCurrentFrame.mvpMapPoints[mvKeyPointIndices[i][inliers[j]]] =
-					vvpMapPointMatches[i][mvKeyPointIndices[i][inliers[j]]];
-				sFound.insert(vvpMapPointMatches[i][mvKeyPointIndices[i][inliers[j]]]);
-			}
-			double inliers = 0.0;
-			int nGood = cOptimizer::PoseOptimization(&mCurrentFrame, inliers);
+		for (int ii = 0; ii < pFrame->mvpMapPoints.size(); ++ii)
+			pFrame->mvpMapPoints[ii] = NULL;
 
-			if (nGood < 10)
-				continue;
+		for (size_t j = 0; j < inliers.size(); ++j)
+			pFrame->mvpMapPoints[mvKeyPointIndices[inliers[j]]] =
+				vpMapPointMatches[mvKeyPointIndices[inliers[j]]];
 
-			for (size_t io = 0, ioend = mCurrentFrame.mvbOutlier.size(); io < ioend; ++io)
-				if (mCurrentFrame.mvbOutlier[io])
-					mCurrentFrame.mvpMapPoints[io] = NULL;
+		double inlierRatio = 0.0;
+		int nGood = cOptimizer::PoseOptimization(pFrame, inlierRatio);
 
-			// If the pose is supported by enough inliers stop ransacs and continue
-			if (nGood >= 10)
-			{
-				bMatch = true;
-				break;
-			}
-		}
+		if (nGood < 10)
+			continue;
 
+		for (size_t io = 0, ioend = pFrame->mvbOutlier.size(); io < ioend; ++io)
+			if (pFrame->mvbOutlier[io])
+				pFrame->mvpMapPoints[io] = NULL;
+
+		// If the pose is supported by enough inliers stop ransacs and continue
+		int nBest = nBestCandidate;
+		while (i < nBest && !nBestCandidate.compare_exchange_weak(nBest, i));
 	}
 
+	const bool bMatch = nBestCandidate < nKFs;
+	if (bMatch)
+		mCurrentFrame = *vpCandidateFrames[nBestCandidate];
+	for (int i = 0; i < nKFs; ++i)
+		delete vpCandidateFrames[i];
+
     if(!bMatch)
     {
         return false;
@@ -1332,6 +1958,7 @@ bool cTracking::Relocalisation()
     else
     {
         mnLastRelocFrameId = mCurrentFrame.mnId;
+        mbLocalMapDirty = true;
         return true;
     }
 
@@ -1342,6 +1969,8 @@ void cTracking::ForceRelocalisation()
     std::unique_lock<std::mutex> lock(mMutexForceRelocalisation);
     mbForceRelocalisation = true;
     mnLastRelocFrameId = mCurrentFrame.mnId;
+    // called after a loop correction
+    mbLocalMapDirty = true;
 }
 
 bool cTracking::RelocalisationRequested()
@@ -1379,6 +2008,15 @@ void cTracking::Reset()
 	cMultiKeyFrame::nNextId = 0;
 	cMultiFrame::nNextId = 0;
 	mState = NO_IMAGES_YET;
+	mbUseInitExtractor = true;
+	ClearLocalMapCaches();
+	mbLocalMapDirty = true;
+	mvdInlierYield = std::vector<double>(numberCameras, 0.0);
+	mnPredictionSamples = 0;
+	{
+		std::unique_lock<std::mutex> lock(mMutexFeatureScales);
+		mvdFeatureScales = std::vector<double>(numberCameras, 1.0);
+	}
 
 	if (mpInitializer)
 	{
@@ -1397,7 +2035,21 @@ void cTracking::Reset()
 	timingFeatureExtraction.clear();
 	timingTrackLocalMap.clear();
 	timingInitalPoseEst.clear();
-
+	timingFrame.clear();
+	frameBudgetMissed.clear();
+	frameDegradation.clear();
+	nrProjectionsTested.clear();
+	nrProjectionsCulled.clear();
+	featuresPerCam.clear();
+	inliersPerCam.clear();
+	nrFramesTracking = 0;
+	nrMotionModelFrames = 0;
+	nrPreviousFrameFallbacks = 0;
+	nrRelocalisationFrames = 0;
+	nrDirectAlignments = 0;
+	nrDirectAlignmentsAccepted = 0;
+	nrLocalMapReused = 0;
+	nrLocalMapRebuilt = 0;
 }
 
 void cTracking::CheckResetByPublishers()
@@ -0,0 +1,255 @@
+/**
+* This file is part of MultiCol-SLAM
+*
+* Copyright (C) 2015-2016 Steffen Urban <urbste at googlemail.com>
+* For more information see <https://github.com/urbste/MultiCol-SLAM>
+*
+* MultiCol-SLAM is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* MultiCol-SLAM is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with MultiCol-SLAM . If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cTrackingPipeline.h"
+#include "cSystem.h"
+#include "cTracking.h"
+
+#include <exception>
+#include <stdexcept>
+
+namespace MultiColSLAM
+{
+	cTrackingPipeline::cTrackingPipeline(cSystem* pSys, cTracking* pTracker,
+		const size_t& inputQueueSize,
+		const eDropPolicy& dropPolicy,
+		const int& keepEveryK) :
+		mpSystem(pSys),
+		mpTracker(pTracker),
+		mqImageSets(inputQueueSize),
+		mqFrames(1),
+		meDropPolicy(dropPolicy),
+		mnKeepEveryK(keepEveryK > 0 ? keepEveryK : 1),
+		mnOverloadCount(0),
+		mnResets(0),
+		mbFinished(false)
+	{
+		mnSubmitted = 0;
+		mnDropped = 0;
+		mnProcessed = 0;
+		mnMaxQueueDepth = 0;
+		mptExtraction = new std::thread(&cTrackingPipeline::RunExtraction, this);
+		mptTracking = new std::thread(&cTrackingPipeline::RunTracking, this);
+	}
+
+	cTrackingPipeline::~cTrackingPipeline()
+	{
+		Finish();
+	}
+
+	cTrackingPipeline::sImageSet cTrackingPipeline::MakeImageSet(
+		const std::vector<cv::Mat>& imgSet,
+		const double& timestamp,
+		std::future<cv::Matx44d>* pPose)
+	{
+		sImageSet imageSet;
+		imageSet.images = imgSet;
+		imageSet.timestamp = timestamp;
+		if (pPose)
+			*pPose = imageSet.pose.get_future();
+		++mnSubmitted;
+		return imageSet;
+	}
+
+	void cTrackingPipeline::Dropped(sImageSet& imageSet)
+	{
+		++mnDropped;
+		// only throws at the caller if somebody waits for this frame
+		imageSet.pose.set_exception(std::make_exception_ptr(
+			std::runtime_error("image set dropped by the tracking pipeline")));
+	}
+
+	std::future<cv::Matx44d> cTrackingPipeline::Submit(
+		const std::vector<cv::Mat>& imgSet,
+		const double& timestamp)
+	{
+		std::future<cv::Matx44d> pose;
+		sImageSet imageSet = MakeImageSet(imgSet, timestamp, &pose);
+		// a failed push leaves the image set untouched
+		if (!mqImageSets.Push(std::move(imageSet)))
+			imageSet.pose.set_exception(std::make_exception_ptr(
+				std::runtime_error("tracking pipeline already finished")));
+		return pose;
+	}
+
+	bool cTrackingPipeline::TrySubmit(
+		const std::vector<cv::Mat>& imgSet,
+		const double& timestamp)
+	{
+		std::unique_lock<std::mutex> lock(mMutexSubmit);
+		sImageSet imageSet = MakeImageSet(imgSet, timestamp, NULL);
+
+		bool bQueued = mqImageSets.TryPush(std::move(imageSet));
+		if (bQueued)
+			mnOverloadCount = 0;
+		else if (meDropPolicy == DROP_NEWEST ||
+			(meDropPolicy == KEEP_EVERY_KTH && ++mnOverloadCount % mnKeepEveryK != 0))
+		{
+			Dropped(imageSet);
+		}
+		else
+		{
+			sImageSet evicted;
+			bool bEvicted = false;
+			bQueued = mqImageSets.PushEvictOldest(std::move(imageSet), evicted, bEvicted);
+			if (bEvicted)
+				Dropped(evicted);
+			if (!bQueued)
+				Dropped(imageSet);
+		}
+
+		const size_t depth = mqImageSets.Size();
+		if (depth > mnMaxQueueDepth)
+			mnMaxQueueDepth = depth;
+		return bQueued;
+	}
+
+	void cTrackingPipeline::SetPoseCallback(const PoseCallback& callback)
+	{
+		std::unique_lock<std::mutex> lock(mMutexResults);
+		mPoseCallback = callback;
+	}
+
+	bool cTrackingPipeline::PollPose(sPoseResult& result)
+	{
+		std::unique_lock<std::mutex> lock(mMutexResults);
+		if (mqResults.empty())
+			return false;
+		result = mqResults.front();
+		mqResults.pop_front();
+		return true;
+	}
+
+	void cTrackingPipeline::Publish(const sPoseResult& result)
+	{
+		std::unique_lock<std::mutex> lock(mMutexResults);
+		if (mPoseCallback)
+		{
+			// called without the lock, it may poll or replace itself
+			// and a slow callback does not block PollPose
+			const PoseCallback callback = mPoseCallback;
+			lock.unlock();
+			callback(result);
+			return;
+		}
+		mqResults.push_back(result);
+		if (mqResults.size() > kMaxPolledResults)
+			mqResults.pop_front();
+	}
+
+	cTrackingPipeline::sIngestionStats cTrackingPipeline::GetStats()
+	{
+		sIngestionStats stats;
+		stats.nSubmitted = mnSubmitted;
+		stats.nDropped = mnDropped;
+		stats.nProcessed = mnProcessed;
+		stats.nQueueDepth = mqImageSets.Size();
+		stats.nMaxQueueDepth = mnMaxQueueDepth;
+		return stats;
+	}
+
+	void cTrackingPipeline::Finish()
+	{
+		std::unique_lock<std::mutex> lock(mMutexFinish);
+		if (mbFinished)
+			return;
+		// the extraction thread drains the image queue and then closes the frame queue
+		mqImageSets.Close();
+		mptExtraction->join();
+		mptTracking->join();
+		delete mptExtraction;
+		delete mptTracking;
+		mbFinished = true;
+	}
+
+	void cTrackingPipeline::RunExtraction()
+	{
+		sImageSet imageSet;
+		while (mqImageSets.Pop(imageSet))
+		{
+			sFrame frame;
+			frame.timestamp = imageSet.timestamp;
+			frame.pose = std::move(imageSet.pose);
+			try
+			{
+				std::unique_lock<std::mutex> lock(mMutexExtraction);
+				frame.nResets = mnResets;
+				frame.frame.reset(new cMultiFrame());
+				mpTracker->ExtractFrame(imageSet.images, imageSet.timestamp, *frame.frame);
+			}
+			catch (...)
+			{
+				frame.pose.set_exception(std::current_exception());
+				continue;
+			}
+			// release the images now, the frame holds its own reference
+			imageSet.images.clear();
+			mqFrames.Push(std::move(frame));
+		}
+		mqFrames.Close();
+	}
+
+	bool cTrackingPipeline::CheckReset(const sFrame& frame)
+	{
+		if (mpSystem->ResetRequested())
+		{
+			// cTracking::Reset resets the frame ids and the extractor
+			// choice, nothing may be extracted meanwhile
+			std::unique_lock<std::mutex> lock(mMutexExtraction);
+			mpSystem->CheckReset();
+			++mnResets;
+		}
+		// only the tracking thread changes mnResets
+		return frame.nResets == mnResets;
+	}
+
+	void cTrackingPipeline::RunTracking()
+	{
+		sFrame frame;
+		while (mqFrames.Pop(frame))
+		{
+			sPoseResult result;
+			result.timestamp = frame.timestamp;
+			try
+			{
+				if (!CheckReset(frame))
+				{
+					++mnDropped;
+					frame.pose.set_exception(std::make_exception_ptr(
+						std::runtime_error("frame extracted before a reset")));
+					frame.frame.reset();
+					continue;
+				}
+				result.pose = mpTracker->TrackFrame(*frame.frame);
+				result.bTracked = mpTracker->mState == cTracking::WORKING;
+			}
+			catch (...)
+			{
+				frame.pose.set_exception(std::current_exception());
+				frame.frame.reset();
+				continue;
+			}
+			frame.frame.reset();
+			++mnProcessed;
+			frame.pose.set_value(result.pose);
+			Publish(result);
+		}
+	}
+}
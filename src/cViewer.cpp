@@ -73,6 +73,9 @@ namespace MultiColSLAM
 	{
 		
 		mbFinished = false;
+		// the viewer only holds map pointers while drawing
+		cEpochReclaimer* pReclaimer = mpMapDrawer->mpMap->GetReclaimer();
+		const int reclaimerId = pReclaimer->RegisterThread();
 #ifndef _DEBUG
 		pangolin::CreateWindowAndBind("MultiCol-SLAM: Map Viewer", 1024, 768);
 
@@ -167,14 +170,20 @@ namespace MultiColSLAM
 				menuReset = false;
 			}
 #endif
+			pReclaimer->QuiescentState(reclaimerId);
+
 			if (Stop())
 				while (isStopped())
+				{
+					pReclaimer->QuiescentState(reclaimerId);
 					std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+				}
 
 			if (CheckFinish())
 				break;
 		}
 
+		pReclaimer->UnregisterThread(reclaimerId);
 		SetFinish();
 #ifndef _DEBUG
 		pangolin::BindToContext("MultiCam SLAM: Map Viewer");
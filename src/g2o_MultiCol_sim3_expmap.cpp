@@ -109,6 +109,49 @@ namespace MultiColSLAM
 		return true;
 	}
 
+	void edgeSim3::linearizeOplus()
+	{
+		const simpleVertexSim3Expmap* v1 = static_cast<const simpleVertexSim3Expmap*>(_vertices[0]);
+		const simpleVertexSim3Expmap* v2 = static_cast<const simpleVertexSim3Expmap*>(_vertices[1]);
+
+		// same steps and the same operation order as the g2o version,
+		// which pushes, perturbs and pops the vertices themselves
+		const double delta = 1e-9;
+		const double scalar = 1.0 / (2 * delta);
+		const g2o::Sim3 C(_measurement);
+		const g2o::Sim3 S1 = v1->estimate();
+		const g2o::Sim3 S2inv = v2->estimate().inverse();
+
+		g2o::Vector7d update;
+		if (!v1->fixed())
+		{
+			for (int d = 0; d < 7; ++d)
+			{
+				update.setZero();
+				if (!(v1->_fix_scale && d == 6))
+					update[d] = delta;
+				const g2o::Vector7d errorPlus = (C*(g2o::Sim3(update)*S1)*S2inv).log();
+				update = -update;
+				const g2o::Vector7d errorMinus = (C*(g2o::Sim3(update)*S1)*S2inv).log();
+				_jacobianOplusXi.col(d) = scalar * (errorPlus - errorMinus);
+			}
+		}
+		if (!v2->fixed())
+		{
+			const g2o::Sim3 CS1 = C*S1;
+			for (int d = 0; d < 7; ++d)
+			{
+				update.setZero();
+				if (!(v2->_fix_scale && d == 6))
+					update[d] = delta;
+				const g2o::Vector7d errorPlus = (CS1*(g2o::Sim3(update)*v2->estimate()).inverse()).log();
+				update = -update;
+				const g2o::Vector7d errorMinus = (CS1*(g2o::Sim3(update)*v2->estimate()).inverse()).log();
+				_jacobianOplusXj.col(d) = scalar * (errorPlus - errorMinus);
+			}
+		}
+	}
+
 	bool edgeSim3::write(std::ostream& os) const
 	{
 		g2o::Sim3 cam2world(measurement().inverse());
@@ -164,19 +164,7 @@ mdBRIEFextractorOct::mdBRIEFextractorOct(int _nfeatures,
 	mvImagePyramid.resize(numlevels);
 	mvMaskPyramid.resize(numlevels);
 
-	mnFeaturesPerLevel.resize(numlevels);
-	double factor = (1.0 / scaleFactor);
-	double nDesiredFeaturesPerScale = nfeatures*(1 - factor) /
-		(1 - pow(factor, numlevels));
-
-	int sumFeatures = 0;
-	for (int level = 0; level < numlevels - 1; level++)
-	{
-		mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
-		sumFeatures += mnFeaturesPerLevel[level];
-		nDesiredFeaturesPerScale *= factor;
-	}
-	mnFeaturesPerLevel[numlevels - 1] = std::max(nfeatures - sumFeatures, 0);
+	ComputeFeaturesPerLevel();
 
 	const int npoints = 2 * 8 * descSize;
 	const Point* pattern0 = (const Point*)learned_pattern_64_ORB;
@@ -1241,6 +1229,31 @@ static void computeDescriptors(
 	}
 }
 
+void mdBRIEFextractorOct::ComputeFeaturesPerLevel()
+{
+	mnFeaturesPerLevel.resize(numlevels);
+	double factor = (1.0 / scaleFactor);
+	double nDesiredFeaturesPerScale = nfeatures*(1 - factor) /
+		(1 - pow(factor, numlevels));
+
+	int sumFeatures = 0;
+	for (int level = 0; level < numlevels - 1; level++)
+	{
+		mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
+		sumFeatures += mnFeaturesPerLevel[level];
+		nDesiredFeaturesPerScale *= factor;
+	}
+	mnFeaturesPerLevel[numlevels - 1] = std::max(nfeatures - sumFeatures, 0);
+}
+
+void mdBRIEFextractorOct::SetNumFeatures(const int& _nfeatures)
+{
+	if (_nfeatures == nfeatures)
+		return;
+	nfeatures = _nfeatures;
+	ComputeFeaturesPerLevel();
+}
+
 void mdBRIEFextractorOct::operator()(
 	InputArray _image,
 	InputArray _mask,
@@ -1292,13 +1305,14 @@ void mdBRIEFextractorOct::operator()(
 		vector<KeyPoint>& keypoints = allKeypoints[level];
 		int nkeypointsLevel = (int)keypoints.size();
 
-		if (nkeypointsLevel == 0)
-			continue;
-
-		// preprocess the resized image
+		// preprocess the resized image, every level also without keypoints
+		// as the frame keeps the pyramid for the direct alignment
 		Mat& workingMat = mvImagePyramid[level];
 		//GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
 		boxFilter(workingMat, workingMat, workingMat.depth(), Size(5, 5), Point(-1, -1), true, BORDER_REFLECT_101);
+
+		if (nkeypointsLevel == 0)
+			continue;
 		
 		// undistort keypoint coordinates
 		std::vector<Vec2d> undistortedKeypoints = std::vector<Vec2d>(nkeypointsLevel);	
@@ -20,6 +20,14 @@
 */
 #include "misc.h"
 
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
 namespace MultiColSLAM
 {
 	// TODO investigate if any opengv stuff is involved?
@@ -99,4 +107,76 @@ namespace MultiColSLAM
 			std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
 	}
 
-}
\ No newline at end of file
+#ifdef __linux__
+	static int OpenPerfCounter(const unsigned int& type, const unsigned long long& config)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// this thread only, on any cpu
+		return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	static long long ReadPerfCounter(const int& fd)
+	{
+		if (fd < 0)
+			return -1;
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		long long count = 0;
+		if (read(fd, &count, sizeof(count)) != sizeof(count))
+			return -1;
+		return count;
+	}
+#endif
+
+	cCacheMissCounter::cCacheMissCounter() :
+		mFdL1(-1), mFdLLC(-1), mnL1Misses(-1), mnLLCMisses(-1)
+	{
+#ifdef __linux__
+		mFdL1 = OpenPerfCounter(PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_L1D |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		mFdLLC = OpenPerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+	}
+
+	cCacheMissCounter::~cCacheMissCounter()
+	{
+#ifdef __linux__
+		if (mFdL1 >= 0)
+			close(mFdL1);
+		if (mFdLLC >= 0)
+			close(mFdLLC);
+#endif
+	}
+
+	void cCacheMissCounter::Start()
+	{
+#ifdef __linux__
+		if (mFdL1 >= 0)
+		{
+			ioctl(mFdL1, PERF_EVENT_IOC_RESET, 0);
+			ioctl(mFdL1, PERF_EVENT_IOC_ENABLE, 0);
+		}
+		if (mFdLLC >= 0)
+		{
+			ioctl(mFdLLC, PERF_EVENT_IOC_RESET, 0);
+			ioctl(mFdLLC, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	void cCacheMissCounter::Stop()
+	{
+#ifdef __linux__
+		mnL1Misses = ReadPerfCounter(mFdL1);
+		mnLLCMisses = ReadPerfCounter(mFdLLC);
+#endif
+	}
+}